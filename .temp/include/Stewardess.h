@@ -0,0 +1,20 @@
+
+#ifndef STEWARDESS_H_
+#define STEWARDESS_H_
+
+#include "Stewardess/Definitions.h"
+#include "Stewardess/CallbackInterface.h"
+#include "Stewardess/Manager.h"
+#include "Stewardess/Configuration.h"
+#include "Stewardess/Handle.h"
+#include "Stewardess/LoadBalancer.h"
+#include "Stewardess/Coroutine.h"
+#include "Stewardess/Payload.h"
+#include "Stewardess/InetAddress.h"
+#include "Stewardess/Serializer.h"
+#include "Stewardess/Filter.h"
+#include "Stewardess/Buffer.h"
+#include "Stewardess/Exception.h"
+
+#endif // STEWARDESS_H_
+
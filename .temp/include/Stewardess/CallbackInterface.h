@@ -0,0 +1,86 @@
+
+#ifndef STEWARDESS_CALLBACK_INTERFACE_H_
+#define STEWARDESS_CALLBACK_INTERFACE_H_
+
+#include "Definitions.h"
+#include "Handle.h"
+#include "Manager.h"
+
+
+namespace Stewardess
+{
+
+  class Payload;
+  class Serializer;
+  class Manager;
+
+  class CallbackInterface
+  {
+    // Manager base is a friend so that it can store a pointer to the data here
+    friend class Manager;
+
+    private:
+      Manager* _manager;
+
+    protected:
+      // Return a reference to the manager
+      Manager& manager() { return *_manager; }
+
+
+    public:
+      CallbackInterface();
+      virtual ~CallbackInterface();
+
+
+      // Return a new'd serializer object to implement the transfer protocol
+      virtual Serializer* buildSerializer() const = 0;
+
+
+      // Append new'd filters to transform each connection's byte stream. The first is closest to the serializer
+      virtual void buildFilters( FilterVector& ) const {}
+
+
+      // Called when the server first starts for initialisation functions
+      virtual void onStart() {}
+
+
+      // Called immediately after the server stops for cleanup
+      virtual void onStop() {}
+
+
+      // The connection callbacks borrow the connection for the length of the call.
+      //  Construct a Handle from the reference to keep it any longer
+
+      // Called when a read event is triggered.
+      virtual void onRead( HandleRef, Payload* ) {}
+
+
+      // Called when a write event is triggered
+      virtual void onWrite( HandleRef ) {}
+
+
+      // Called when a connection event occurs
+      virtual void onConnectionEvent( HandleRef, ConnectionEvent, const char* = nullptr ) {}
+
+
+      // Called when a server event occurs
+      virtual void onEvent( ServerEvent, const char* = nullptr ) {}
+
+
+      // Called on every server 'tick'
+      virtual void onTick( Milliseconds ) {}
+
+
+      // Called when a user timer expires
+      virtual void onTimer( UniqueID ) {}
+
+
+      // Called on the connection's worker thread when a timer started through its handle expires
+      virtual void onConnectionTimer( HandleRef, UniqueID ) {}
+
+  };
+
+}
+
+#endif // STEWARDESS_CALLBACK_INTERFACE_H_
+
@@ -0,0 +1,248 @@
+
+#ifndef STEWARDESS_CONFIGURATION_H_
+#define STEWARDESS_CONFIGURATION_H_
+
+#include "Definitions.h"
+
+namespace Stewardess
+{
+
+  struct ConfigurationData
+  {
+    // The port number we want
+    int portNumber;
+
+    // How often the worker event base forces a tick
+    timeval workerTickTime;
+
+    // The minimum time between ticks
+    int minTickTime;
+
+    // Modify the internal tick time by this factor
+    float tickTimeModifier;
+
+    // Time out time for read/write attempts. Reads time out when nothing has arrived, or a balanced
+    //  request has not been answered. Writes while the socket is too full to take any more
+    timeval readTimeout;
+    timeval writeTimeout;
+
+    // Time out time for connections that neither send nor receive anything
+    timeval idleTimeout;
+
+    // Time out time for outbound connection attempts
+    timeval connectTimeout;
+
+    // Time out time for forcing the server to shutdown
+    timeval deathTime;
+
+    // Set whether the manager can signal connection closes on shutdown
+    bool connectionCloseOnShutdown;
+
+
+    // Default size for the read/write buffers
+    size_t bufferSize;
+
+    // Number of parallel threads to handle connection events
+    unsigned numThreads;
+
+    // Number of pool threads that run onRead away from the connection threads. Zero runs it inline
+    unsigned numComputeThreads;
+
+    // If true a listener event is added to libevent stack to support incoming connections
+    bool requestListener;
+
+    // How connections are assigned to worker threads
+    PlacementPolicy placementPolicy;
+
+    // Difference in worker utilization that triggers moving a connection. Zero disables it
+    double rebalanceThreshold;
+
+    // If true threads without explicit CPU sets are pinned automatically from the detected topology
+    bool pinThreads;
+
+    // If true automatic pinning puts workers on the isolated CPUs and keeps the control thread off them
+    bool useIsolatedCPUs;
+
+    // Explicit CPU sets for each worker and the control thread. Empty sets are left alone
+    std::vector< CPUSet > workerCPUs;
+    CPUSet controlCPUs;
+
+    // If true each worker thread binds its own SO_REUSEPORT listener and the kernel spreads the accepts
+    bool reusePortListeners;
+
+    // If true a signal event is added to libevent stack to catch the sigint
+    bool requestSignalHandler;
+
+    // If true each connection offers to deflate its data stream during a handshake
+    bool requestCompression;
+
+    // zlib compression level, 0-9
+    int compressionLevel;
+
+    // Serialized buffers smaller than this are sent uncompressed
+    size_t compressionThreshold;
+
+    // How long to wait for the peer's compression hello before sending uncompressed. Zero waits forever
+    timeval compressionTimeout;
+
+    // If true every frame carries a CRC32C trailer that the peer checks
+    bool frameChecksum;
+
+    // Largest frame accepted from the peer, checksummed or after inflating
+    size_t maxFrameSize;
+
+    // DNS servers as "address[:port]". Empty uses the system's resolv.conf
+    std::vector< std::string > nameServers;
+
+    // Static names checked before DNS
+    std::string hostsFile;
+
+    // How long a failed lookup is remembered, in seconds
+    unsigned dnsNegativeTTL;
+
+    // Fraction of a record's TTL left when it is refreshed in the background. Zero disables it
+    double dnsRefreshAhead;
+
+    // Connections the pool keeps open to each endpoint, and the most it will open
+    size_t poolMinConnections;
+    size_t poolMaxConnections;
+
+    // Idle pooled connections above the minimum are closed after this long
+    timeval poolIdleTimeout;
+
+    // Endpoints the pool connects to as soon as the manager starts
+    std::vector< std::pair< std::string, std::string > > poolEndpoints;
+  };
+
+
+  /* 
+   * This class is used to configure the server/client process before it starts.
+   */
+  class Configuration
+  {
+    friend class Manager;
+    private:
+      ConfigurationData _data;
+
+    public:
+      Configuration( int );
+      ~Configuration();
+
+
+      // Set the number of connection handling threads
+      void setNumberThreads( unsigned );
+
+      // Set the number of threads that run onRead, in order for each connection. Zero runs it on the connection threads
+      void setNumberComputeThreads( unsigned );
+
+
+      // Set the default buffer size. Should probably be bigger than the expected payload size
+      void setDefaultBufferSize( size_t );
+
+
+      // Set the timeouts for each connection, in seconds. Zero disables them.
+      //  Read  - nothing has arrived for that long. Requests sent through a LoadBalancer must also be answered within it
+      //  Write - the socket has been too full to write to for that long
+      //  Idle  - nothing has been read or written for that long
+      // The connection is closed with ConnectionEvent::Timeout. They are checked a few times a second
+      void setReadTimeout( unsigned int );
+      void setWriteTimeout( unsigned int );
+      void setIdleTimeout( unsigned int );
+
+      // Set the timeout for outbound connections. Zero waits for the operating system to give up
+      void setConnectTimeout( unsigned int );
+
+
+      // Set the modifier factor for the internal tick time
+      void setTickTimeModifier( float );
+
+      // Set the modifier factor for the internal tick time
+      void setMinTickTime( unsigned int );
+
+      // Set the time before the connections are forcibly closed once shutdown has been called.
+      void setDeathTime( unsigned int );
+
+
+      // Set where the manager can signal connection close when shutdown is called.
+      // Note the connection will only close once another event has triggered. e.g. read timeout.
+      void setCloseConnectionsOnShutdown( bool );
+
+
+      // Set whether a listener event is required to allow new remote connection requests
+      void setRequestListener( bool );
+
+
+      // Set whether a listener event is required to allow new remote connection requests
+      void setRequestSignalHandler( bool );
+
+
+      // Set whether each worker accepts on its own SO_REUSEPORT listener instead of the control thread
+      void setReusePortListeners( bool );
+
+      // Set how new connections are assigned to worker threads. Not used by SO_REUSEPORT listeners
+      void setPlacementPolicy( PlacementPolicy );
+
+      // Set whether threads are pinned to CPUs automatically, spreading workers across the NUMA nodes
+      void setPinThreads( bool );
+
+      // Set whether automatic pinning uses the isolated (isolcpus) CPUs for the workers
+      void setUseIsolatedCPUs( bool );
+
+      // Pin a worker thread to a set of CPUs. Overrides the automatic choice
+      void setWorkerCPUs( unsigned, CPUSet );
+
+      // Pin the control thread to a set of CPUs. Overrides the automatic choice
+      void setControlCPUs( CPUSet );
+
+      // Set the difference in worker utilization (0-1) at which connections are moved off the busiest worker. Zero disables it
+      void setRebalanceThreshold( double );
+
+
+      // Set whether connections negotiate a compressed stream. Both ends must request it.
+      void setRequestCompression( bool );
+
+      // Set the zlib compression level (0-9)
+      void setCompressionLevel( int );
+
+      // Set the size below which serialized buffers bypass the compressor
+      void setCompressionThreshold( size_t );
+
+      // Set how long to wait for the peer's compression hello before closing the connection. Zero waits forever
+      void setCompressionTimeout( unsigned int );
+
+
+      // Set whether every frame carries a CRC32C trailer. Both ends must request it.
+      void setFrameChecksum( bool );
+
+      // Set the largest frame, checksummed or inflated, accepted before the stream is considered corrupt
+      void setMaxFrameSize( size_t );
+
+
+      // Add a DNS server, "address[:port]". If none are added the system's resolv.conf is used
+      void addNameServer( std::string );
+
+      // Set the file of static host names checked before DNS
+      void setHostsFile( std::string );
+
+      // Set how many seconds a failed lookup is remembered before trying again
+      void setDNSNegativeTTL( unsigned );
+
+      // Set the fraction (0-1) of a record's TTL left when a cached name is refreshed in the background
+      void setDNSRefreshAhead( double );
+
+
+      // Set the number of connections the pool keeps open to each endpoint, and the most it opens
+      void setPoolConnections( size_t, size_t );
+
+      // Set how long an idle pooled connection above the minimum is kept
+      void setPoolIdleTimeout( unsigned int );
+
+      // Add an endpoint (host, port) the pool connects to when the manager starts
+      void addPoolEndpoint( std::string, std::string );
+
+  };
+
+}
+
+#endif // STEWARDESS_CONFIGURATION_H_
+
@@ -0,0 +1,266 @@
+
+#ifndef STEWARDESS_DEFINITIONS_H_
+#define STEWARDESS_DEFINITIONS_H_
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <list>
+#include <queue>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <iostream>
+#include <memory>
+#include <functional>
+#include <deque>
+#include <ctime>
+
+#include "logtastic.h"
+
+
+#define STEWARDESS_VERSION_STRING "0.1.0"
+
+
+namespace Stewardess
+{
+
+  // The default time for the internal tick rate of the server
+  const timeval defaultTickTime = { 2, 0 };
+  // Start an timer event immediately with this timer
+  const timeval immediately = { 0, 0 };
+
+
+  // Forward declare some classes
+  class Connection;
+  class Handle;
+  class Payload;
+  class Buffer;
+  class Filter;
+  class ThreadInfo;
+  class TimerData;
+  struct WorkerData;
+
+
+  // Serialization structures
+  typedef std::queue< Buffer* > BufferQueue;
+  typedef std::queue< Payload* > PayloadQueue;
+  typedef std::queue< const char* > ErrorQueue;
+  typedef std::vector< Buffer > BufferVector;
+  typedef std::vector< Filter* > FilterVector;
+
+  // Serialized data that may be shared between many connections' output queues
+  typedef std::shared_ptr< const Buffer > SharedBuffer;
+  typedef std::deque< SharedBuffer > OutputQueue;
+
+  // Prefered time stamp data type. Wall clock, for everything the user sees
+  typedef std::chrono::time_point<std::chrono::system_clock> TimeStamp;
+
+  // Internal time stamp for per-event stamps, timeouts and backoffs. Monotonic, so it never jumps
+  typedef std::chrono::time_point<std::chrono::steady_clock> SteadyTime;
+  typedef std::chrono::milliseconds Milliseconds;
+  typedef std::chrono::microseconds Microseconds;
+  typedef std::chrono::seconds Seconds;
+
+  // The monotonic clock as of the last kernel tick, a few milliseconds behind at most. Reading it costs
+  //  no more than reading memory, so it is used wherever a time stamp is taken for every I/O event
+  struct CoarseClock
+  {
+    typedef SteadyTime::duration duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef SteadyTime time_point;
+    static constexpr bool is_steady = true;
+
+    // Same epoch as the steady clock, so the two can be compared
+    static time_point now() noexcept
+    {
+      timespec time;
+      clock_gettime( CLOCK_MONOTONIC_COARSE, &time );
+      return time_point( std::chrono::duration_cast< duration >( std::chrono::seconds( time.tv_sec ) + std::chrono::nanoseconds( time.tv_nsec ) ) );
+    }
+  };
+
+  // Unique identifier types
+  typedef std::intptr_t ConnectionID;
+  typedef int64_t UniqueID;
+
+  // Common arry-like structures
+  typedef std::vector< Connection* > ConnectionVector;
+  typedef std::vector< ThreadInfo* > ThreadVector;
+  typedef std::vector< Handle > HandleVector;
+
+  // List of CPU numbers a thread may run on
+  typedef std::vector< unsigned > CPUSet;
+
+  // Selects the connections that receive a broadcast
+  typedef std::function< bool( const Handle& ) > ConnectionFilter;
+
+  // Work posted to run on a specific worker's event loop
+  typedef std::function< void() > WorkerJob;
+  typedef std::queue< WorkerJob > WorkerJobQueue;
+
+  // Called with the new connection, or a null handle, when an asynchronous connect finishes
+  typedef std::function< void( Handle ) > ConnectCallback;
+
+  // Called with the response to a request, or a null payload if it will never come. Takes the payload
+  typedef std::function< void( const Handle&, Payload* ) > ResponseCallback;
+
+  // Short hands for mutex locks
+  typedef std::unique_lock<std::mutex> UniqueLock;
+  typedef std::lock_guard<std::mutex> GuardLock;
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Connection event enumeration
+
+  enum class ConnectionEvent { Connect, Disconnect, DisconnectError, Timeout, SerializationError };
+
+  enum class ServerEvent { Shutdown, ListenerError, RequestConnectFail };
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Worker placement
+
+  // How new connections are assigned to worker threads
+  enum class PlacementPolicy { RoundRobin, FewestConnections, LowestUtilization, PowerOfTwoChoices, IdentifierHash };
+
+  // Snapshot of the load on a worker thread
+  struct WorkerLoad
+  {
+    // Open connections assigned to the worker
+    size_t connections;
+
+    // Smoothed fraction of the time the worker's event loop spends in callbacks
+    double utilization;
+  };
+
+  typedef std::vector< WorkerLoad > WorkerLoadVector;
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Outbound load balancing
+
+  // How a load balancer picks the connection for each request
+  enum class BalancePolicy { RoundRobin, LeastOutstanding, PowerOfTwoChoices, ConsistentHash };
+
+  // When a load balancer stops using a misbehaving connection. A zero turns that check off
+  struct OutlierSettings
+  {
+    // Failures in a row
+    unsigned consecutiveFailures = 5;
+
+    // Fraction of recent requests that failed, once at least the minimum have been seen
+    double errorRate = 0.5;
+    unsigned minimumRequests = 20;
+
+    // Smoothed response time as a multiple of the median of the healthy connections
+    double latencyFactor = 0.0;
+
+    // The first ejection lasts the base time, doubling with each ejection in a row up to the maximum
+    Milliseconds baseEjectionTime = Milliseconds( 5000 );
+    Milliseconds maxEjectionTime = Milliseconds( 60000 );
+
+    // Most of the connections that may be ejected at once
+    double maxEjectedFraction = 0.5;
+
+    // Requests let through after an ejection. All of them must succeed to restore the connection
+    unsigned halfOpenRequests = 1;
+  };
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Compression statistics
+
+  struct CompressionStatistics
+  {
+    // Bytes produced by the serializer and bytes actually written to the socket
+    uint64_t plainBytesOut;
+    uint64_t wireBytesOut;
+
+    // Bytes read from the socket and bytes passed to the serializer
+    uint64_t wireBytesIn;
+    uint64_t plainBytesIn;
+
+    // CPU time spent in deflate and inflate
+    std::chrono::nanoseconds compressTime;
+    std::chrono::nanoseconds decompressTime;
+
+    // Fraction of the plain bytes that went on the wire
+    double ratioOut() const { return plainBytesOut == 0 ? 1.0 : (double)wireBytesOut / plainBytesOut; }
+    double ratioIn() const { return plainBytesIn == 0 ? 1.0 : (double)wireBytesIn / plainBytesIn; }
+
+    // CPU milliseconds per megabyte of plain data
+    double compressCPUPerMB() const { return plainBytesOut == 0 ? 0.0 : compressTime.count() * 1.0E-6 / ( plainBytesOut * 1.0E-6 ); }
+    double decompressCPUPerMB() const { return plainBytesIn == 0 ? 0.0 : decompressTime.count() * 1.0E-6 / ( plainBytesIn * 1.0E-6 ); }
+
+    CompressionStatistics& operator+=( const CompressionStatistics& other )
+    {
+      plainBytesOut += other.plainBytesOut;
+      wireBytesOut += other.wireBytesOut;
+      wireBytesIn += other.wireBytesIn;
+      plainBytesIn += other.plainBytesIn;
+      compressTime += other.compressTime;
+      decompressTime += other.decompressTime;
+      return *this;
+    }
+  };
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Connection pool statistics
+
+  struct PoolStatistics
+  {
+    // The "host:port" the connections go to
+    std::string endpoint;
+
+    // Connections sitting in the pool, handed out, and still connecting
+    size_t idle;
+    size_t leased;
+    size_t connecting;
+
+    // Leases waiting because the endpoint is at its maximum
+    size_t waiting;
+
+    // Connection attempts that have failed since the last success
+    size_t consecutiveFailures;
+
+    // Totals since the pool was created
+    uint64_t leases;
+    uint64_t reused;
+    uint64_t created;
+    uint64_t failed;
+    uint64_t reaped;
+  };
+
+  typedef std::vector< PoolStatistics > PoolStatisticsVector;
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Useful template functions
+  template< typename DURATION >
+  timeval convertToTimeval( DURATION duration )
+  {
+    auto seconds = std::chrono::duration_cast< std::chrono::seconds >( duration );
+    auto micros = std::chrono::duration_cast< std::chrono::microseconds >( duration-seconds );
+
+    return { (time_t)seconds.count(), (long int)micros.count() };
+  }
+
+  inline Microseconds convertFromTimeval( const timeval& time )
+  {
+    return std::chrono::seconds( time.tv_sec ) + Microseconds( time.tv_usec );
+  }
+
+  // Convert an internal steady time to the wall clock, for handing to the user
+  inline TimeStamp convertToWallTime( SteadyTime time )
+  {
+    return std::chrono::system_clock::now() + std::chrono::duration_cast< std::chrono::system_clock::duration >( time - std::chrono::steady_clock::now() );
+  }
+
+}
+
+#endif // STEWARDESS_DEFINITIONS_H_
+
@@ -0,0 +1,175 @@
+
+#ifndef STEWARDESS_HANDLE_H_
+#define STEWARDESS_HANDLE_H_
+
+#include "Definitions.h"
+
+
+namespace Stewardess
+{
+    
+  class Connection;
+  class Payload;
+  class InetAddress;
+  class ReadAwaitable;
+  class WriteAwaitable;
+
+
+  /*
+   * A borrowed view of a connection, passed to the callbacks.
+   *
+   * Holds no reference, so copying it costs nothing. It is only valid until the callback it was
+   *  given to returns. Construct a Handle from it to keep the connection beyond that.
+   */
+  class HandleRef
+  {
+    friend class Connection;
+    friend class ManagerImpl;
+    friend class LoadBalancer;
+    friend class Handle;
+    protected:
+      // Hidden connection data
+      Connection* _connection;
+
+
+      // Only the library can borrow connections
+      HandleRef( Connection* c ) : _connection( c ) {}
+
+    public:
+      // Create a null reference
+      HandleRef() : _connection( nullptr ) {}
+
+
+      // Return the address
+      const InetAddress& getIPAddress() const;
+
+
+      // Returns true if the connection is still alive
+      bool isOpen() const;
+
+
+      // Force the connection to close at the next server tick
+      void close() const;
+
+
+      // Writes a payload to the output buffer. Will fail if it is closed.
+      //  Inside a coroutine the result can be awaited to wait until it reaches the socket
+      WriteAwaitable write( Payload* ) const;
+
+
+      // Send this connection's payloads to Handle::read() instead of onRead, until it closes.
+      //  Call it in the Connect event, or as soon as Manager::connect() resumes, so none reach onRead first
+      void readInCoroutine() const;
+
+
+      // Writes already serialized bytes to the output buffer, bypassing the serializer.
+      //  Queued in order with any payloads written through this connection.
+      void writeRaw( Buffer&& ) const;
+
+      // Scatter variant. All the buffers are queued together, in order.
+      void writeRaw( BufferVector&& ) const;
+
+
+      // Returns the connection's ID. Manager::findConnection turns it back into a handle
+      ConnectionID getConnectionID() const;
+
+
+      // Returns the user id number
+      UniqueID getIdentifier() const;
+
+
+      // Sets the user id number
+      void setIdentifier( UniqueID ) const;
+
+
+      // Return the timestamp when the connection was opened
+      TimeStamp creationTime() const;
+
+
+      // Return the last access
+      TimeStamp lastAccess() const;
+
+
+      // Return the number of requests sent through a load balancer still waiting for a response
+      size_t getOutstanding() const;
+
+
+      // Return the smoothed response time of the requests sent through a load balancer
+      Microseconds getLatency() const;
+
+
+      // Start, or restart, the connection's timer with the given id. onConnectionTimer is called on the
+      //  connection's worker thread when it expires. Stopped automatically when the connection closes.
+      //  Returns false if the connection is already closed
+      bool startTimer( UniqueID, Milliseconds, bool = false ) const;
+
+
+      // Stop the connection's timer with the given id
+      void stopTimer( UniqueID ) const;
+
+
+      // Return the bytes on the wire and CPU time of the compression stage
+      CompressionStatistics getCompressionStatistics() const;
+
+
+      // Return false for a dead connection
+      bool exists() const { return _connection != nullptr; }
+
+
+      // Returns false for a dead connection
+      operator bool() const { return _connection != nullptr; }
+  };
+
+
+  /*
+   * Stores an internal pointer to the connection data.
+   *
+   * Class is not publically constructable. But must be deleted once the connection is closed
+   *  Server requires all handles to be removed before the connection data is cleaned up
+   *
+   * Handle class acts a reference to the connection data.
+   * Reference counting ensures that the connection is only closed once all other 
+   *  references are destroyed. Passes as a HandleRef wherever one is expected.
+   */
+  class Handle : public HandleRef
+  {
+    friend class Connection;
+    friend class ManagerImpl;
+    friend class LoadBalancer;
+    private:
+      // Users can't create active handles
+      // Create a handle for the requested connection
+      Handle( Connection* );
+
+    public:
+      // Create a null handle for connections that don't exist
+      Handle();
+      // Default destructor
+      ~Handle();
+
+      // Take a reference to a borrowed connection, so it can be kept after the callback returns
+      explicit Handle( const HandleRef& );
+
+      // Copy and assignment functons
+      Handle( const Handle& );
+      Handle( Handle&& );
+      Handle& operator=( const Handle& );
+      Handle& operator=( Handle&& );
+
+
+      // Release the handle so that the connection can be fully closed
+      void release();
+
+
+      // Awaited inside a coroutine to receive the next payload. Null once the connection closes.
+      //  Throws unless readInCoroutine() has been called. The handle must outlive the await
+      ReadAwaitable read() const;
+  };
+
+}
+
+// The awaitables returned above. Included last, they need the handles to be complete
+#include "Coroutine.h"
+
+#endif // STEWARDESS_HANDLE_H_
+
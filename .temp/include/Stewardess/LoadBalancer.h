@@ -0,0 +1,271 @@
+
+#ifndef STEWARDESS_LOAD_BALANCER_H_
+#define STEWARDESS_LOAD_BALANCER_H_
+
+#include "Definitions.h"
+#include "Handle.h"
+
+#include <random>
+
+
+namespace Stewardess
+{
+
+  /*
+   * Spreads requests over a set of connections to replicated backends.
+   *
+   * Each request sent through the balancer is counted as outstanding on its connection
+   *  until the next payload arrives from it, so the backends must answer every request
+   *  with exactly one payload, in order. The outstanding counts and the smoothed response
+   *  times drive the policies:
+   *
+   *   RoundRobin        - each connection in turn
+   *   LeastOutstanding  - fewest requests waiting, ties taken in turn
+   *   PowerOfTwoChoices - the cheaper of two random connections, cost being latency times load
+   *   ConsistentHash    - the same connection for the same key, unless it is carrying more than
+   *                        the load factor times the average load. Then the next one round the ring
+   *
+   * Requests sent with a callback can be hedged. If the response hasn't arrived after the
+   *  chosen percentile of recent response times, the request is sent again on a different
+   *  connection. The first response goes to the callback and the other is discarded. Only use
+   *  it for requests that are safe to repeat. The budget is the fraction of requests that may be
+   *  sent twice, so a slow backend can't double the load on the others.
+   *
+   * Outlier detection ejects connections that fail too often or answer too slowly. Ejected
+   *  connections get no requests until the ejection time is up. They are then half open, and
+   *  only a few probe requests go through until those show whether it has recovered.
+   *  Failures are requests sent with a callback that never got a response, plus anything passed
+   *  to reportFailure, such as errors seen in onConnectionEvent. Response times come from the
+   *  requests sent with a callback.
+   *
+   * A connection with the maximum number of requests outstanding takes no more. When nothing
+   *  is available, send and request fail straight away rather than queueing behind a dead backend.
+   *
+   * Closed connections are dropped as they are found. Thread safe. The balancer must outlive
+   *  the requests sent through it.
+   */
+  class LoadBalancer
+  {
+    // Sends the hedge when the primary is too slow
+    friend void hedgeTimerCB( void* );
+
+    private:
+      // One point on the hash ring, and the connection it belongs to
+      struct RingPoint
+      {
+        uint64_t hash;
+        size_t index;
+
+        bool operator<( const RingPoint& other ) const { return hash < other.hash; }
+      };
+
+      typedef std::vector< RingPoint > Ring;
+
+      // Health of one connection
+      enum class BackendState { Healthy, Ejected, HalfOpen };
+
+      struct Backend
+      {
+        Handle handle;
+        BackendState state = BackendState::Healthy;
+
+        // Recent results, halved every time the error rate is checked
+        double successes = 0.0;
+        double failures = 0.0;
+        unsigned consecutiveFailures = 0;
+
+        // Smoothed response time of requests with a callback, in microseconds. Zero until one is timed
+        uint64_t latency = 0;
+
+        // Ejections in a row, and when the current one ends or the probing started
+        unsigned ejections = 0;
+        std::chrono::steady_clock::time_point ejectedUntil;
+
+        // Probes sent and answered while half open
+        unsigned probes = 0;
+        unsigned probeSuccesses = 0;
+      };
+
+      typedef std::vector< Backend > BackendVector;
+
+      // A request with a callback. Shared by its attempts and the hedge timer
+      struct Request;
+
+      typedef std::shared_ptr< Request > RequestPointer;
+
+
+      const BalancePolicy _policy;
+
+      // Load allowed on one connection, relative to the average, before a key moves on
+      const double _loadFactor;
+
+      // Ring points for each connection
+      const unsigned _virtualNodes;
+
+      BackendVector _connections;
+      Ring _ring;
+      size_t _next;
+      std::minstd_rand _generator;
+
+      // Connections that can take a request, found for each pick
+      std::vector< size_t > _candidates;
+      std::vector< bool > _eligible;
+
+      // Outlier detection, off until it is configured
+      bool _outlierDetection;
+      OutlierSettings _outliers;
+      std::chrono::steady_clock::time_point _lastLatencyCheck;
+
+      // Requests one connection may have outstanding. Zero for no limit
+      size_t _maxOutstanding;
+
+      // Which percentile of the response times triggers a hedge, and the fraction of requests that may be hedged
+      double _hedgePercentile;
+      double _hedgeBudget;
+
+      // Hedges that may be sent now. Each request adds the budget, each hedge spends one
+      double _hedgeTokens;
+
+      // Recent response times in microseconds, and the hedge delay taken from them. Zero until there are enough
+      std::vector< uint64_t > _samples;
+      size_t _nextSample;
+      size_t _newSamples;
+      Microseconds _hedgeDelay;
+
+      // Counters for the statistics
+      uint64_t _numberRequests;
+      uint64_t _numberHedges;
+      uint64_t _numberHedgeWins;
+      uint64_t _numberEjections;
+      uint64_t _numberRejected;
+
+      mutable std::mutex _mutex;
+
+
+      // Rebuild the ring after the connections change. Call with the mutex locked
+      void _buildRing();
+
+      // Remove the closed connections. Call with the mutex locked
+      void _prune();
+
+      // Returns true if the connection can take a request now. Ends ejections that are over. Call with the mutex locked
+      bool _available( Backend&, std::chrono::steady_clock::time_point );
+
+      // Choose from the candidates using the policy. Call with the mutex locked, at least one candidate present
+      size_t _roundRobin();
+      size_t _leastOutstanding();
+      size_t _powerOfTwo();
+      size_t _consistentHash( const std::string& );
+
+      // Pick an available connection other than the excluded one. Returns the index, or the size if
+      //  there are none. Call with the mutex locked
+      size_t _pick( const std::string&, ConnectionID = 0 );
+
+      // Pick a connection for a new request. Null if none are available
+      Handle _select( const std::string&, ConnectionID = 0 );
+
+
+      // Record the result of a request on a connection, with its response time if there was one
+      void _result( ConnectionID, bool, uint64_t = 0 );
+
+      // Stop sending requests to the connection for a while. Call with the mutex locked
+      void _eject( Backend&, std::chrono::steady_clock::time_point, const char* );
+
+      // Eject healthy connections that are much slower than the others. Call with the mutex locked
+      void _checkLatency( std::chrono::steady_clock::time_point );
+
+
+      // Send one attempt of a request on the connection
+      void _attempt( const RequestPointer&, const Handle& );
+
+      // An attempt was answered, or failed if the payload is null. The first answer wins
+      void _answered( const RequestPointer&, const Handle&, Payload*, std::chrono::steady_clock::time_point );
+
+      // The hedge timer fired. Send the request on another connection if it is still waiting
+      void _hedge( const RequestPointer& );
+
+      // Add a response time and update the hedge delay. Call with the mutex locked
+      void _addSample( uint64_t );
+
+    public:
+      explicit LoadBalancer( BalancePolicy = BalancePolicy::RoundRobin, double = 1.25, unsigned = 100 );
+
+      LoadBalancer( const LoadBalancer& ) = delete;
+      LoadBalancer( LoadBalancer&& ) = delete;
+      LoadBalancer& operator=( const LoadBalancer& ) = delete;
+      LoadBalancer& operator=( LoadBalancer&& ) = delete;
+
+
+      // Add a connection. Ignored if it is null or already present
+      void add( const Handle& );
+
+      // Remove a connection. Returns false if it wasn't present
+      bool remove( const Handle& );
+
+      // Remove every connection
+      void clear();
+
+      // Number of connections, including any that have closed since they were last checked
+      size_t size() const;
+
+
+      // Pick a connection for the key without sending anything. Null if none are available.
+      //  The key is only used by the consistent hash policy
+      Handle select( const std::string& = std::string() );
+
+      // Pick a connection, count the request as outstanding and write the payload.
+      //  Returns the connection used, or null if none were available. The caller keeps the payload
+      Handle send( Payload*, const std::string& = std::string() );
+
+      // Send a request and pass its response to the callback, hedging it if that is enabled.
+      //  The balancer takes the payload. Returns false if no connections were available
+      bool request( Payload*, ResponseCallback, const std::string& = std::string() );
+
+
+      // Tell the outlier detection about a request that worked or failed outside the balancer's view
+      void reportSuccess( const Handle& );
+      void reportFailure( const Handle& );
+
+
+      // Hedge requests slower than the percentile (0 to 1) of recent response times. The budget is
+      //  the fraction of requests that may be hedged. A budget of zero turns hedging off
+      void setHedging( double, double );
+
+      // Eject connections that misbehave, using the limits given
+      void setOutlierDetection( const OutlierSettings& );
+
+      // Turn outlier detection off. Ejected connections are restored
+      void disableOutlierDetection();
+
+      // Stop picking a connection once it has this many requests outstanding. Zero for no limit
+      void setMaxOutstanding( size_t );
+
+
+      // Return the current hedge delay. Zero until enough responses have been timed
+      Microseconds getHedgeDelay() const;
+
+      // Number of requests sent with a callback
+      uint64_t getNumberRequests() const;
+
+      // Number of hedges sent, and how many of them answered first
+      uint64_t getNumberHedges() const;
+      uint64_t getNumberHedgeWins() const;
+
+      // Number of times a connection has been ejected
+      uint64_t getNumberEjections() const;
+
+      // Number of requests failed straight away because nothing was available
+      uint64_t getNumberRejected() const;
+
+      // Number of connections currently ejected or half open
+      size_t getNumberEjected() const;
+
+
+      // Return the policy
+      BalancePolicy getPolicy() const { return _policy; }
+  };
+
+}
+
+#endif // STEWARDESS_LOAD_BALANCER_H_
+
@@ -0,0 +1,23 @@
+
+#ifndef STEWARDESS_PAYLOAD_BASE_H_
+#define STEWARDESS_PAYLOAD_BASE_H_
+
+#include "Definitions.h"
+
+
+namespace Stewardess
+{
+
+  class Payload
+  {
+    private:
+
+    public:
+      // Virtual destructor
+      virtual ~Payload() {}
+  };
+
+}
+
+#endif // STEWARDESS_PAYLOAD_BASE_H_
+
@@ -74,6 +74,14 @@ int main( int, char** )
 
     std::cout << "Expect Capacity 432 : " << b3.getCapacity() << std::endl;
     std::cout << "Expect chunks 1 : " << b3.getNumberChunks() << std::endl;
+
+    Buffer b4 = buildFunc();
+    Buffer b5( std::move( b4 ) );
+
+    std::cout << "Expect Capacity 175 : " << b5.getCapacity() << std::endl;
+    std::cout << "Expect chunks 3 : " << b5.getNumberChunks() << std::endl;
+    std::cout << "Expect Capacity 0 : " << b4.getCapacity() << std::endl;
+    std::cout << "Expect chunks 0 : " << b4.getNumberChunks() << std::endl;
   }
 
   std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
@@ -155,6 +163,36 @@ int main( int, char** )
     std::cout << "Expect 1 : " << b << std::endl;
   }
 
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  {
+    Buffer source( 10 );
+    std::string letters( "abcdefghijklmnopqrstuvwxyz" );
+    source.push( letters );
+
+    Buffer destination( 10 );
+
+    // Whole chunk, then a small front split, then a large front split
+    destination.splice( source, 10 );
+    std::cout << "Expect chunks 1 : " << destination.getNumberChunks() << std::endl;
+    destination.splice( source, 2 );
+    destination.splice( source, 7 );
+    std::cout << "Expect abcdefghijklmnopqrs : " << destination.getString() << std::endl;
+    std::cout << "Expect tuvwxyz : " << source.getString() << std::endl;
+    std::cout << "Expect chunks 3 : " << destination.getNumberChunks() << std::endl;
+
+    source.skip( 3 );
+    std::cout << "Expect wxyz : " << source.getString() << std::endl;
+    source.skip( 10 );
+    std::cout << "Expect 0 : " << source << std::endl;
+
+    // Still usable after being emptied
+    source.push( letters );
+    destination.splice( source, 100 );
+    std::cout << "Expect size 45 : " << destination.getSize() << std::endl;
+    std::cout << "Expect 0 : " << source << std::endl;
+  }
+
 
   return 0;
 }
@@ -0,0 +1,201 @@
+#include "ChecksumFilter.h"
+#include "CRC32C.h"
+#include "Filter.h"
+#include "Buffer.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+using namespace Stewardess;
+
+
+// Fill a buffer with frames of the given size
+Buffer makeFrame( size_t, size_t );
+
+// Run a function over the data repeatedly and return the throughput in MB/s
+template < class FUNCTION >
+double throughput( size_t, unsigned, FUNCTION );
+
+// Push a set of frames through a filter pair and return the throughput in MB/s
+double filterThroughput( Filter&, Filter&, size_t, size_t, unsigned );
+
+
+int main( int, char** )
+{
+  // Check values against the standard test vector
+  {
+    const char* check = "123456789";
+    std::cout << std::hex;
+    std::cout << "Expect e3069283 : " << crc32cSoftware( 0, check, 9 ) << std::endl;
+    if ( crc32cHardwareAvailable() )
+      std::cout << "Expect e3069283 : " << crc32cHardware( 0, check, 9 ) << std::endl;
+    std::cout << "Expect e3069283 : " << crc32c( crc32c( 0, check, 4 ), check+4, 5 ) << std::endl;
+    std::cout << std::dec;
+
+    // Unaligned starts and odd lengths must agree
+    std::string data( 1000, 'x' );
+    for ( size_t i = 0; i < data.size(); ++i ) data[i] = (char)( i * 31 + 7 );
+    bool same = true;
+    for ( size_t offset = 0; offset < 9; ++offset )
+      same = same && ( crc32cSoftware( 0, data.data()+offset, 991-offset ) == crc32c( 0, data.data()+offset, 991-offset ) );
+    std::cout << "Expect 1 : " << same << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Round trip, fragmented reads and a corrupted frame
+  {
+    ChecksumFilter sender( 1024, 256 );
+    ChecksumFilter receiver( 1024, 256 );
+
+    Buffer wire( 256 );
+    std::string messages[3] = { "{first}", "{second}", "{third}" };
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+      Buffer in( 100 );
+      in.push( messages[i] );
+      sender.write( std::move( in ), wire );
+    }
+
+    std::string data = wire.getString();
+    std::cout << "Expect wire size " << 7+8+7+3*8 << " : " << data.size() << std::endl;
+
+    // Damage the body of the second frame
+    data[ 4+7+4+4+2 ] ^= 0x01;
+
+    Buffer plain( 256 );
+    for ( size_t start = 0; start < data.size(); start += 5 )
+    {
+      Buffer piece( 5 );
+      std::string section = data.substr( start, 5 );
+      piece.push( section );
+      receiver.read( std::move( piece ), plain );
+    }
+
+    std::cout << "Expect {first}{third} : " << plain.getString() << std::endl;
+    std::cout << "Expect 0 : " << receiver.errorEmpty() << std::endl;
+    std::cout << "Error : " << receiver.getError() << std::endl;
+
+    // A silly length can't be trusted
+    ChecksumFilter small_receiver( 4, 256 );
+    Buffer big( 256 );
+    std::string whole = wire.getString();
+    big.push( whole );
+    std::cout << "Expect 0 : " << small_receiver.read( std::move( big ), plain ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Writes bigger than the maximum are split into frames the peer will take
+  {
+    ChecksumFilter sender( 100, 64 );
+    ChecksumFilter receiver( 100, 64 );
+
+    std::string message( 250, 'x' );
+    for ( size_t i = 0; i < message.size(); ++i ) message[i] = (char)( 'a' + i % 26 );
+
+    Buffer in( 64 );
+    in.push( message );
+    Buffer wire( 64 );
+    std::cout << "Expect 1 : " << sender.write( std::move( in ), wire ) << std::endl;
+    std::cout << "Expect wire size " << 250+3*8 << " : " << wire.getSize() << std::endl;
+
+    Buffer plain( 64 );
+    std::cout << "Expect 1 : " << receiver.read( std::move( wire ), plain ) << std::endl;
+    std::cout << "Expect 1 : " << ( plain.getString() == message ) << std::endl;
+    std::cout << "Expect 1 : " << receiver.errorEmpty() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Raw checksum throughput against a plain memory copy
+  {
+    const size_t size = 16*1024*1024;
+    const unsigned repeats = 8;
+    char* data = new char[ size ];
+    char* copy = new char[ size ];
+    for ( size_t i = 0; i < size; ++i ) data[i] = (char)( i * 131 );
+
+    uint32_t sink = 0;
+    std::cout << "Hardware available : " << crc32cHardwareAvailable() << std::endl;
+    std::cout << "memcpy          MB/s : " << throughput( size, repeats, [&]() { std::memcpy( copy, data, size ); sink += copy[ sink % size ]; } ) << std::endl;
+    std::cout << "CRC32C software MB/s : " << throughput( size, repeats, [&]() { sink += crc32cSoftware( 0, data, size ); } ) << std::endl;
+    if ( crc32cHardwareAvailable() )
+      std::cout << "CRC32C hardware MB/s : " << throughput( size, repeats, [&]() { sink += crc32cHardware( 0, data, size ); } ) << std::endl;
+    std::cout << "(" << sink << ")" << std::endl;
+
+    delete[] data;
+    delete[] copy;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Whole filter overhead against no checksum
+  {
+    const size_t frame_size = 64*1024;
+    const size_t frames = 256;
+    const unsigned repeats = 4;
+
+    Filter plain_sender;
+    Filter plain_receiver;
+    ChecksumFilter sender( frame_size, 4096 );
+    ChecksumFilter receiver( frame_size, 4096 );
+
+    double plain_rate = filterThroughput( plain_sender, plain_receiver, frame_size, frames, repeats );
+    double checked_rate = filterThroughput( sender, receiver, frame_size, frames, repeats );
+
+    std::cout << "No checksum     MB/s : " << plain_rate << std::endl;
+    std::cout << "CRC32C frames   MB/s : " << checked_rate << std::endl;
+    std::cout << "Expect 1 : " << receiver.errorEmpty() << std::endl;
+  }
+
+  return 0;
+}
+
+
+Buffer makeFrame( size_t size, size_t chunk_size )
+{
+  Buffer buffer( chunk_size );
+  std::string data( size, 'a' );
+  for ( size_t i = 0; i < size; ++i ) data[i] = (char)( 'a' + i % 26 );
+  buffer.push( data );
+  return buffer;
+}
+
+
+template < class FUNCTION >
+double throughput( size_t size, unsigned repeats, FUNCTION function )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for ( unsigned i = 0; i < repeats; ++i )
+    function();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return ( (double)size * repeats / ( 1024.0 * 1024.0 ) ) / elapsed.count();
+}
+
+
+double filterThroughput( Filter& sender, Filter& receiver, size_t frame_size, size_t frames, unsigned repeats )
+{
+  BufferVector inputs;
+  for ( size_t i = 0; i < frames * repeats; ++i )
+    inputs.push_back( makeFrame( frame_size, 4096 ) );
+
+  size_t received = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for ( BufferVector::iterator it = inputs.begin(); it != inputs.end(); ++it )
+  {
+    Buffer wire( 4096 );
+    Buffer plain( 4096 );
+    sender.write( std::move( *it ), wire );
+    receiver.read( std::move( wire ), plain );
+    received += plain.getSize();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  if ( received != frame_size * frames * repeats )
+    std::cout << "Lost data : " << received << std::endl;
+
+  return ( (double)received / ( 1024.0 * 1024.0 ) ) / elapsed.count();
+}
+
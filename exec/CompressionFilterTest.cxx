@@ -0,0 +1,193 @@
+
+#include "CompressionFilter.h"
+#include "Buffer.h"
+
+using namespace Stewardess;
+
+
+// Split a buffer into pieces of the given size to mimic partial socket reads
+BufferVector splitBuffer( const Buffer&, size_t );
+
+
+int main( int, char** )
+{
+  CompressionFilter sender( 6, 64, 256, 1 << 20, Microseconds( 0 ) );
+  CompressionFilter receiver( 6, 64, 256, 1 << 20, Microseconds( 0 ) );
+
+  // Both sides hand over their hellos
+  {
+    Buffer plain( 256 );
+
+    std::cout << "Expect Negotiating : " << ( receiver.getState() == CompressionFilter::State::Negotiating ? "Negotiating" : "Other" ) << std::endl;
+
+    Buffer sender_hello( 4 );
+    Buffer receiver_hello( 4 );
+    sender.open( sender_hello );
+    receiver.open( receiver_hello );
+
+    std::cout << "Expect 0 : " << receiver.ready() << std::endl;
+
+    receiver.read( std::move( sender_hello ), plain );
+    sender.read( std::move( receiver_hello ), plain );
+
+    std::cout << "Expect 1 : " << receiver.ready() << std::endl;
+
+    std::cout << "Expect Enabled : " << ( receiver.getState() == CompressionFilter::State::Enabled ? "Enabled" : "Other" ) << std::endl;
+    std::cout << "Expect Enabled : " << ( sender.getState() == CompressionFilter::State::Enabled ? "Enabled" : "Other" ) << std::endl;
+    std::cout << "Expect size 0 : " << plain.getSize() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Compressible frames above the threshold and a small raw frame, read back in awkward pieces
+  {
+    std::string small( "{short}" );
+    std::string large;
+    for ( unsigned i = 0; i < 200; ++i )
+      large += "{\"key\":\"value\",\"number\":12345}";
+
+    Buffer wire( 256 );
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+      Buffer in( 100 );
+      in.push( large );
+      sender.write( std::move( in ), wire );
+    }
+    {
+      Buffer in( 100 );
+      in.push( small );
+      sender.write( std::move( in ), wire );
+    }
+
+    std::cout << "Expect wire smaller than plain : " << wire.getSize() << " < " << 3*large.size() + small.size() << std::endl;
+
+    Buffer plain( 256 );
+    BufferVector pieces = splitBuffer( wire, 7 );
+    bool good = true;
+    for ( BufferVector::iterator it = pieces.begin(); it != pieces.end(); ++it )
+    {
+      good = good && receiver.read( std::move( *it ), plain );
+    }
+
+    std::cout << "Expect 1 : " << good << std::endl;
+    std::cout << "Expect 1 : " << ( plain.getString() == large + large + large + small ) << std::endl;
+
+    CompressionStatistics stats = sender.getStatistics();
+    std::cout << "Expect plain out " << 3*large.size() + small.size() << " : " << stats.plainBytesOut << std::endl;
+    std::cout << "Expect wire out " << wire.getSize() << " : " << stats.wireBytesOut << std::endl;
+    std::cout << "Compression ratio : " << stats.ratioOut() << ", CPU ms/MB : " << stats.compressCPUPerMB() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // A peer that never sends a hello is passed straight through
+  {
+    CompressionFilter plain_receiver( 6, 64, 256, 1 << 20, Microseconds( 0 ) );
+    Buffer in( 100 );
+    std::string message( "{hello}" );
+    in.push( message );
+
+    Buffer plain( 256 );
+    plain_receiver.read( std::move( in ), plain );
+
+    std::cout << "Expect Disabled : " << ( plain_receiver.getState() == CompressionFilter::State::Disabled ? "Disabled" : "Other" ) << std::endl;
+    std::cout << "Expect {hello} : " << plain.getString() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // A peer that never speaks fails the stream after the negotiation timeout
+  {
+    CompressionFilter waiting( 6, 64, 256, 1 << 20, Milliseconds( 50 ) );
+
+    std::cout << "Expect 1 : " << waiting.expire( CoarseClock::now() ) << std::endl;
+    std::cout << "Expect 0 : " << waiting.ready() << std::endl;
+
+    std::cout << "Expect 0 : " << waiting.expire( CoarseClock::now() + Milliseconds( 100 ) ) << std::endl;
+    std::cout << "Expect 0 : " << waiting.ready() << std::endl;
+    std::cout << "Expect 0 : " << waiting.errorEmpty() << std::endl;
+    std::cout << "Expect Compression handshake timed out. : " << waiting.getError() << std::endl;
+    std::cout << "Expect Failed : " << ( waiting.getState() == CompressionFilter::State::Failed ? "Failed" : "Other" ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // A hello that arrives after the deadline is refused, rather than its frames being read as plain data
+  {
+    CompressionFilter late_sender( 6, 64, 256, 1 << 20, Microseconds( 0 ) );
+    CompressionFilter impatient( 6, 64, 256, 1 << 20, Milliseconds( 50 ) );
+
+    impatient.expire( CoarseClock::now() + Milliseconds( 100 ) );
+
+    // The sender saw our hello, so it compresses
+    Buffer sender_hello( 4 );
+    Buffer receiver_hello( 4 );
+    Buffer plain( 256 );
+    late_sender.open( sender_hello );
+    impatient.open( receiver_hello );
+    late_sender.read( std::move( receiver_hello ), plain );
+
+    std::string large;
+    for ( unsigned i = 0; i < 200; ++i )
+      large += "{\"key\":\"value\",\"number\":12345}";
+    Buffer in( 100 );
+    in.push( large );
+    Buffer wire( 256 );
+    wire.append( std::move( sender_hello ) );
+    late_sender.write( std::move( in ), wire );
+
+    std::cout << "Expect 0 : " << impatient.read( std::move( wire ), plain ) << std::endl;
+    std::cout << "Expect size 0 : " << plain.getSize() << std::endl;
+
+    Buffer out( 100 );
+    out.push( large );
+    Buffer refused( 256 );
+    std::cout << "Expect 0 : " << impatient.write( std::move( out ), refused ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // A frame that inflates past the maximum is refused, however small it is on the wire
+  {
+    CompressionFilter bomb_sender( 9, 64, 4096, 1 << 24, Microseconds( 0 ) );
+    CompressionFilter bomb_receiver( 6, 64, 256, 10000, Microseconds( 0 ) );
+
+    Buffer sender_hello( 4 );
+    Buffer receiver_hello( 4 );
+    Buffer plain( 256 );
+    bomb_sender.open( sender_hello );
+    bomb_receiver.open( receiver_hello );
+    bomb_receiver.read( std::move( sender_hello ), plain );
+    bomb_sender.read( std::move( receiver_hello ), plain );
+
+    std::string repeated( 1000000, 'a' );
+    Buffer in( 4096 );
+    in.push( repeated );
+    Buffer wire( 256 );
+    bomb_sender.write( std::move( in ), wire );
+    std::cout << "Expect small wire : " << wire.getSize() << std::endl;
+
+    std::cout << "Expect 0 : " << bomb_receiver.read( std::move( wire ), plain ) << std::endl;
+    std::cout << "Expect 0 : " << bomb_receiver.errorEmpty() << std::endl;
+    std::cout << "Expect 1 : " << ( plain.getSize() <= 10000 ) << std::endl;
+  }
+
+  return 0;
+}
+
+
+BufferVector splitBuffer( const Buffer& buffer, size_t size )
+{
+  BufferVector result;
+  std::string data = buffer.getString();
+
+  for ( size_t start = 0; start < data.size(); start += size )
+  {
+    std::string piece = data.substr( start, size );
+    result.push_back( Buffer( size ) );
+    result.back().push( piece );
+  }
+
+  return result;
+}
+
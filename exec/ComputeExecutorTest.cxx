@@ -0,0 +1,194 @@
+
+#define COMPUTE_PORT 7161
+
+#include "ComputeExecutor.h"
+#include "Manager.h"
+#include "Configuration.h"
+#include "CallbackInterface.h"
+#include "TestSerializer.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <map>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Records the order each connection's payloads reach onRead on the compute pool
+
+class Recorder : public CallbackInterface
+{
+  public:
+    std::mutex mutex;
+    std::map< ConnectionID, std::vector< int > > sequences;
+
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    virtual void onRead( HandleRef handle, Payload* payload ) override
+    {
+      int number = std::stoi( ((TestPayload*)payload)->getMessage() );
+      delete payload;
+
+      GuardLock lk( mutex );
+      sequences[ handle.getConnectionID() ].push_back( number );
+    }
+
+    size_t total()
+    {
+      GuardLock lk( mutex );
+      size_t number = 0;
+      for ( std::map< ConnectionID, std::vector< int > >::iterator it = sequences.begin(); it != sequences.end(); ++it )
+      {
+        number += it->second.size();
+      }
+      return number;
+    }
+};
+
+
+// Wait up to ten seconds for the count to reach the number
+template < class FUNCTION >
+void waitFor( FUNCTION, size_t );
+
+// Open a plain socket to the local port
+int openSocket( int );
+
+
+int main( int, char** )
+{
+  logtastic::init();
+  logtastic::setLogFileDirectory( "./log" );
+  logtastic::setLogFile( "compute_executor_tests.log" );
+  logtastic::setPrintToScreenLimit( logtastic::error );
+  logtastic::setEnableSignalHandling( false );
+  logtastic::start( "Stewardess Compute Executor Test", STEWARDESS_VERSION_STRING );
+
+  // Jobs from several outside threads, half of which queue another job from the pool. Every one runs
+  {
+    const unsigned submitters = 4;
+    const unsigned jobs = 20000;
+    std::atomic< size_t > done( 0 );
+
+    ComputeExecutor executor( 4 );
+    std::vector< std::thread > threads;
+    for ( unsigned t = 0; t < submitters; ++t )
+    {
+      threads.push_back( std::thread( [&executor, &done]()
+      {
+        for ( unsigned i = 0; i < jobs; ++i )
+        {
+          if ( i % 2 == 0 )
+            executor.submit( [&done]() { done += 1; } );
+          else
+            executor.submit( [&executor, &done]() { done += 1; executor.submit( [&done]() { done += 1; } ); } );
+        }
+      } ) );
+    }
+    for ( std::vector< std::thread >::iterator it = threads.begin(); it != threads.end(); ++it )
+    {
+      it->join();
+    }
+
+    waitFor( [&done]() { return done.load(); }, submitters * jobs * 3 / 2 );
+    std::cout << "Expect " << submitters * jobs * 3 / 2 << " : " << done << std::endl;
+    std::cout << "Expect 0 : " << executor.pending() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Payloads from each connection reach onRead in the order they were sent, however many pool threads there are
+  {
+    const unsigned connections = 4;
+    const int messages = 2000;
+
+    Recorder recorder;
+    Configuration config( COMPUTE_PORT );
+    config.setNumberThreads( 2 );
+    config.setNumberComputeThreads( 4 );
+    config.setRequestListener( true );
+    config.setDeathTime( 1 );
+    config.setReadTimeout( 0 );
+
+    Manager manager( config, recorder );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    std::vector< int > sockets;
+    for ( unsigned c = 0; c < connections; ++c )
+    {
+      sockets.push_back( openSocket( COMPUTE_PORT ) );
+    }
+
+    // Interleaved, in small writes, so they arrive in many reads
+    for ( int i = 0; i < messages; i += 10 )
+    {
+      for ( unsigned c = 0; c < connections; ++c )
+      {
+        std::string data;
+        for ( int j = i; j < i + 10; ++j ) data += "{" + std::to_string( j ) + "}";
+        if ( ::write( sockets[c], data.c_str(), data.size() ) != (ssize_t)data.size() ) std::cout << "Short write" << std::endl;
+      }
+    }
+
+    waitFor( [&recorder]() { return recorder.total(); }, connections * messages );
+    std::cout << "Expect " << connections * messages << " : " << recorder.total() << std::endl;
+
+    size_t ordered = 0;
+    {
+      GuardLock lk( recorder.mutex );
+      std::cout << "Expect " << connections << " : " << recorder.sequences.size() << std::endl;
+      for ( std::map< ConnectionID, std::vector< int > >::iterator it = recorder.sequences.begin(); it != recorder.sequences.end(); ++it )
+      {
+        bool in_order = (int)it->second.size() == messages;
+        for ( size_t i = 0; in_order && i < it->second.size(); ++i )
+        {
+          in_order = it->second[i] == (int)i;
+        }
+        if ( in_order ) ordered += 1;
+      }
+    }
+    std::cout << "Expect " << connections << " : " << ordered << std::endl;
+
+    for ( std::vector< int >::iterator it = sockets.begin(); it != sockets.end(); ++it )
+    {
+      ::close( *it );
+    }
+    manager.shutdown();
+    runner.join();
+  }
+
+  logtastic::stop();
+  return 0;
+}
+
+
+template < class FUNCTION >
+void waitFor( FUNCTION count, size_t number )
+{
+  for ( unsigned i = 0; i < 1000 && count() < number; ++i )
+  {
+    std::this_thread::sleep_for( Milliseconds( 10 ) );
+  }
+}
+
+
+int openSocket( int port )
+{
+  int socket_fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons( port );
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+  if ( ::connect( socket_fd, (sockaddr*)&address, sizeof( address ) ) != 0 )
+  {
+    std::cout << "Could not connect to port " << port << std::endl;
+  }
+  return socket_fd;
+}
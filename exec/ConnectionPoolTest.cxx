@@ -0,0 +1,181 @@
+
+#define BACKEND_PORT 7171
+#define CLIENT_PORT 7172
+
+#include "Manager.h"
+#include "Configuration.h"
+#include "CallbackInterface.h"
+#include "TestSerializer.h"
+
+#include <iostream>
+#include <thread>
+#include <future>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// A backend that just accepts connections
+
+class Backend : public CallbackInterface
+{
+  public:
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs the tests from its own thread once the client is up
+
+void runTests( Manager& );
+
+class Client : public CallbackInterface
+{
+  public:
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    virtual void onStart() override
+    {
+      std::thread( [this]() { runTests( manager() ); manager().shutdown(); } ).detach();
+    }
+};
+
+
+// The statistics for the only endpoint
+PoolStatistics statistics( Manager& );
+
+
+int main( int, char** )
+{
+  logtastic::init();
+  logtastic::setLogFileDirectory( "./log" );
+  logtastic::setLogFile( "connection_pool_tests.log" );
+  logtastic::setPrintToScreenLimit( logtastic::error );
+  logtastic::setEnableSignalHandling( false );
+  logtastic::start( "Stewardess Connection Pool Test", STEWARDESS_VERSION_STRING );
+
+  Backend backend;
+  Configuration backend_config( BACKEND_PORT );
+  backend_config.setNumberThreads( 1 );
+  backend_config.setRequestListener( true );
+  backend_config.setDeathTime( 1 );
+  backend_config.setReadTimeout( 0 );
+
+  // One connection kept, two at most, reaped after a second idle. Maintained every tick
+  Client client;
+  Configuration client_config( CLIENT_PORT );
+  client_config.setNumberThreads( 2 );
+  client_config.setRequestListener( false );
+  client_config.setDeathTime( 1 );
+  client_config.setReadTimeout( 0 );
+  client_config.setPoolConnections( 1, 2 );
+  client_config.setPoolIdleTimeout( 1 );
+  client_config.setMinTickTime( 1 );
+
+  Manager backend_manager( backend_config, backend );
+  std::thread backend_thread( [&]() { backend_manager.run(); } );
+  std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+  Manager client_manager( client_config, client );
+  client_manager.run();
+
+  backend_manager.shutdown();
+  backend_thread.join();
+
+  logtastic::stop();
+  return 0;
+}
+
+
+void runTests( Manager& manager )
+{
+  std::string host( "localhost" );
+  std::string port( std::to_string( BACKEND_PORT ) );
+
+  // A returned connection is leased again instead of making a new one
+  Handle first = manager.leaseConnection( host, port ).get();
+  ConnectionID first_id = first.getConnectionID();
+  std::cout << "Expect 1 : " << (bool)first << std::endl;
+  std::cout << "Expect 1 : " << manager.returnConnection( first ) << std::endl;
+  std::cout << "Expect 0 : " << manager.returnConnection( first ) << std::endl;
+  first.release();
+
+  Handle again = manager.leaseConnection( host, port ).get();
+  std::cout << "Expect 1 : " << ( again.getConnectionID() == first_id ) << std::endl;
+  {
+    PoolStatistics stats = statistics( manager );
+    std::cout << "Expect 2 : " << stats.leases << std::endl;
+    std::cout << "Expect 1 : " << stats.reused << std::endl;
+    std::cout << "Expect 1 : " << stats.created << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // At the maximum, leases wait for a connection to come back
+  Handle second = manager.leaseConnection( host, port ).get();
+  std::cout << "Expect 1 : " << (bool)second << std::endl;
+
+  std::future< Handle > waiting = manager.leaseConnection( host, port );
+  std::cout << "Expect 1 : " << ( waiting.wait_for( Milliseconds( 300 ) ) == std::future_status::timeout ) << std::endl;
+  {
+    PoolStatistics stats = statistics( manager );
+    std::cout << "Expect 2 : " << stats.leased << std::endl;
+    std::cout << "Expect 1 : " << stats.waiting << std::endl;
+    std::cout << "Expect 2 : " << stats.created << std::endl;
+  }
+
+  ConnectionID again_id = again.getConnectionID();
+  manager.returnConnection( again );
+  again.release();
+
+  std::cout << "Expect 1 : " << ( waiting.wait_for( Milliseconds( 1000 ) ) == std::future_status::ready ) << std::endl;
+  Handle third = waiting.get();
+  std::cout << "Expect 1 : " << ( third.getConnectionID() == again_id ) << std::endl;
+  std::cout << "Expect 0 : " << statistics( manager ).waiting << std::endl;
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // A lease that closes is forgotten by the next maintenance pass, and can't be returned
+  second.close();
+  std::this_thread::sleep_for( Milliseconds( 2500 ) );
+  {
+    PoolStatistics stats = statistics( manager );
+    std::cout << "Expect 1 : " << stats.leased << std::endl;
+    std::cout << "Expect 0 : " << stats.idle << std::endl;
+  }
+  std::cout << "Expect 0 : " << manager.returnConnection( second ) << std::endl;
+  second.release();
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Idle connections are reaped down to the minimum
+  Handle fourth = manager.leaseConnection( host, port ).get();
+  manager.returnConnection( third );
+  manager.returnConnection( fourth );
+  third.release();
+  fourth.release();
+  {
+    PoolStatistics stats = statistics( manager );
+    std::cout << "Expect 2 : " << stats.idle << std::endl;
+    std::cout << "Expect 0 : " << stats.leased << std::endl;
+  }
+
+  std::this_thread::sleep_for( Milliseconds( 3000 ) );
+  {
+    PoolStatistics stats = statistics( manager );
+    std::cout << "Expect 1 : " << stats.idle << std::endl;
+    std::cout << "Expect 1 : " << stats.reaped << std::endl;
+  }
+}
+
+
+PoolStatistics statistics( Manager& manager )
+{
+  PoolStatisticsVector stats = manager.getPoolStatistics();
+  if ( stats.size() != 1 )
+  {
+    std::cout << "Expected one endpoint, found " << stats.size() << std::endl;
+    return PoolStatistics();
+  }
+  return stats.front();
+}
@@ -0,0 +1,72 @@
+#include "ConnectionTable.h"
+
+#include <random>
+
+using namespace Stewardess;
+
+
+int main( int, char** )
+{
+  ConnectionTable table;
+
+  // Fake connection pointers, aligned like real ones
+  ConnectionID first = 64;
+  ConnectionID second = 128;
+  ConnectionID third = 192;
+
+  {
+    table.insert( first, (Connection*)first );
+    table.insert( second, (Connection*)second );
+    table.insert( third, (Connection*)third );
+
+    std::cout << "Expect 3 : " << table.size() << std::endl;
+    std::cout << "Expect 1 : " << ( table.find( second ) == (Connection*)second ) << std::endl;
+    std::cout << "Expect 1 : " << ( table.find( 256 ) == nullptr ) << std::endl;
+
+    std::cout << "Expect 1 : " << table.erase( second ) << std::endl;
+    std::cout << "Expect 0 : " << table.erase( second ) << std::endl;
+    std::cout << "Expect 1 : " << ( table.find( second ) == nullptr ) << std::endl;
+    std::cout << "Expect 1 : " << ( table.find( third ) == (Connection*)third ) << std::endl;
+    std::cout << "Expect 2 : " << table.size() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Heavy churn checked against a std::map
+  {
+    table.clear();
+    std::map< ConnectionID, Connection* > reference;
+    std::mt19937 generator( 12345 );
+    bool good = true;
+
+    for ( unsigned i = 0; i < 100000 && good; ++i )
+    {
+      ConnectionID id = ( generator() % 5000 + 1 ) * 64;
+      if ( generator() % 2 )
+      {
+        table.insert( id, (Connection*)id );
+        reference[ id ] = (Connection*)id;
+      }
+      else
+      {
+        good = ( table.erase( id ) == ( reference.erase( id ) == 1 ) );
+      }
+    }
+
+    for ( ConnectionID id = 64; id <= 5000*64 && good; id += 64 )
+    {
+      std::map< ConnectionID, Connection* >::iterator found = reference.find( id );
+      good = ( table.find( id ) == ( found == reference.end() ? nullptr : found->second ) );
+    }
+
+    size_t counted = 0;
+    table.forEach( [&counted]( Connection* ) { ++counted; } );
+
+    std::cout << "Expect 1 : " << good << std::endl;
+    std::cout << "Expect " << reference.size() << " : " << table.size() << std::endl;
+    std::cout << "Expect " << reference.size() << " : " << counted << std::endl;
+  }
+
+  return 0;
+}
+
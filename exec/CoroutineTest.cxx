@@ -0,0 +1,197 @@
+
+#define COROUTINE_PORT 7151
+#define CALLBACK_PORT 7152
+
+#include "Manager.h"
+#include "Configuration.h"
+#include "CallbackInterface.h"
+#include "Exception.h"
+#include "TestSerializer.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Echoes every payload from a coroutine, after a short sleep
+
+class Echo : public CallbackInterface
+{
+  private:
+    bool _coroutineReads;
+
+  public:
+    std::atomic< unsigned > callbackReads;
+    std::atomic< unsigned > coroutineReads;
+    std::atomic< unsigned > writes;
+    std::atomic< unsigned > shortSleeps;
+    std::atomic< unsigned > refused;
+    std::atomic< unsigned > finished;
+
+    explicit Echo( bool coroutine_reads ) : _coroutineReads( coroutine_reads ), callbackReads( 0 ), coroutineReads( 0 ), writes( 0 ),
+      shortSleeps( 0 ), refused( 0 ), finished( 0 ) {}
+
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    virtual void onRead( HandleRef, Payload* payload ) override
+    {
+      callbackReads += 1;
+      delete payload;
+    }
+
+    virtual void onConnectionEvent( HandleRef handle, ConnectionEvent event, const char* ) override
+    {
+      if ( event == ConnectionEvent::Connect )
+      {
+        if ( _coroutineReads ) handle.readInCoroutine();
+        _echo( Handle( handle ) );
+      }
+    }
+
+    Task _echo( Handle handle )
+    {
+      try
+      {
+        while ( Payload* payload = co_await handle.read() )
+        {
+          coroutineReads += 1;
+
+          SteadyTime start = std::chrono::steady_clock::now();
+          co_await manager().sleep( Milliseconds( 50 ) );
+          if ( std::chrono::steady_clock::now() - start < Milliseconds( 50 ) ) shortSleeps += 1;
+
+          if ( co_await handle.write( payload ) ) writes += 1;
+          delete payload;
+        }
+        finished += 1;
+      }
+      catch ( Exception& )
+      {
+        refused += 1;
+      }
+    }
+};
+
+
+// Open a plain socket to the local port
+int openSocket( int );
+
+// Read from the socket until the size has arrived or a second has passed
+std::string readSocket( int, size_t );
+
+Configuration makeConfig( int );
+
+
+int main( int, char** )
+{
+  logtastic::init();
+  logtastic::setLogFileDirectory( "./log" );
+  logtastic::setLogFile( "coroutine_tests.log" );
+  logtastic::setPrintToScreenLimit( logtastic::error );
+  logtastic::setEnableSignalHandling( false );
+  logtastic::start( "Stewardess Coroutine Test", STEWARDESS_VERSION_STRING );
+
+  // Payloads sent before the coroutine's first read are queued for it, none reach onRead
+  {
+    Echo echo( true );
+    Manager manager( makeConfig( COROUTINE_PORT ), echo );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    int client = openSocket( COROUTINE_PORT );
+    if ( ::write( client, "{one}{two}{three}", 17 ) != 17 ) std::cout << "Short write" << std::endl;
+
+    std::cout << "Expect {one}{two}{three} : " << readSocket( client, 17 ) << std::endl;
+
+    // The last write resumes its coroutine just after it reaches the socket
+    std::this_thread::sleep_for( Milliseconds( 100 ) );
+    std::cout << "Expect 3 : " << echo.coroutineReads << std::endl;
+    std::cout << "Expect 0 : " << echo.callbackReads << std::endl;
+    std::cout << "Expect 3 : " << echo.writes << std::endl;
+    std::cout << "Expect 0 : " << echo.shortSleeps << std::endl;
+
+    // Closing ends the read loop
+    ::close( client );
+    std::this_thread::sleep_for( Milliseconds( 300 ) );
+    std::cout << "Expect 1 : " << echo.finished << std::endl;
+
+    manager.shutdown();
+    runner.join();
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Without readInCoroutine the payloads stay with onRead, and reads are refused
+  {
+    Echo echo( false );
+    Manager manager( makeConfig( CALLBACK_PORT ), echo );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    int client = openSocket( CALLBACK_PORT );
+    if ( ::write( client, "{one}{two}", 10 ) != 10 ) std::cout << "Short write" << std::endl;
+    std::this_thread::sleep_for( Milliseconds( 300 ) );
+
+    std::cout << "Expect 1 : " << echo.refused << std::endl;
+    std::cout << "Expect 2 : " << echo.callbackReads << std::endl;
+    std::cout << "Expect 0 : " << echo.coroutineReads << std::endl;
+
+    ::close( client );
+    manager.shutdown();
+    runner.join();
+  }
+
+  logtastic::stop();
+  return 0;
+}
+
+
+int openSocket( int port )
+{
+  int socket_fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons( port );
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+  if ( ::connect( socket_fd, (sockaddr*)&address, sizeof( address ) ) != 0 )
+  {
+    std::cout << "Could not connect to port " << port << std::endl;
+  }
+
+  timeval timeout = { 1, 0 };
+  ::setsockopt( socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+  return socket_fd;
+}
+
+
+std::string readSocket( int socket_fd, size_t size )
+{
+  std::string result;
+  char data[ 256 ];
+  while ( result.size() < size )
+  {
+    ssize_t num = ::read( socket_fd, data, sizeof( data ) );
+    if ( num <= 0 ) break;
+    result.append( data, num );
+  }
+  return result;
+}
+
+
+Configuration makeConfig( int port )
+{
+  Configuration config( port );
+  config.setNumberThreads( 1 );
+  config.setRequestListener( true );
+  config.setDeathTime( 1 );
+  config.setReadTimeout( 0 );
+  return config;
+}
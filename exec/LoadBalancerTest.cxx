@@ -0,0 +1,316 @@
+
+#define ECHO_PORT 7131
+#define SILENT_PORT 7132
+#define CLIENT_PORT 7133
+
+#include "Manager.h"
+#include "Configuration.h"
+#include "CallbackInterface.h"
+#include "LoadBalancer.h"
+#include "TestSerializer.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Backends that answer every request straight away, or never answer at all
+
+class Backend : public CallbackInterface
+{
+  private:
+    bool _answer;
+
+  public:
+    explicit Backend( bool answer ) : _answer( answer ) {}
+
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    virtual void onRead( HandleRef handle, Payload* payload ) override
+    {
+      if ( _answer ) handle.write( payload );
+      delete payload;
+    }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs the tests from its own thread once the client is up
+
+void runTests( Manager& );
+
+class Client : public CallbackInterface
+{
+  public:
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    // Only the answers to requests sent without a callback end up here
+    virtual void onRead( HandleRef, Payload* payload ) override { delete payload; }
+
+    virtual void onStart() override
+    {
+      std::thread( [this]() { runTests( manager() ); manager().shutdown(); } ).detach();
+    }
+};
+
+
+// Number of times each connection is picked
+std::vector< unsigned > countPicks( LoadBalancer&, const std::vector< Handle >&, unsigned, const std::string& = std::string() );
+
+
+int main( int, char** )
+{
+  logtastic::init();
+  logtastic::setLogFileDirectory( "./log" );
+  logtastic::setLogFile( "load_balancer_tests.log" );
+  logtastic::setPrintToScreenLimit( logtastic::error );
+  logtastic::setEnableSignalHandling( false );
+  logtastic::start( "Stewardess Load Balancer Test", STEWARDESS_VERSION_STRING );
+
+  Backend echo( true );
+  Configuration echo_config( ECHO_PORT );
+  echo_config.setNumberThreads( 1 );
+  echo_config.setReadTimeout( 0 );
+  echo_config.setRequestListener( true );
+  Manager echo_manager( echo_config, echo );
+
+  Backend silent( false );
+  Configuration silent_config( SILENT_PORT );
+  silent_config.setNumberThreads( 1 );
+  silent_config.setReadTimeout( 0 );
+  silent_config.setRequestListener( true );
+  Manager silent_manager( silent_config, silent );
+
+  std::thread echo_thread( [&]() { echo_manager.run(); } );
+  std::thread silent_thread( [&]() { silent_manager.run(); } );
+  std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+  Client client;
+  Configuration client_config( CLIENT_PORT );
+  client_config.setNumberThreads( 2 );
+  client_config.setReadTimeout( 0 );
+  client_config.setRequestListener( false );
+  client_config.setDeathTime( 1 );
+  Manager client_manager( client_config, client );
+  client_manager.run();
+
+  echo_manager.shutdown();
+  silent_manager.shutdown();
+  echo_thread.join();
+  silent_thread.join();
+
+  logtastic::stop();
+  return 0;
+}
+
+
+void runTests( Manager& manager )
+{
+  TestPayload request( "request" );
+
+  std::vector< Handle > silent;
+  for ( unsigned i = 0; i < 3; ++i ) silent.push_back( manager.connectTo( "127.0.0.1", std::to_string( SILENT_PORT ) ) );
+
+  // Policies. Nothing is answered, so the outstanding counts only go up
+  {
+    LoadBalancer balancer( BalancePolicy::RoundRobin );
+    for ( unsigned i = 0; i < 3; ++i ) balancer.add( silent[i] );
+    balancer.add( silent[0] );
+    std::cout << "Expect 3 : " << balancer.size() << std::endl;
+
+    std::vector< unsigned > picks = countPicks( balancer, silent, 30 );
+    std::cout << "Expect 10 10 10 : " << picks[0] << " " << picks[1] << " " << picks[2] << std::endl;
+  }
+
+  {
+    LoadBalancer balancer( BalancePolicy::LeastOutstanding );
+    for ( unsigned i = 0; i < 3; ++i ) balancer.add( silent[i] );
+
+    for ( unsigned i = 0; i < 9; ++i ) balancer.send( &request );
+    std::cout << "Expect 3 3 3 : " << silent[0].getOutstanding() << " " << silent[1].getOutstanding() << " " << silent[2].getOutstanding() << std::endl;
+  }
+
+  {
+    // Load one connection up past anything the others can reach
+    LoadBalancer single( BalancePolicy::RoundRobin );
+    single.add( silent[0] );
+    for ( unsigned i = 0; i < 40; ++i ) single.send( &request );
+
+    LoadBalancer balancer( BalancePolicy::PowerOfTwoChoices );
+    for ( unsigned i = 0; i < 3; ++i ) balancer.add( silent[i] );
+
+    // Every pair has a less busy connection in it, so the busy one is left alone
+    for ( unsigned i = 0; i < 30; ++i ) balancer.send( &request );
+    std::cout << "Expect 43 : " << silent[0].getOutstanding() << std::endl;
+    std::cout << "Expect 36 : " << silent[1].getOutstanding() + silent[2].getOutstanding() << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Consistent hashing and its load bound, on fresh connections
+  {
+    std::vector< Handle > fresh;
+    for ( unsigned i = 0; i < 3; ++i ) fresh.push_back( manager.connectTo( "127.0.0.1", std::to_string( SILENT_PORT ) ) );
+
+    LoadBalancer balancer( BalancePolicy::ConsistentHash, 1.25 );
+    for ( unsigned i = 0; i < 3; ++i ) balancer.add( fresh[i] );
+
+    ConnectionID owner = balancer.select( "user-1" ).getConnectionID();
+    bool same = true;
+    for ( unsigned i = 0; i < 20; ++i ) same = same && ( balancer.select( "user-1" ).getConnectionID() == owner );
+    std::cout << "Expect 1 : " << same << std::endl;
+
+    std::vector< unsigned > spread = countPicks( balancer, fresh, 300, "key" );
+    std::cout << "Expect 1 : " << ( spread[0] > 0 && spread[1] > 0 && spread[2] > 0 ) << std::endl;
+
+    // One hot key can't put more than 1.25 times the average on its connection
+    Handle hot = balancer.select( "hot" );
+    for ( unsigned i = 0; i < 30; ++i ) balancer.send( &request, "hot" );
+    size_t most = std::max( { fresh[0].getOutstanding(), fresh[1].getOutstanding(), fresh[2].getOutstanding() } );
+    std::cout << "Expect 13 : " << hot.getOutstanding() << std::endl;
+    std::cout << "Expect 13 : " << most << std::endl;
+
+    // Closed connections are dropped and their keys move on
+    ConnectionID closed = fresh[1].getConnectionID();
+    fresh[1].close();
+    std::this_thread::sleep_for( Milliseconds( 100 ) );
+    std::vector< unsigned > after = countPicks( balancer, fresh, 300, "key" );
+    std::cout << "Expect 0 : " << after[1] << std::endl;
+    std::cout << "Expect 2 : " << balancer.size() << std::endl;
+    std::cout << "Expect 1 : " << ( balancer.select( "user-1" ).getConnectionID() != closed ) << std::endl;
+
+    for ( unsigned i = 0; i < 3; ++i ) fresh[i].close();
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Hedging. Requests alternate between a connection that never answers and one that always does
+  {
+    Handle quiet = manager.connectTo( "127.0.0.1", std::to_string( SILENT_PORT ) );
+    Handle echo = manager.connectTo( "127.0.0.1", std::to_string( ECHO_PORT ) );
+
+    std::atomic< unsigned > answers( 0 );
+    std::atomic< unsigned > failures( 0 );
+    ResponseCallback count = [&answers, &failures]( const Handle&, Payload* payload )
+    {
+      if ( payload == nullptr ) failures += 1; else answers += 1;
+      delete payload;
+    };
+
+    {
+      LoadBalancer balancer( BalancePolicy::RoundRobin );
+      balancer.add( quiet );
+      balancer.add( echo );
+      balancer.setHedging( 0.5, 0.01 );
+
+      // Half the requests are answered, enough to set the hedge delay
+      for ( unsigned i = 0; i < 64; ++i )
+      {
+        balancer.request( new TestPayload( "request" ), count );
+        while ( answers < ( i + 1 ) / 2 ) std::this_thread::sleep_for( Milliseconds( 1 ) );
+      }
+      std::cout << "Expect 32 : " << answers << std::endl;
+      std::cout << "Expect 1 : " << ( balancer.getHedgeDelay().count() > 0 ) << std::endl;
+      std::cout << "Expect 0 : " << balancer.getNumberHedges() << std::endl;
+
+      // Too slow, but the budget has only saved up part of a hedge
+      balancer.request( new TestPayload( "request" ), count );
+      std::this_thread::sleep_for( Milliseconds( 100 ) );
+      std::cout << "Expect 0 : " << balancer.getNumberHedges() << std::endl;
+
+      // A full hedge's worth. The next request goes to the quiet connection and is hedged once
+      balancer.setHedging( 0.5, 1.0 );
+      balancer.select();
+
+      std::atomic< unsigned > calls( 0 );
+      std::atomic< ConnectionID > answered( 0 );
+      balancer.request( new TestPayload( "request" ), [&calls, &answered]( const Handle& handle, Payload* payload )
+      {
+        calls += 1;
+        answered = handle.getConnectionID();
+        delete payload;
+      } );
+      std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+      std::cout << "Expect 1 : " << balancer.getNumberHedges() << std::endl;
+      std::cout << "Expect 1 : " << balancer.getNumberHedgeWins() << std::endl;
+      std::cout << "Expect 1 : " << calls << std::endl;
+      std::cout << "Expect 1 : " << ( answered == echo.getConnectionID() ) << std::endl;
+      std::cout << "Expect 66 : " << balancer.getNumberRequests() << std::endl;
+
+      // The unanswered attempts fail when the connection closes. The hedged one has already answered
+      quiet.close();
+      std::this_thread::sleep_for( Milliseconds( 200 ) );
+      std::cout << "Expect 33 : " << failures << std::endl;
+      std::cout << "Expect 1 : " << calls << std::endl;
+    }
+
+    echo.close();
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Outlier detection: eject, probe while half open, then restore or eject for longer
+  {
+    OutlierSettings settings;
+    settings.baseEjectionTime = Milliseconds( 300 );
+    settings.maxEjectionTime = Milliseconds( 3000 );
+
+    LoadBalancer balancer( BalancePolicy::RoundRobin );
+    for ( unsigned i = 0; i < 3; ++i ) balancer.add( silent[i] );
+    balancer.setOutlierDetection( settings );
+
+    for ( unsigned i = 0; i < 5; ++i ) balancer.reportFailure( silent[2] );
+    std::cout << "Expect 1 : " << balancer.getNumberEjected() << std::endl;
+    std::cout << "Expect 0 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+
+    // Half of three is already ejected
+    for ( unsigned i = 0; i < 5; ++i ) balancer.reportFailure( silent[1] );
+    std::cout << "Expect 1 : " << balancer.getNumberEjected() << std::endl;
+    std::cout << "Expect 1 : " << balancer.getNumberEjections() << std::endl;
+
+    // Only one probe goes through while half open
+    std::this_thread::sleep_for( Milliseconds( 400 ) );
+    std::cout << "Expect 1 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+    std::cout << "Expect 1 : " << balancer.getNumberEjected() << std::endl;
+
+    balancer.reportSuccess( silent[2] );
+    std::cout << "Expect 0 : " << balancer.getNumberEjected() << std::endl;
+    std::cout << "Expect 10 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+
+    // A failed probe ejects it again for twice as long
+    for ( unsigned i = 0; i < 5; ++i ) balancer.reportFailure( silent[2] );
+    std::this_thread::sleep_for( Milliseconds( 400 ) );
+    std::cout << "Expect 1 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+    balancer.reportFailure( silent[2] );
+    std::cout << "Expect 3 : " << balancer.getNumberEjections() << std::endl;
+
+    std::this_thread::sleep_for( Milliseconds( 400 ) );
+    std::cout << "Expect 0 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+    std::this_thread::sleep_for( Milliseconds( 300 ) );
+    std::cout << "Expect 1 : " << countPicks( balancer, silent, 30 )[2] << std::endl;
+  }
+
+  for ( unsigned i = 0; i < 3; ++i ) silent[i].close();
+  std::this_thread::sleep_for( Milliseconds( 100 ) );
+}
+
+
+std::vector< unsigned > countPicks( LoadBalancer& balancer, const std::vector< Handle >& handles, unsigned number, const std::string& key )
+{
+  std::vector< unsigned > picks( handles.size(), 0 );
+  for ( unsigned i = 0; i < number; ++i )
+  {
+    ConnectionID id = balancer.select( key.empty() ? key : key + std::to_string( i ) ).getConnectionID();
+    for ( size_t j = 0; j < handles.size(); ++j )
+    {
+      if ( handles[j].getConnectionID() == id ) picks[j] += 1;
+    }
+  }
+  return picks;
+}
+
@@ -0,0 +1,189 @@
+#include "Resolver.h"
+
+#include <event2/dns_struct.h>
+#include <fstream>
+#include <algorithm>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Stub DNS server answering from a fixed zone
+
+struct StubServer
+{
+  unsigned questions = 0;
+};
+
+
+void stubServerCB( evdns_server_request* request, void* arg )
+{
+  StubServer* server = (StubServer*)arg;
+  int error = DNS_ERR_NOTEXIST;
+
+  for ( int i = 0; i < request->nquestions; ++i )
+  {
+    const evdns_server_question* question = request->questions[i];
+    server->questions += 1;
+
+    // evdns randomizes the case of the names it sends
+    std::string name( question->name );
+    std::transform( name.begin(), name.end(), name.begin(), []( unsigned char c ) { return std::tolower( c ); } );
+
+    if ( name == "cached.test" )
+    {
+      error = DNS_ERR_NONE;
+      if ( question->type == EVDNS_TYPE_A )
+      {
+        unsigned char address[4] = { 10, 0, 0, 1 };
+        evdns_server_request_add_a_reply( request, question->name, 1, address, 2 );
+      }
+    }
+    else if ( name == "six.test" )
+    {
+      // No IPv4 address, so the resolver has to ask again
+      error = DNS_ERR_NONE;
+      if ( question->type == EVDNS_TYPE_AAAA )
+      {
+        unsigned char address[16] = { 0 };
+        address[15] = 1;
+        evdns_server_request_add_aaaa_reply( request, question->name, 1, address, 60 );
+      }
+    }
+  }
+
+  evdns_server_request_respond( request, error );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Resolve and run the loop until the answer arrives
+
+AddressVector resolveAndWait( Resolver& resolver, event_base* base, const std::string& name )
+{
+  bool done = false;
+  AddressVector result;
+  resolver.resolve( name, [&done, &result]( const AddressVector& addresses ) { result = addresses; done = true; } );
+
+  std::chrono::steady_clock::time_point give_up = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+  while ( ! done && std::chrono::steady_clock::now() < give_up )
+  {
+    event_base_loop( base, EVLOOP_ONCE | EVLOOP_NONBLOCK );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  return result;
+}
+
+
+std::string addressString( const AddressVector& addresses )
+{
+  if ( addresses.empty() ) return "none";
+
+  char text[ INET6_ADDRSTRLEN ];
+  const sockaddr_storage& address = addresses.front();
+  if ( address.ss_family == AF_INET )
+    evutil_inet_ntop( AF_INET, &((const sockaddr_in*)&address)->sin_addr, text, sizeof( text ) );
+  else
+    evutil_inet_ntop( AF_INET6, &((const sockaddr_in6*)&address)->sin6_addr, text, sizeof( text ) );
+  return std::string( text );
+}
+
+
+int main( int, char** )
+{
+  event_base* base = event_base_new();
+
+  // Bind the stub server to any free local port
+  StubServer server;
+  evutil_socket_t server_socket = socket( AF_INET, SOCK_DGRAM, 0 );
+  sockaddr_in server_address;
+  memset( &server_address, 0, sizeof( server_address ) );
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  bind( server_socket, (sockaddr*)&server_address, sizeof( server_address ) );
+  socklen_t length = sizeof( server_address );
+  getsockname( server_socket, (sockaddr*)&server_address, &length );
+  evutil_make_socket_nonblocking( server_socket );
+  evdns_server_port* port = evdns_add_server_port_with_base( base, server_socket, 0, stubServerCB, &server );
+
+  std::string hosts_file = "/tmp/stewardess_resolver_test_hosts";
+  {
+    std::ofstream hosts( hosts_file );
+    hosts << "# Comment line\n192.168.1.5   static.test  Alias.Test\n";
+  }
+
+  ConfigurationData config;
+  config.nameServers.push_back( "127.0.0.1:" + std::to_string( ntohs( server_address.sin_port ) ) );
+  config.hostsFile = hosts_file;
+  config.dnsNegativeTTL = 60;
+  config.dnsRefreshAhead = 0.5;
+
+  {
+    Resolver resolver( base, config );
+
+    // Numeric addresses and the hosts file never reach the server
+    std::cout << "Expect 127.0.0.1 : " << addressString( resolveAndWait( resolver, base, "127.0.0.1" ) ) << std::endl;
+    std::cout << "Expect ::1 : " << addressString( resolveAndWait( resolver, base, "::1" ) ) << std::endl;
+    std::cout << "Expect 192.168.1.5 : " << addressString( resolveAndWait( resolver, base, "static.test" ) ) << std::endl;
+    std::cout << "Expect 192.168.1.5 : " << addressString( resolveAndWait( resolver, base, "ALIAS.test" ) ) << std::endl;
+    std::cout << "Expect 0 : " << server.questions << std::endl;
+
+    std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+    // The second lookup comes from the cache
+    std::cout << "Expect 10.0.0.1 : " << addressString( resolveAndWait( resolver, base, "cached.test" ) ) << std::endl;
+    std::cout << "Expect 1 : " << server.questions << std::endl;
+    std::cout << "Expect 10.0.0.1 : " << addressString( resolveAndWait( resolver, base, "Cached.Test" ) ) << std::endl;
+    std::cout << "Expect 1 : " << server.questions << std::endl;
+
+    AddressVector found;
+    std::cout << "Expect 1 : " << resolver.lookup( "cached.test", found ) << std::endl;
+    std::cout << "Expect 0 : " << resolver.lookup( "unknown.test", found ) << std::endl;
+
+    std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+    // Half way through the two second TTL a lookup is answered from the cache and refreshed in the background
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1200 ) );
+    std::cout << "Expect 10.0.0.1 : " << addressString( resolveAndWait( resolver, base, "cached.test" ) ) << std::endl;
+    std::chrono::steady_clock::time_point give_up = std::chrono::steady_clock::now() + std::chrono::milliseconds( 500 );
+    while ( std::chrono::steady_clock::now() < give_up )
+    {
+      event_base_loop( base, EVLOOP_ONCE | EVLOOP_NONBLOCK );
+    }
+    std::cout << "Expect 2 : " << server.questions << std::endl;
+
+    // The refreshed answer outlives the original TTL
+    std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+    std::cout << "Expect 1 : " << resolver.lookup( "cached.test", found ) << std::endl;
+
+    std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+    // Failures are remembered for the negative TTL
+    unsigned before = server.questions;
+    std::cout << "Expect none : " << addressString( resolveAndWait( resolver, base, "missing.test" ) ) << std::endl;
+    std::cout << "Expect none : " << addressString( resolveAndWait( resolver, base, "missing.test" ) ) << std::endl;
+    std::cout << "Expect 1 : " << server.questions - before << std::endl;
+
+    // Names without an IPv4 address fall back to IPv6
+    std::cout << "Expect ::1 : " << addressString( resolveAndWait( resolver, base, "six.test" ) ) << std::endl;
+
+    std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+    // Ports are numbers or service names
+    sockaddr_storage address;
+    memset( &address, 0, sizeof( address ) );
+    address.ss_family = AF_INET;
+    std::cout << "Expect 1 : " << Resolver::setPort( address, "8080" ) << std::endl;
+    std::cout << "Expect 8080 : " << ntohs( ((sockaddr_in*)&address)->sin_port ) << std::endl;
+    std::cout << "Expect 0 : " << Resolver::setPort( address, "not-a-service" ) << std::endl;
+    std::cout << "Expect 0 : " << Resolver::setPort( address, "70000" ) << std::endl;
+  }
+
+  evdns_close_server_port( port );
+  EVUTIL_CLOSESOCKET( server_socket );
+  event_base_free( base );
+  std::remove( hosts_file.c_str() );
+
+  return 0;
+}
+
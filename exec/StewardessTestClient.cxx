@@ -34,9 +34,12 @@ int main( int, char** )
   config.setDefaultBufferSize( 4096 );
   config.setReadTimeout( 0 );
   config.setWriteTimeout( 1 );
+  config.setConnectTimeout( 2 );
   config.setDeathTime( 1 );
   config.setTickTimeModifier( 1.0 );
   config.setCloseConnectionsOnShutdown( true );
+  config.setRequestCompression( true );
+  config.setFrameChecksum( true );
 
 
   std::cout << "Building client" << std::endl;
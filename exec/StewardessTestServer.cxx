@@ -31,13 +31,18 @@ int main( int, char** )
 
   // Configure the config
   config.setNumberThreads( 2 );
+  config.setNumberComputeThreads( 2 );
   config.setDefaultBufferSize( 4096 );
   config.setReadTimeout( 0 );
   config.setWriteTimeout( 1 );
   config.setDeathTime( 1 );
   config.setTickTimeModifier( 1.0 );
   config.setCloseConnectionsOnShutdown( true );
+  config.setRequestCompression( true );
+  config.setFrameChecksum( true );
   config.setRequestListener( true );
+  config.setReusePortListeners( true );
+  config.setPinThreads( true );
 
 
   std::cout << "Building server" << std::endl;
@@ -0,0 +1,190 @@
+
+#define READ_PORT 7141
+#define IDLE_PORT 7142
+#define WRITE_PORT 7143
+
+#include "Manager.h"
+#include "Configuration.h"
+#include "CallbackInterface.h"
+#include "TestSerializer.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using namespace Stewardess;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Records the timeouts, and can flood new connections with more than the socket will take
+
+class Recorder : public CallbackInterface
+{
+  private:
+    bool _flood;
+
+  public:
+    std::mutex mutex;
+    std::vector< std::string > timeouts;
+    std::atomic< unsigned > payloads;
+
+    explicit Recorder( bool flood = false ) : _flood( flood ), mutex(), timeouts(), payloads( 0 ) {}
+
+    virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
+
+    virtual void onRead( HandleRef, Payload* payload ) override
+    {
+      payloads += 1;
+      delete payload;
+    }
+
+    virtual void onConnectionEvent( HandleRef handle, ConnectionEvent event, const char* message ) override
+    {
+      if ( event == ConnectionEvent::Connect && _flood )
+      {
+        TestPayload big( std::string( 1024*1024, 'x' ) );
+        for ( unsigned i = 0; i < 64; ++i ) handle.write( &big );
+      }
+      else if ( event == ConnectionEvent::Timeout )
+      {
+        GuardLock lk( mutex );
+        timeouts.push_back( message );
+      }
+    }
+
+    size_t total()
+    {
+      GuardLock lk( mutex );
+      return timeouts.size();
+    }
+
+    size_t count( const std::string& message )
+    {
+      GuardLock lk( mutex );
+      size_t number = 0;
+      for ( std::vector< std::string >::iterator it = timeouts.begin(); it != timeouts.end(); ++it )
+      {
+        if ( *it == message ) number += 1;
+      }
+      return number;
+    }
+};
+
+
+// Open a plain socket to the local port
+int openSocket( int );
+
+// Timeouts of a second, with the others disabled
+Configuration makeConfig( int, unsigned, unsigned, unsigned );
+
+
+int main( int, char** )
+{
+  logtastic::init();
+  logtastic::setLogFileDirectory( "./log" );
+  logtastic::setLogFile( "timeout_tests.log" );
+  logtastic::setPrintToScreenLimit( logtastic::error );
+  logtastic::setEnableSignalHandling( false );
+  logtastic::start( "Stewardess Timeout Test", STEWARDESS_VERSION_STRING );
+
+  // Read timeout: a connection that never sends anything is closed, one that keeps sending is not
+  {
+    Recorder recorder;
+    Manager manager( makeConfig( READ_PORT, 1, 0, 0 ), recorder );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    int quiet = openSocket( READ_PORT );
+    int chatty = openSocket( READ_PORT );
+    for ( unsigned i = 0; i < 10; ++i )
+    {
+      if ( ::write( chatty, "{ping}", 6 ) != 6 ) std::cout << "Short write" << std::endl;
+      std::this_thread::sleep_for( Milliseconds( 250 ) );
+    }
+
+    std::cout << "Expect 1 : " << recorder.count( "Timed out waiting to read" ) << std::endl;
+    std::cout << "Expect 1 : " << recorder.total() << std::endl;
+    std::cout << "Expect 10 : " << recorder.payloads << std::endl;
+
+    ::close( quiet );
+    ::close( chatty );
+    manager.shutdown();
+    runner.join();
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Idle timeout: nothing read or written
+  {
+    Recorder recorder;
+    Manager manager( makeConfig( IDLE_PORT, 0, 0, 1 ), recorder );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    int quiet = openSocket( IDLE_PORT );
+    std::this_thread::sleep_for( Milliseconds( 600 ) );
+    std::cout << "Expect 0 : " << recorder.total() << std::endl;
+    std::this_thread::sleep_for( Milliseconds( 1500 ) );
+    std::cout << "Expect 1 : " << recorder.count( "Idle for too long" ) << std::endl;
+
+    ::close( quiet );
+    manager.shutdown();
+    runner.join();
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Write timeout: the peer never reads, so the socket fills up and stays full
+  {
+    Recorder recorder( true );
+    Manager manager( makeConfig( WRITE_PORT, 0, 1, 0 ), recorder );
+    std::thread runner( [&]() { manager.run(); } );
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+
+    int stuck = openSocket( WRITE_PORT );
+    std::this_thread::sleep_for( Milliseconds( 2500 ) );
+    std::cout << "Expect 1 : " << recorder.count( "Timed out waiting to write" ) << std::endl;
+    std::cout << "Expect 1 : " << recorder.total() << std::endl;
+
+    ::close( stuck );
+    manager.shutdown();
+    runner.join();
+  }
+
+  logtastic::stop();
+  return 0;
+}
+
+
+int openSocket( int port )
+{
+  int socket_fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons( port );
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+  if ( ::connect( socket_fd, (sockaddr*)&address, sizeof( address ) ) != 0 )
+  {
+    std::cout << "Could not connect to port " << port << std::endl;
+  }
+  return socket_fd;
+}
+
+
+Configuration makeConfig( int port, unsigned read, unsigned write, unsigned idle )
+{
+  Configuration config( port );
+  config.setNumberThreads( 1 );
+  config.setRequestListener( true );
+  config.setDeathTime( 1 );
+  config.setReadTimeout( read );
+  config.setWriteTimeout( write );
+  config.setIdleTimeout( idle );
+  return config;
+}
+
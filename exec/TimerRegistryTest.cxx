@@ -0,0 +1,78 @@
+#include "TimerRegistry.h"
+#include "TimerData.h"
+
+#include <atomic>
+
+using namespace Stewardess;
+
+
+int main( int, char** )
+{
+  TimerRegistry registry;
+
+  {
+    TimerData* first = new TimerData( nullptr, 1, false );
+    TimerData* zero = new TimerData( nullptr, 0, false );
+    TimerData* negative = new TimerData( nullptr, -5, true );
+
+    std::cout << "Expect 1 : " << registry.insert( 1, first ) << std::endl;
+    std::cout << "Expect 1 : " << registry.insert( 0, zero ) << std::endl;
+    std::cout << "Expect 1 : " << registry.insert( -5, negative ) << std::endl;
+
+    TimerData* duplicate = new TimerData( nullptr, 1, false );
+    std::cout << "Expect 0 : " << registry.insert( 1, duplicate ) << std::endl;
+    delete duplicate;
+
+    std::cout << "Expect 1 : " << ( registry.find( 1 ) == first ) << std::endl;
+    std::cout << "Expect 1 : " << ( registry.find( 0 ) == zero ) << std::endl;
+    std::cout << "Expect 1 : " << ( registry.find( -5 ) == negative ) << std::endl;
+    std::cout << "Expect 1 : " << ( registry.find( 2 ) == nullptr ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  // Readers keep finding every timer while the table grows underneath them
+  {
+    registry.clear();
+    const UniqueID number = 20000;
+    std::atomic< UniqueID > added( 0 );
+    std::atomic_bool stop( false );
+    std::atomic< unsigned > missing( 0 );
+
+    std::vector< std::thread > readers;
+    for ( unsigned i = 0; i < 4; ++i )
+    {
+      readers.push_back( std::thread( [&]()
+      {
+        while ( ! stop )
+        {
+          UniqueID limit = added.load();
+          for ( UniqueID id = 0; id < limit; id += 7 )
+          {
+            TimerData* timer = registry.find( id * 1000 );
+            if ( timer == nullptr || timer->timerID != id * 1000 ) missing += 1;
+          }
+        }
+      } ) );
+    }
+
+    for ( UniqueID id = 0; id < number; ++id )
+    {
+      registry.insert( id * 1000, new TimerData( nullptr, id * 1000, false ) );
+      added.store( id + 1 );
+    }
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    stop = true;
+    for ( std::vector< std::thread >::iterator it = readers.begin(); it != readers.end(); ++it ) it->join();
+
+    unsigned found = 0;
+    for ( UniqueID id = 0; id < number; ++id ) found += ( registry.find( id * 1000 ) != nullptr );
+    std::cout << "Expect " << number << " : " << found << std::endl;
+    std::cout << "Expect 0 : " << missing.load() << std::endl;
+  }
+
+  registry.clear();
+  std::cout << "Expect 1 : " << ( registry.find( 0 ) == nullptr ) << std::endl;
+
+  return 0;
+}
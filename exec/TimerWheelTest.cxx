@@ -0,0 +1,189 @@
+#include "TimerWheel.h"
+#include "WorkerThread.h"
+
+#include <random>
+#include <algorithm>
+
+using namespace Stewardess;
+
+typedef std::chrono::steady_clock Clock;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Records when each timer fired
+
+struct Record
+{
+  WheelTimer timer;
+  Clock::time_point due;
+  Clock::time_point fired;
+  unsigned count = 0;
+};
+
+
+void recordCB( void* arg )
+{
+  Record* record = (Record*)arg;
+  record->fired = Clock::now();
+  record->count += 1;
+}
+
+
+// Arm every record from the calling thread
+void armAll( TimerWheel& wheel, std::vector< Record >& records, std::vector< unsigned >& delays, Milliseconds slack = Milliseconds( 0 ) )
+{
+  for ( size_t i = 0; i < records.size(); ++i )
+  {
+    records[i].timer.setCallback( recordCB, (void*)&records[i] );
+    records[i].due = Clock::now() + Milliseconds( delays[i] );
+    wheel.arm( &records[i].timer, Milliseconds( delays[i] ), slack );
+  }
+}
+
+
+// Wait until the number of timers have fired or the time is up
+unsigned waitFired( std::vector< Record >& records, unsigned number, Milliseconds limit )
+{
+  Clock::time_point give_up = Clock::now() + limit;
+  unsigned fired = 0;
+  while ( Clock::now() < give_up )
+  {
+    std::this_thread::sleep_for( Milliseconds( 5 ) );
+    fired = 0;
+    for ( size_t i = 0; i < records.size(); ++i ) fired += records[i].count;
+    if ( fired >= number ) break;
+  }
+  return fired;
+}
+
+
+int main( int, char** )
+{
+  WorkerData worker;
+  worker.manager = nullptr;
+  worker.eventBase = event_base_new();
+  openWorkerInbox( &worker );
+  worker.timers = new TimerWheel( &worker );
+
+  std::atomic_bool stop( false );
+  std::thread loop( [&worker, &stop]()
+  {
+    setCurrentWorker( &worker );
+    while ( ! stop )
+    {
+      event_base_loop( worker.eventBase, EVLOOP_ONCE );
+    }
+  } );
+
+  TimerWheel& wheel = *worker.timers;
+  std::mt19937 generator( 12345 );
+
+  {
+    // Many timers armed from another thread, spread over the first two levels
+    std::vector< Record > records( 1000 );
+    std::vector< unsigned > delays( records.size() );
+    std::uniform_int_distribution< unsigned > distribution( 1, 300 );
+    for ( size_t i = 0; i < delays.size(); ++i ) delays[i] = distribution( generator );
+
+    armAll( wheel, records, delays );
+    unsigned fired = waitFired( records, 1000, Milliseconds( 2000 ) );
+
+    unsigned early = 0;
+    Milliseconds latest( 0 );
+    for ( size_t i = 0; i < records.size(); ++i )
+    {
+      if ( records[i].fired < records[i].due ) early += 1;
+      latest = std::max( latest, std::chrono::duration_cast< Milliseconds >( records[i].fired - records[i].due ) );
+    }
+    std::cout << "Expect 1000 : " << fired << std::endl;
+    std::cout << "Expect 0 : " << early << std::endl;
+    std::cout << "Expect 1 : " << ( latest < Milliseconds( 20 ) ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  {
+    // Cancel half of them and move a quarter later
+    std::vector< Record > records( 100 );
+    std::vector< unsigned > delays( records.size(), 100 );
+    armAll( wheel, records, delays );
+    std::this_thread::sleep_for( Milliseconds( 10 ) );
+    std::cout << "Expect 100 : " << wheel.size() << std::endl;
+
+    for ( size_t i = 0; i < 50; ++i ) wheel.cancel( &records[i].timer );
+    for ( size_t i = 50; i < 75; ++i )
+    {
+      records[i].due = Clock::now() + Milliseconds( 300 );
+      wheel.arm( &records[i].timer, Milliseconds( 300 ) );
+    }
+
+    std::this_thread::sleep_for( Milliseconds( 200 ) );
+    unsigned fired = 0;
+    for ( size_t i = 0; i < records.size(); ++i ) fired += records[i].count;
+    std::cout << "Expect 25 : " << fired << std::endl;
+
+    fired = waitFired( records, 50, Milliseconds( 1000 ) );
+    std::this_thread::sleep_for( Milliseconds( 50 ) );
+    unsigned early = 0;
+    for ( size_t i = 0; i < records.size(); ++i )
+    {
+      if ( records[i].count > 0 && records[i].fired < records[i].due ) early += 1;
+    }
+    std::cout << "Expect 50 : " << fired << std::endl;
+    std::cout << "Expect 0 : " << early << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  {
+    // With slack the expiries are rounded up to a multiple of 64 ms. Spread over 32 ms they share at most two ticks
+    std::vector< Record > records( 64 );
+    std::vector< unsigned > delays( records.size() );
+    for ( size_t i = 0; i < delays.size(); ++i ) delays[i] = 200 + i % 32;
+
+    armAll( wheel, records, delays, Milliseconds( 64 ) );
+    std::cout << "Expect 64 : " << waitFired( records, 64, Milliseconds( 1000 ) ) << std::endl;
+
+    std::vector< Clock::time_point > times;
+    for ( size_t i = 0; i < records.size(); ++i ) times.push_back( records[i].fired );
+    std::sort( times.begin(), times.end() );
+
+    unsigned groups = 1;
+    for ( size_t i = 1; i < times.size(); ++i )
+    {
+      if ( times[i] - times[i-1] > Milliseconds( 5 ) ) groups += 1;
+    }
+    std::cout << "Expect 1 : " << ( groups <= 2 ) << std::endl;
+  }
+
+  std::cout << "\n----------------------------------------------------------------------------------------------------\n" << std::endl;
+
+  {
+    // Timers past the first level are cascaded down, and ones past the last wait in the overflow
+    std::vector< Record > records( 2 );
+    std::vector< unsigned > delays = { 5000, 20000000 };
+    armAll( wheel, records, delays );
+    std::this_thread::sleep_for( Milliseconds( 10 ) );
+    std::cout << "Expect 2 : " << wheel.size() << std::endl;
+
+    std::this_thread::sleep_for( Milliseconds( 5200 ) );
+    std::cout << "Expect 1 : " << records[0].count << std::endl;
+    std::cout << "Expect 1 : " << ( records[0].fired >= records[0].due ) << std::endl;
+    std::cout << "Expect 0 : " << records[1].count << std::endl;
+
+    wheel.cancel( &records[1].timer );
+    std::this_thread::sleep_for( Milliseconds( 10 ) );
+    std::cout << "Expect 0 : " << wheel.size() << std::endl;
+  }
+
+  stop = true;
+  signalWorkerInbox( &worker );
+  loop.join();
+
+  delete worker.timers;
+  closeWorkerInbox( &worker );
+  event_base_free( worker.eventBase );
+
+  return 0;
+}
+
@@ -22,8 +22,12 @@ namespace Stewardess
 
         Chunk* next;
 
+        // First char still in the chunk. Moves forward when the front is split off
         char* data;
 
+        // The allocation itself
+        char* memory;
+
         // Construct empty
         explicit Chunk( size_t );
         // Aquire character array
@@ -64,6 +68,15 @@ namespace Stewardess
           // Increment the iterators position
           void operator++() { this->increment(); }
 
+          // Pointer to the current position in the current chunk
+          const char* data() const;
+
+          // Number of chars left in the current chunk
+          size_t remaining() const;
+
+          // Move forward by a number of chars, skipping between chunks as required
+          void advance( size_t );
+
           // Return true while the iterator is valid
           operator bool() const;
       };
@@ -91,7 +104,7 @@ namespace Stewardess
       Buffer& operator=( const Buffer& );
 
       // Move the data pointers
-      Buffer( Buffer&& ) = default;
+      Buffer( Buffer&& );
       Buffer& operator=( Buffer&& );
 
       // Destructor
@@ -130,6 +143,18 @@ namespace Stewardess
 
 
 
+      // Move all the chunks from another buffer onto the end of this one. No data is copied
+      void append( Buffer&& );
+
+      // Move the first chars from another buffer onto the end of this one. Whole chunks are moved,
+      //  a chunk that is split has its smaller part copied
+      void splice( Buffer&, size_t );
+
+      // Remove chars from the front, deleting chunks as they empty
+      void skip( size_t );
+
+
+
       // Interface for reading from sockets!
       // Adds a chunk based on the allocated character array
       void pushChunk( char*, size_t );
@@ -0,0 +1,31 @@
+
+#ifndef STEWARDESS_CRC32C_H_
+#define STEWARDESS_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Stewardess
+{
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // CRC32C (Castagnoli) checksums.
+  // Each function continues from a previous crc value, start with 0.
+
+  // Uses the SSE4.2 crc32 instruction when the CPU has it, otherwise the table version
+  uint32_t crc32c( uint32_t, const char*, size_t );
+
+  // Slicing-by-8 table implementation. Works everywhere
+  uint32_t crc32cSoftware( uint32_t, const char*, size_t );
+
+  // SSE4.2 implementation. Only call this if crc32cHardwareAvailable() is true
+  uint32_t crc32cHardware( uint32_t, const char*, size_t );
+
+  // Returns true if the CPU supports the SSE4.2 crc32 instruction
+  bool crc32cHardwareAvailable();
+
+}
+
+#endif // STEWARDESS_CRC32C_H_
+
@@ -36,6 +36,10 @@ namespace Stewardess
       virtual Serializer* buildSerializer() const = 0;
 
 
+      // Append new'd filters to transform each connection's byte stream. The first is closest to the serializer
+      virtual void buildFilters( FilterVector& ) const {}
+
+
       // Called when the server first starts for initialisation functions
       virtual void onStart() {}
 
@@ -44,16 +48,19 @@ namespace Stewardess
       virtual void onStop() {}
 
 
+      // The connection callbacks borrow the connection for the length of the call.
+      //  Construct a Handle from the reference to keep it any longer
+
       // Called when a read event is triggered.
-      virtual void onRead( Handle, Payload* ) {}
+      virtual void onRead( HandleRef, Payload* ) {}
 
 
       // Called when a write event is triggered
-      virtual void onWrite( Handle ) {}
+      virtual void onWrite( HandleRef ) {}
 
 
       // Called when a connection event occurs
-      virtual void onConnectionEvent( Handle, ConnectionEvent, const char* = nullptr ) {}
+      virtual void onConnectionEvent( HandleRef, ConnectionEvent, const char* = nullptr ) {}
 
 
       // Called when a server event occurs
@@ -67,6 +74,10 @@ namespace Stewardess
       // Called when a user timer expires
       virtual void onTimer( UniqueID ) {}
 
+
+      // Called on the connection's worker thread when a timer started through its handle expires
+      virtual void onConnectionTimer( HandleRef, UniqueID ) {}
+
   };
 
 }
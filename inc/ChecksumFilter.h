@@ -0,0 +1,72 @@
+
+#ifndef STEWARDESS_CHECKSUM_FILTER_H_
+#define STEWARDESS_CHECKSUM_FILTER_H_
+
+#include "Definitions.h"
+#include "Filter.h"
+#include "Buffer.h"
+
+
+namespace Stewardess
+{
+
+  /*
+   * CRC32C integrity stage for a connection's filter chain.
+   *
+   * Every buffer written is sent as a frame: 4 char big-endian length, the body,
+   *  then a 4 char big-endian CRC32C of the length and body. Buffers larger than the
+   *  maximum frame size are sent as several frames.
+   * Bodies are moved between buffers rather than copied, only a chunk shared with the
+   *  framing or another frame is split.
+   * Frames that fail the check are dropped and reported as serialization errors.
+   * A length that is too big to be real means the stream can't be trusted and the connection is closed.
+   * There is no handshake, both ends must enable it.
+   */
+  class ChecksumFilter : public Filter
+  {
+    private:
+      // Largest frame that will be sent or accepted
+      size_t _maxFrameSize;
+
+      // Partial frame header from the peer
+      unsigned char _header[4];
+      size_t _headerFill;
+
+      // Body of the current frame and how much of it is still to come
+      Buffer _frame;
+      size_t _frameRemaining;
+
+      // Partial trailer from the peer
+      unsigned char _trailer[4];
+      size_t _trailerFill;
+
+      // Running checksum of the current frame
+      uint32_t _crc;
+
+      // Check the completed frame and pass it on
+      void _finishFrame( Buffer& );
+
+      // Wrap one frame's worth of data
+      void _writeFrame( Buffer&&, Buffer& );
+
+    public:
+      ChecksumFilter( size_t, size_t );
+      virtual ~ChecksumFilter() {}
+
+      ChecksumFilter( const ChecksumFilter& ) = delete;
+      ChecksumFilter( ChecksumFilter&& ) = delete;
+      ChecksumFilter& operator=( const ChecksumFilter& ) = delete;
+      ChecksumFilter& operator=( ChecksumFilter&& ) = delete;
+
+
+      // Wraps the buffer in a header and trailer, splitting it at the maximum frame size
+      virtual bool write( Buffer&&, Buffer& ) override;
+
+      // Unpacks and checks the frames. The body chunks are checksummed where they are and moved on
+      virtual bool read( Buffer&&, Buffer& ) override;
+  };
+
+}
+
+#endif // STEWARDESS_CHECKSUM_FILTER_H_
+
@@ -0,0 +1,124 @@
+
+#ifndef STEWARDESS_COMPRESSION_FILTER_H_
+#define STEWARDESS_COMPRESSION_FILTER_H_
+
+#include "Definitions.h"
+#include "Filter.h"
+
+#include <atomic>
+#include <zlib.h>
+
+
+namespace Stewardess
+{
+
+  /*
+   * Deflate stage for a connection's filter chain.
+   *
+   * Each side sends a 4 char hello before anything else. If both hellos offer deflate,
+   *  every serialized buffer is sent as a frame: 1 char type, 4 char big-endian length, then the body.
+   * The deflate and inflate streams live for the whole connection so the dictionary carries
+   *  over between frames. Buffers below the threshold are sent as uncompressed frames.
+   * If the peer's first chars are not a hello the stream is passed through untouched.
+   * If no hello has arrived by the negotiation timeout the stream fails. Falling back would desync
+   *  with a peer whose hello is merely late, as it would go on to compress.
+   */
+  class CompressionFilter : public Filter
+  {
+    public:
+      enum class State { Negotiating, Enabled, Disabled, Failed };
+
+    private:
+      // Stream state. Only touched by the worker thread
+      State _state;
+
+      // Compression settings
+      int _level;
+      size_t _threshold;
+      size_t _chunkSize;
+
+      // Largest frame accepted from the peer, before or after inflating
+      size_t _maxFrameSize;
+
+      // The zlib streams
+      z_stream _deflate;
+      z_stream _inflate;
+
+      // Output space for the zlib streams
+      char* _scratch;
+
+      // Partial hello from the peer
+      char _hello[4];
+      size_t _helloFill;
+
+      // When to stop waiting for the peer's hello. Never if the timeout was zero
+      Microseconds _negotiationTimeout;
+      SteadyTime _negotiationDeadline;
+
+      // Partial frame header from the peer and what is left of the current frame
+      unsigned char _header[5];
+      size_t _headerFill;
+      size_t _frameRemaining;
+
+      // Bytes inflated from the current frame so far
+      size_t _frameInflated;
+
+      // Running totals. Read by other threads
+      std::atomic<uint64_t> _plainBytesOut;
+      std::atomic<uint64_t> _wireBytesOut;
+      std::atomic<uint64_t> _wireBytesIn;
+      std::atomic<uint64_t> _plainBytesIn;
+      std::atomic<int64_t> _compressTime;
+      std::atomic<int64_t> _decompressTime;
+
+
+      // Run the deflate stream over a section of a serialized buffer
+      bool _deflateData( const char*, size_t, int, Buffer& );
+
+      // Run the inflate stream over a section of a compressed frame
+      bool _inflateData( const char*, size_t, Buffer& );
+
+      // Handle a section of the data once the handshake is complete
+      bool _decode( const char*, size_t, Buffer& );
+
+      // Frame a serialized buffer for the wire, compressing it if it is big enough
+      bool _compress( const Buffer&, Buffer& );
+
+    public:
+      // Level, threshold, chunk size, largest frame and how long to wait for the peer's hello. Zero waits forever
+      CompressionFilter( int, size_t, size_t, size_t, Microseconds );
+      virtual ~CompressionFilter();
+
+      CompressionFilter( const CompressionFilter& ) = delete;
+      CompressionFilter( CompressionFilter&& ) = delete;
+      CompressionFilter& operator=( const CompressionFilter& ) = delete;
+      CompressionFilter& operator=( CompressionFilter&& ) = delete;
+
+
+      // Sends the handshake
+      virtual void open( Buffer& ) override;
+
+      // Frames and compresses data once the handshake is complete
+      virtual bool write( Buffer&&, Buffer& ) override;
+
+      // Reads the handshake, then unpacks the frames
+      virtual bool read( Buffer&&, Buffer& ) override;
+
+      // Written data is held back until the peer's hello has arrived
+      virtual bool ready() const override { return _state == State::Enabled || _state == State::Disabled; }
+
+      // Fails the stream once the negotiation timeout has passed without a hello
+      virtual bool expire( SteadyTime ) override;
+
+
+      // Return the state of the handshake
+      State getState() const { return _state; }
+
+      // Return a snapshot of the running totals
+      CompressionStatistics getStatistics() const;
+  };
+
+}
+
+#endif // STEWARDESS_COMPRESSION_FILTER_H_
+
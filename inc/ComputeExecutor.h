@@ -0,0 +1,76 @@
+
+#ifndef STEWARDESS_COMPUTE_EXECUTOR_H_
+#define STEWARDESS_COMPUTE_EXECUTOR_H_
+
+#include "Definitions.h"
+
+#include <atomic>
+#include <condition_variable>
+
+
+namespace Stewardess
+{
+
+  /*
+   * Work-stealing thread pool for callbacks too heavy to run on the I/O workers.
+   *
+   * Each pool thread owns a deque. Jobs submitted from a pool thread go on its own deque,
+   *  others are spread over the deques in turn. A thread runs its own jobs in order and,
+   *  when it has none, steals the oldest job from the others.
+   */
+  class ComputeExecutor
+  {
+    private:
+      struct WorkQueue
+      {
+        std::deque< WorkerJob > jobs;
+        std::mutex mutex;
+      };
+
+      typedef std::vector< WorkQueue* > WorkQueueVector;
+
+      // One queue per thread
+      WorkQueueVector _queues;
+      std::vector< std::thread > _threads;
+
+      // Number of jobs waiting in all the queues. Counted before a job is pushed, uncounted as it is taken
+      std::atomic<size_t> _pending;
+
+      // Next queue for jobs from outside the pool
+      std::atomic<size_t> _nextQueue;
+
+      // Idle threads sleep here
+      std::mutex _sleepMutex;
+      std::condition_variable _sleepCondition;
+      std::atomic<bool> _stop;
+
+      // Main loop for the pool threads
+      void _run( size_t );
+
+      // Take a job from our own queue, or steal one. Returns false if there was nothing
+      bool _take( size_t, WorkerJob& );
+
+    public:
+      explicit ComputeExecutor( unsigned );
+      ~ComputeExecutor();
+
+      ComputeExecutor( const ComputeExecutor& ) = delete;
+      ComputeExecutor( ComputeExecutor&& ) = delete;
+      ComputeExecutor& operator=( const ComputeExecutor& ) = delete;
+      ComputeExecutor& operator=( ComputeExecutor&& ) = delete;
+
+
+      // Queue a job to run on the pool
+      void submit( WorkerJob );
+
+      // Number of threads in the pool
+      size_t size() const { return _threads.size(); }
+
+      // Number of jobs waiting to be taken
+      size_t pending() const { return _pending; }
+  };
+
+}
+
+#endif // STEWARDESS_COMPUTE_EXECUTOR_H_
+
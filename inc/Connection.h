@@ -7,19 +7,39 @@
 #include "ManagerImpl.h"
 #include "InetAddress.h"
 #include "Handle.h"
+#include "TimerWheel.h"
 
 #include <string>
+#include <coroutine>
 
 
 namespace Stewardess
 {
 
   class Serializer;
+  class FilterChain;
+  class CompressionFilter;
   class CallbackInterface;
 
   class Connection
   {
+    // The read and write callbacks handle the streams
+    friend void readCB( evutil_socket_t, short, void* );
+    friend void writeCB( evutil_socket_t, short, void* );
+
+    // The inbox callback drains the scheduled writes
+    friend void workerInboxCB( evutil_socket_t, short, void* );
+
+    // Fires the connection's own timers
+    friend void connectionTimerCB( void* );
+
+    // Reads and updates the rebalancing samples
+    friend class ManagerImpl;
+
     private:
+      // Slab ID, fixed for the life of the connection
+      const ConnectionID _id;
+
       // Count the number of references to this data
       std::atomic<size_t> _references;
 
@@ -41,18 +61,165 @@ namespace Stewardess
       event* _writeEvent;
       event* _destroyEvent;
 
+      // Timeout the read event was opened with
+      const timeval* _readTimeout;
+
+
+      // The worker whose event base handles this connection
+      std::atomic< WorkerData* > _worker;
+
+      // True between a migration request and the connection arriving on its new worker. Guarded by _theMutex
+      bool _migrating;
+
+      // Time spent in this connection's read and write callbacks
+      std::atomic<uint64_t> _busyTime;
+
+      // Busy time at the last rebalancing sample. Only touched by the control thread
+      uint64_t _sampleBusyTime;
+
+
+      // Serialized data waiting to be written to the socket. Guarded by _theMutex
+      OutputQueue _output;
+
+      // The buffer currently being written and how much of it has been written. Only used by the worker
+      SharedBuffer _current;
+      size_t _outputOffset;
+
+      // True while the connection sits in a worker's inbox, and the next connection in it
+      std::atomic_bool _writeScheduled;
+      Connection* _inboxNext;
+
+      // Make sure the worker will write the output queue. Call after releasing _theMutex
+      void _scheduleWrite();
+
+
+      // Payloads waiting for onRead on the compute pool, and whether a job is draining them
+      std::queue< Payload* > _pendingReads;
+      bool _readsRunning;
+      std::mutex _pendingReadsMutex;
+
+      // Hand the payloads to the compute pool. They run one at a time, in order
+      void _queueReads( std::queue< Payload* >&&, const Handle& );
+
+      // Runs on the compute pool. Calls onRead for a batch of pending payloads
+      void _runReads( Handle );
+
+
+      // Set by readInCoroutine(). From then on payloads go to the coroutine instead of onRead
+      std::atomic_bool _coroutineReads;
+
+      // Coroutine waiting for a payload and where to put it. Guarded by _pendingReadsMutex
+      std::coroutine_handle<> _readWaiter;
+      Payload** _readSlot;
+
+      // Give a payload to the waiting coroutine, or queue it for the next read. Runs on the worker
+      void _deliverRead( Payload* );
+
+
+      // Count of payloads written, and how many of them have reached the socket
+      uint64_t _writeSequence;
+      std::atomic<uint64_t> _flushedSequence;
+
+      // Coroutine waiting for the output to be written and where to put the result. Guarded by _theMutex
+      std::coroutine_handle<> _writeWaiter;
+      bool* _writeSlot;
+
+      // Called by the worker when the output queue has been written. Resumes a waiting coroutine
+      void _flushed();
+
+
+      // Returns true if a coroutine is waiting on this connection
+      bool _hasWaiters();
+
+      // Resume any waiting coroutines once the connection has closed. Runs on the worker
+      void _wakeWaiters();
+
+
+      // A request waiting for its response and who wants it, if anyone
+      struct OutstandingRequest
+      {
+        std::chrono::steady_clock::time_point sent;
+        ResponseCallback callback;
+      };
+
+      // Requests still waiting for a response, oldest first. Guarded by _requestsMutex
+      std::deque< OutstandingRequest > _requests;
+      std::atomic<size_t> _outstanding;
+      std::mutex _requestsMutex;
+
+      // Smoothed response time in microseconds. Zero until the first response
+      std::atomic<uint64_t> _latency;
+
+      // A payload arrived. Completes the oldest outstanding request, if there is one.
+      //  Returns true if the request's callback took the payload. Runs on the worker
+      bool _responded( Payload* );
+
+      // Tell everyone still waiting for a response that it won't come. Runs on the worker
+      void _failRequests();
+
+
+      // A timer started through the handle. Armed in the wheel of the connection's worker
+      struct ConnectionTimer
+      {
+        Connection* connection;
+        UniqueID identifier;
+        WheelTimer timer;
+        Milliseconds time;
+        bool repeat;
+        std::chrono::steady_clock::time_point due;
+
+        // False once stopped. It is only freed by the worker
+        bool active;
+
+        // True while it is in the worker's wheel. Only changed by the worker
+        bool armed;
+      };
+
+      typedef std::unordered_map< UniqueID, std::unique_ptr< ConnectionTimer > > ConnectionTimerMap;
+
+      // Timers by their user id. Guarded by _theMutex
+      ConnectionTimerMap _timers;
+
+      // Bring the timer's place in the wheel up to date. Runs on the worker with _theMutex locked
+      void _syncTimer( ConnectionTimerMap::iterator );
+
+      // Runs on the worker. Looks the timer up again, in case it changed on the way
+      void _syncTimerJob( UniqueID );
+
+      // Take every timer out of the wheel and forget them. Runs on the worker
+      void _cancelTimers();
+
+
+      // The compression stage in the filter chain, if there is one
+      CompressionFilter* _compression;
+
+      // Collect the user's filters, followed by the ones requested in the configuration
+      static FilterChain* _buildFilterChain( ManagerImpl&, CompressionFilter*& );
+
+
+      // Runs on the old worker. Removes the events and moves them to the new event base
+      void _detach( WorkerData*, WorkerData*, Handle );
+
+      // Runs on the new worker. Restarts reading and any pending writes. The handles keep the connection alive in between
+      void _attach( Handle );
+
 
       // Time of creation
       TimeStamp _connectionTime;
 
-      // Last time someone sent/received through this connection
-      TimeStamp _lastAccess;
-      mutable std::mutex _lastAccessMutex;
+      // Last time someone sent/received through this connection. Only ever needs to be roughly right
+      std::atomic< SteadyTime > _lastAccess;
+
+      // Last time bytes came off or went onto the socket, and whether it was too full to write. Only used by the worker
+      SteadyTime _lastRead;
+      SteadyTime _lastWrite;
+      bool _writeBlocked;
 
     public:
 
-      // Create a new connection and aquire a new id.
-      Connection( sockaddr, ManagerImpl&, event_base*, evutil_socket_t );
+      // Create a new connection with the id of its slot. Only built by a ConnectionSlab.
+      //  Takes the serializer, filter chain and its compression stage once it has been built
+      Connection( ConnectionID, sockaddr, ManagerImpl&, WorkerData*, evutil_socket_t, Serializer*, FilterChain*, CompressionFilter* );
       
       // Destroy buffer event
       ~Connection();
@@ -73,6 +240,9 @@ namespace Stewardess
       // Message builder
       Serializer* const serializer;
 
+      // Optional transforms between the serializer and the socket. Null if there are none
+      FilterChain* const filters;
+
       // Read buffer stored here so we don't need to keep re-allocating it
       size_t bufferSize;
 
@@ -85,16 +255,69 @@ namespace Stewardess
       void close();
 
 
+      // Move the connection's events to another worker. Returns false if it is closed or already moving
+      bool migrate( WorkerData* );
+
+      // Return the worker whose event base currently handles this connection
+      WorkerData* getWorker() const { return _worker.load(); }
+
+      // Return the time spent in callbacks for this connection, in nanoseconds
+      uint64_t getBusyTime() const { return _busyTime.load( std::memory_order_relaxed ); }
+
+
       // Return true if its not closed
       bool isOpen();
 
 
-      // Mutex controlled write
-      void write( Payload* );
+      // Mutex controlled write. Returns the sequence number of the payload
+      uint64_t write( Payload* );
+
+      // Mutex controlled write of pre-serialized data. Queued in order with serialized payloads
+      void writeRaw( Buffer&& );
+      void writeRaw( BufferVector&& );
+
+      // Mutex controlled write of serialized data that is shared with other connections
+      void writeShared( const SharedBuffer& );
 
     
-      // Return the ID number of its creation
-      ConnectionID getConnectionID() const { return (ConnectionID)this; }
+      // Return the ID of its slot. Never matches another connection, even once this one has gone
+      ConnectionID getConnectionID() const { return _id; }
+
+
+      // Send payloads to coroutines awaiting a read instead of onRead, from now on
+      void readInCoroutine() { _coroutineReads = true; }
+
+      // Take a queued payload for a coroutine. Returns false if it must wait. Null once closed
+      bool takeRead( Payload*& );
+
+      // Register a coroutine to receive the next payload. Returns false if one arrived in the meantime
+      bool awaitRead( std::coroutine_handle<>, Payload*& );
+
+      // Returns true once the payload with the given sequence number has been written to the socket
+      bool isFlushed( uint64_t s ) const { return _flushedSequence.load() >= s; }
+
+      // Register a coroutine to resume when the payload with the given sequence number has been written.
+      //  Returns false if it already has been, or the connection is closed
+      bool awaitFlush( std::coroutine_handle<>, uint64_t, bool& );
+
+
+      // Mark a request as sent. The next payload read from the connection is taken as its response.
+      //  If there is a callback the response goes there instead of onRead
+      void beginRequest( ResponseCallback = nullptr );
+
+      // Return the number of requests waiting for a response
+      size_t getOutstanding() const { return _outstanding.load( std::memory_order_relaxed ); }
+
+      // Return the smoothed time between a request and its response
+      Microseconds getLatency() const { return Microseconds( _latency.load( std::memory_order_relaxed ) ); }
+
+
+      // Start or restart the timer with the given id. It fires onConnectionTimer on this connection's worker.
+      //  Returns false if the connection is closed
+      bool startTimer( UniqueID, Milliseconds, bool );
+
+      // Stop the timer with the given id, if there is one
+      void stopTimer( UniqueID );
 
 
       // Return the unique user id for this connection
@@ -106,17 +329,33 @@ namespace Stewardess
       // Returns a new connection object
       Handle requestHandle();
 
+      // Returns a reference that doesn't keep the connection alive. For the worker's own callbacks
+      HandleRef borrowHandle() { return HandleRef( this ); }
+
       // Returns the number of handles still alive
       size_t getNumberHandles() const;
 
       // Return the time the connection was opened
       TimeStamp getCreationTime() const;
 
-      // Signal that an access was made.
-      void touchAccess();
+      // Signal that an access was made. Uses the coarse clock
+      void touchAccess() { _lastAccess.store( CoarseClock::now(), std::memory_order_relaxed ); }
+
+      // Return the last time it was accessed, from the coarse clock
+      SteadyTime getAccess() const { return _lastAccess.load( std::memory_order_relaxed ); }
+
+      // Return why the connection has timed out, or null if it hasn't. Takes the coarse clock's time. Runs on the worker
+      const char* checkTimeout( SteadyTime );
+
+      // Let the filters give up on anything they are waiting for. Runs on the worker.
+      //  Returns the filter's error if the stream can't continue, otherwise nullptr
+      const char* expireFilters( SteadyTime );
+
+      // Returns true if the stream passes through a compression filter
+      bool isCompressed() const { return _compression != nullptr; }
 
-      // Return the last time it was accessed
-      TimeStamp getAccess() const;
+      // Return the compression totals. All zero if compression was not requested
+      CompressionStatistics getCompressionStatistics() const;
 
 
       // Increment the reference counter
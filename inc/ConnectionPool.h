@@ -0,0 +1,124 @@
+
+#ifndef STEWARDESS_CONNECTION_POOL_H_
+#define STEWARDESS_CONNECTION_POOL_H_
+
+#include "Definitions.h"
+#include "Configuration.h"
+#include "Handle.h"
+
+
+namespace Stewardess
+{
+
+  class ManagerImpl;
+
+  /*
+   * Reusable outbound connections, grouped by "host:port".
+   *
+   * Leasing takes the most recently returned idle connection if there is one, otherwise a
+   *  new connection is made as long as the endpoint is below its maximum. Beyond that, leases
+   *  wait for a connection to be returned. Closed connections are dropped wherever they are found.
+   *
+   * The maintenance pass forgets leased connections that have closed, closes connections that
+   *  have been idle too long and tops every endpoint back up to its minimum. Endpoints that keep failing are topped up less and less
+   *  often, up to once a minute. Thread safe. Callbacks run without the pool locked.
+   */
+  class ConnectionPool
+  {
+    private:
+      struct IdleConnection
+      {
+        Handle handle;
+        SteadyTime since;
+      };
+
+      struct Endpoint
+      {
+        std::string host;
+        std::string port;
+
+        // Newest at the back
+        std::deque< IdleConnection > idle;
+
+        size_t leased = 0;
+        size_t connecting = 0;
+
+        // Leases waiting for a connection
+        std::queue< ConnectCallback > waiting;
+
+        // Failures since the last success, and when the maintenance pass may try again
+        size_t consecutiveFailures = 0;
+        SteadyTime retryTime;
+
+        // Totals for the statistics
+        uint64_t leases = 0;
+        uint64_t reused = 0;
+        uint64_t created = 0;
+        uint64_t failed = 0;
+        uint64_t reaped = 0;
+
+        size_t total() const { return idle.size() + leased + connecting; }
+      };
+
+      typedef std::unordered_map< std::string, Endpoint > EndpointMap;
+      typedef std::unordered_map< ConnectionID, std::string > LeaseMap;
+
+
+      ManagerImpl& _manager;
+
+      // Limits for every endpoint
+      const size_t _minimum;
+      const size_t _maximum;
+      const std::chrono::seconds _idleTimeout;
+
+      EndpointMap _endpoints;
+
+      // Which endpoint each leased connection belongs to
+      LeaseMap _leases;
+
+      mutable std::mutex _mutex;
+
+
+      // Find or create the endpoint. Call with the mutex locked
+      Endpoint& _endpoint( const std::string&, const std::string& );
+
+      // Start a new connection for the endpoint. Call with the mutex locked
+      void _connect( const std::string&, Endpoint& );
+
+      // A connection attempt finished. Hands it to a waiting lease or keeps it idle
+      void _connected( const std::string&, Handle );
+
+    public:
+      ConnectionPool( ManagerImpl&, const ConfigurationData& );
+      ~ConnectionPool();
+
+      ConnectionPool( const ConnectionPool& ) = delete;
+      ConnectionPool( ConnectionPool&& ) = delete;
+      ConnectionPool& operator=( const ConnectionPool& ) = delete;
+      ConnectionPool& operator=( ConnectionPool&& ) = delete;
+
+
+      // Lease a connection to the host and port. The callback gets a null handle if it couldn't connect
+      void lease( const std::string&, const std::string&, ConnectCallback );
+
+      // Give a leased connection back. Returns false if it wasn't leased from the pool, or it closed and has been forgotten
+      bool release( const Handle& );
+
+      // Open connections to the host and port until it has the minimum
+      void preconnect( const std::string&, const std::string& );
+
+      // Forget closed leases, close connections idle for too long and top the endpoints up to their minimum
+      void maintain();
+
+      // Drop every pooled connection without closing them. Leases still waiting are abandoned
+      void clear();
+
+
+      // Return the current numbers for each endpoint
+      PoolStatisticsVector getStatistics() const;
+  };
+
+}
+
+#endif // STEWARDESS_CONNECTION_POOL_H_
+
@@ -3,16 +3,32 @@
 #define STEWARDESS_CONNECTION_REQUEST_H_
 
 #include "Definitions.h"
+#include "LibeventIncludes.h"
 
 
 namespace Stewardess
 {
 
+  class ManagerImpl;
+
   struct ConnectionRequest
   {
     std::string address;
     std::string port;
     UniqueID uniqueId;
+    ConnectCallback callback;
+  };
+
+
+  // An outbound connect in progress. Waits for the socket to be writable on the worker that will own it
+  struct PendingConnect
+  {
+    ManagerImpl* manager;
+    WorkerData* worker;
+    ConnectionRequest request;
+    evutil_socket_t socket;
+    sockaddr_storage address;
+    event* connectEvent;
   };
 
 }
@@ -0,0 +1,97 @@
+
+#ifndef STEWARDESS_CONNECTION_SLAB_H_
+#define STEWARDESS_CONNECTION_SLAB_H_
+
+#include "Definitions.h"
+#include "LibeventIncludes.h"
+#include "Handle.h"
+
+
+namespace Stewardess
+{
+
+  class ManagerImpl;
+  class Serializer;
+  class FilterChain;
+  class CompressionFilter;
+
+  /*
+   * Storage for the connections created on one worker.
+   *
+   * Connections are built in place in fixed slots, allocated in chunks so they never move.
+   *  The connection ID is made from the slab's index, the slot and the slot's generation,
+   *  which changes every time the slot is used or freed. Finding a connection from its ID
+   *  is a couple of array lookups, and an ID kept after its connection has gone never
+   *  matches the connection that reuses the slot.
+   *
+   * Connections keep their slot when they migrate, so they can be freed from any worker. Thread safe.
+   */
+  class ConnectionSlab
+  {
+    private:
+      struct Slot;
+
+      // Which slab this is, stored in the top of every ID
+      const size_t _index;
+
+      // Chunks of slots. Never shrinks until the slab goes
+      std::vector< Slot* > _chunks;
+
+      // Head of the list of unused slots
+      size_t _free;
+
+      // Connections currently in the slab
+      size_t _size;
+
+      mutable std::mutex _mutex;
+
+
+      // Return the slot, or null if it doesn't exist. Call with the mutex locked
+      Slot* _slot( size_t ) const;
+
+      // Return the live connection with the ID, or null. Call with the mutex locked
+      Connection* _find( ConnectionID ) const;
+
+      // Add another chunk of free slots. Call with the mutex locked
+      void _grow();
+
+    public:
+      explicit ConnectionSlab( size_t );
+      ~ConnectionSlab();
+
+      ConnectionSlab( const ConnectionSlab& ) = delete;
+      ConnectionSlab( ConnectionSlab&& ) = delete;
+      ConnectionSlab& operator=( const ConnectionSlab& ) = delete;
+      ConnectionSlab& operator=( ConnectionSlab&& ) = delete;
+
+
+      // Build a new connection in a free slot. It takes the serializer and filters only if it is built
+      Connection* create( const sockaddr&, ManagerImpl&, WorkerData*, evutil_socket_t, Serializer*, FilterChain*, CompressionFilter* );
+
+      // Return a handle to the open connection with the ID, or a null handle if it has closed
+      Handle acquire( ConnectionID );
+
+      // Stop the connection being found by its ID. Returns false if a handle was taken since it closed
+      bool retire( Connection* );
+
+      // Destroy a retired connection and free its slot
+      void release( Connection* );
+
+      // Destroy every connection still in the slab
+      void clear();
+
+      // Number of connections in the slab
+      size_t size() const;
+
+
+      // Return the index of the slab the ID came from
+      static size_t slabIndex( ConnectionID );
+
+      // Largest slab index that fits in an ID
+      static size_t maxIndex();
+  };
+
+}
+
+#endif // STEWARDESS_CONNECTION_SLAB_H_
+
@@ -0,0 +1,79 @@
+
+#ifndef STEWARDESS_CONNECTION_TABLE_H_
+#define STEWARDESS_CONNECTION_TABLE_H_
+
+#include "Definitions.h"
+
+
+namespace Stewardess
+{
+
+  /*
+   * Open-addressing hash table from connection ID to connection.
+   *
+   * Entries are stored inline in one array and found by linear probing, so a lookup
+   *  is usually a single cache line. Removal shifts the following entries back instead
+   *  of leaving tombstones, so heavy churn doesn't slow the table down.
+   * ID zero marks an empty slot. Not thread safe.
+   */
+  class ConnectionTable
+  {
+    private:
+      struct Entry
+      {
+        ConnectionID key;
+        Connection* value;
+      };
+
+      Entry* _entries;
+      size_t _capacity;
+      size_t _size;
+
+      // Position an ID hashes to
+      size_t _home( ConnectionID ) const;
+
+      // Double the capacity and re-insert everything
+      void _grow();
+
+    public:
+      explicit ConnectionTable( size_t = 64 );
+      ~ConnectionTable();
+
+      ConnectionTable( const ConnectionTable& ) = delete;
+      ConnectionTable( ConnectionTable&& ) = delete;
+      ConnectionTable& operator=( const ConnectionTable& ) = delete;
+      ConnectionTable& operator=( ConnectionTable&& ) = delete;
+
+
+      // Add or replace an entry
+      void insert( ConnectionID, Connection* );
+
+      // Remove an entry. Returns false if it wasn't there
+      bool erase( ConnectionID );
+
+      // Return the connection or null
+      Connection* find( ConnectionID ) const;
+
+      // Number of entries
+      size_t size() const { return _size; }
+
+      // Remove everything
+      void clear();
+
+
+      // Call the function with every connection in the table
+      template < class FUNCTION >
+      void forEach( FUNCTION function ) const
+      {
+        for ( size_t i = 0; i < _capacity; ++i )
+        {
+          if ( _entries[i].key != 0 )
+            function( _entries[i].value );
+        }
+      }
+  };
+
+}
+
+#endif // STEWARDESS_CONNECTION_TABLE_H_
+
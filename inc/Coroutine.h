@@ -0,0 +1,126 @@
+
+#ifndef STEWARDESS_COROUTINE_H_
+#define STEWARDESS_COROUTINE_H_
+
+#include "Definitions.h"
+#include "Handle.h"
+
+#include <coroutine>
+
+
+namespace Stewardess
+{
+
+  class Connection;
+  class ManagerImpl;
+  class Payload;
+  class WheelTimer;
+  struct WorkerData;
+
+
+  /*
+   * Return type for connection handling coroutines.
+   *
+   * Tasks start immediately and run until their first suspension. They are not joined - the
+   *  frame destroys itself when the coroutine finishes. Exceptions that escape are logged.
+   *
+   * Every awaitable resumes on a worker thread: reads and writes on the connection's worker,
+   *  sleeps and connects on the worker that suspended (the control thread if there was none).
+   */
+  class Task
+  {
+    public:
+      struct promise_type
+      {
+        Task get_return_object() { return Task(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+      };
+  };
+
+
+  // Returned by Handle::read(). Resumes with the next payload, or null once the connection closes.
+  //  The connection must be reading in a coroutine, see HandleRef::readInCoroutine().
+  class ReadAwaitable
+  {
+    private:
+      Connection* _connection;
+      Payload* _payload;
+
+    public:
+      explicit ReadAwaitable( Connection* c ) : _connection( c ), _payload( nullptr ) {}
+
+      bool await_ready();
+      bool await_suspend( std::coroutine_handle<> );
+      Payload* await_resume() { return _payload; }
+  };
+
+
+  // Returned by Handle::write(). The payload is queued when write is called, awaiting it waits
+  //  until it has been written to the socket. Resumes with false if the connection closed first.
+  class WriteAwaitable
+  {
+    private:
+      Connection* _connection;
+      uint64_t _sequence;
+      bool _flushed;
+
+    public:
+      WriteAwaitable( Connection* c, uint64_t s ) : _connection( c ), _sequence( s ), _flushed( false ) {}
+
+      bool await_ready();
+      bool await_suspend( std::coroutine_handle<> );
+      bool await_resume() { return _flushed; }
+  };
+
+
+  // Returned by Manager::sleep(). Resumes after the time has passed
+  class SleepAwaitable
+  {
+    private:
+      ManagerImpl* _manager;
+      Milliseconds _time;
+      WorkerData* _worker;
+      std::coroutine_handle<> _coroutine;
+
+      // Only made when it suspends
+      std::unique_ptr< WheelTimer > _timer;
+
+      // Timer callback
+      static void _wake( void* );
+
+    public:
+      SleepAwaitable( ManagerImpl*, Milliseconds );
+      SleepAwaitable( SleepAwaitable&& );
+      ~SleepAwaitable();
+
+      bool await_ready() { return _time.count() <= 0; }
+      void await_suspend( std::coroutine_handle<> );
+      void await_resume() {}
+  };
+
+
+  // Returned by Manager::connect(). Resumes with the new connection, or a null handle if it failed
+  class ConnectAwaitable
+  {
+    private:
+      ManagerImpl* _manager;
+      std::string _host;
+      std::string _port;
+      UniqueID _identifier;
+      Handle _result;
+
+    public:
+      ConnectAwaitable( ManagerImpl* m, std::string h, std::string p, UniqueID id ) : _manager( m ), _host( std::move( h ) ), _port( std::move( p ) ), _identifier( id ), _result() {}
+
+      bool await_ready() { return false; }
+      void await_suspend( std::coroutine_handle<> );
+      Handle await_resume() { return std::move( _result ); }
+  };
+
+}
+
+#endif // STEWARDESS_COROUTINE_H_
+
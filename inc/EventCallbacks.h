@@ -14,6 +14,8 @@ namespace Stewardess
 
   void listenerAcceptCB( evconnlistener*, evutil_socket_t, sockaddr*, int, void* );
   void listenerErrorCB( evconnlistener*, void* );
+  void workerAcceptCB( evconnlistener*, evutil_socket_t, sockaddr*, int, void* );
+  void workerListenerErrorCB( evconnlistener*, void* );
 
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -23,8 +25,19 @@ namespace Stewardess
   void interruptSignalCB( evutil_socket_t, short, void* );
   void killTimerCB( evutil_socket_t, short, void* );
   void tickTimerCB( evutil_socket_t, short, void* );
-  void userTimerCB( evutil_socket_t, short, void* );
+  void wheelTimerCB( evutil_socket_t, short, void* );
   void connectCB( evutil_socket_t, short, void* );
+  void connectCompleteCB( evutil_socket_t, short, void* );
+  void resolverCB( int, char, int, int, void*, void* );
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Timer wheel call back functions
+
+  void userTimerCB( void* );
+  void hedgeTimerCB( void* ); // In LoadBalancer.cpp, with the requests it fires for
+  void timeoutSweepCB( void* );
+  void connectionTimerCB( void* );
 
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -34,6 +47,8 @@ namespace Stewardess
   void writeCB( evutil_socket_t, short, void* );
   void destroyCB( evutil_socket_t, short, void* );
 
+  void workerInboxCB( evutil_socket_t, short, void* );
+  void workerJobCB( evutil_socket_t, short, void* );
   void workerTickCB( evutil_socket_t, short, void* );
 
 }
@@ -0,0 +1,60 @@
+
+#ifndef STEWARDESS_FILTER_BASE_H_
+#define STEWARDESS_FILTER_BASE_H_
+
+#include "Definitions.h"
+
+
+namespace Stewardess
+{
+
+  /*
+   * A stage in a connection's byte stream, between the serializer and the socket.
+   *
+   * Filters are chained in order. The first filter is closest to the serializer:
+   *  written data passes through the chain first to last, read data last to first.
+   * The default implementations move the chunks straight through without copying.
+   * A connection's filters are only ever called from its worker thread.
+   */
+  class Filter
+  {
+    private:
+      // Queue of errors that occured
+      ErrorQueue _errors;
+
+    protected:
+      // Push a char* pointer to the error queue. Reported as a serialization error
+      void pushError( const char* );
+
+    public:
+      Filter() {}
+      virtual ~Filter() {}
+
+      // Called when the connection opens. Anything added to the buffer is written before any payloads
+      virtual void open( Buffer& ) {}
+
+      // Transform data on its way to the socket. Return false if the stream can't continue
+      virtual bool write( Buffer&&, Buffer& );
+
+      // Transform data on its way to the serializer. Return false if the stream can't continue
+      virtual bool read( Buffer&&, Buffer& );
+
+      // Return false to hold back written data, e.g. until a handshake has completed
+      virtual bool ready() const { return true; }
+
+      // Called by the worker's timeout sweep while the filter isn't ready, e.g. to give up on a handshake.
+      //  Return false if the stream can't continue
+      virtual bool expire( SteadyTime ) { return true; }
+
+
+      // Return an error string describing the error
+      const char* getError();
+
+      // Declares an error has happened
+      bool errorEmpty() const;
+  };
+
+}
+
+#endif // STEWARDESS_FILTER_BASE_H_
+
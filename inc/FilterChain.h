@@ -0,0 +1,58 @@
+
+#ifndef STEWARDESS_FILTER_CHAIN_H_
+#define STEWARDESS_FILTER_CHAIN_H_
+
+#include "Definitions.h"
+#include "Filter.h"
+
+
+namespace Stewardess
+{
+
+  /*
+   * Owns a connection's filters and runs data through them in order.
+   */
+  class FilterChain
+  {
+    private:
+      // First is closest to the serializer, last is closest to the socket
+      FilterVector _filters;
+
+    public:
+      // Takes ownership of the filters
+      explicit FilterChain( FilterVector&& );
+      ~FilterChain();
+
+      FilterChain( const FilterChain& ) = delete;
+      FilterChain( FilterChain&& ) = delete;
+      FilterChain& operator=( const FilterChain& ) = delete;
+      FilterChain& operator=( FilterChain&& ) = delete;
+
+
+      // Collect the opening data from every filter, passed through the filters below it
+      void open( Buffer& );
+
+      // Pass serialized data through each filter towards the socket
+      bool write( Buffer&&, Buffer& );
+
+      // Pass data from the socket through each filter towards the serializer
+      bool read( Buffer&&, Buffer& );
+
+      // Returns true if every filter is ready for written data
+      bool ready() const;
+
+      // Pass the time to every filter that isn't ready. Returns false if one of them gave up
+      bool expire( SteadyTime );
+
+
+      // Return the next error from any of the filters
+      const char* getError();
+
+      // Returns true if none of the filters have errors
+      bool errorEmpty() const;
+  };
+
+}
+
+#endif // STEWARDESS_FILTER_CHAIN_H_
+
@@ -12,6 +12,7 @@
 #include <event2/listener.h>
 #include <event2/buffer.h>
 #include <event2/bufferevent.h>
+#include <event2/dns.h>
 #include <cstring>
 #include <csignal>
 
@@ -6,12 +6,16 @@
 #include "Configuration.h"
 #include "Handle.h"
 
+#include <future>
+
 
 namespace Stewardess
 {
 
   class CallbackInterface;
   class ManagerImpl;
+  class ConnectAwaitable;
+  class SleepAwaitable;
 
   class Manager
   {
@@ -70,11 +74,62 @@ namespace Stewardess
       Handle connectTo( std::string, std::string, UniqueID = 0 );
 
       // Requests a new connection to provided host and port number. Runs asynchronously.
-      void requestConnectTo( std::string, std::string, UniqueID = 0 );
+      //  The future holds the handle once it has connected, or a null handle if it failed.
+      //  A handle left in the future keeps the connection from being cleaned up
+      std::future< Handle > requestConnectTo( std::string, std::string, UniqueID = 0 );
+
+      // As above, calling the function with the result on the worker that owns the connection
+      void requestConnectTo( std::string, std::string, ConnectCallback, UniqueID = 0 );
+
+      // Awaited inside a coroutine to connect without blocking. Resumes with a null handle if it failed.
+      //  The awaitables are defined in Coroutine.h
+      ConnectAwaitable connect( std::string, std::string, UniqueID = 0 );
+
+      // Awaited inside a coroutine to suspend it for the given time
+      SleepAwaitable sleep( Milliseconds );
+
+      // Leases a pooled connection to the host and port, reusing an idle one if it can. Only while running.
+      //  The callback gets a null handle if it could not connect. Give the handle back with returnConnection
+      void leaseConnection( std::string, std::string, ConnectCallback );
+
+      // As above, returning a future that holds the handle
+      std::future< Handle > leaseConnection( std::string, std::string );
+
+      // Gives a leased connection back to the pool. Closed connections are dropped.
+      //  Returns false if it wasn't leased from the pool
+      bool returnConnection( const Handle& );
+
+      // Opens the pool's minimum number of connections to the host and port now
+      void preconnect( std::string, std::string );
+
+      // Returns the pool's numbers for each endpoint
+      PoolStatisticsVector getPoolStatistics() const;
 
       // Returns the number of current active connections
       size_t getNumberConnections() const;
 
+      // Returns a handle to the open connection with the ID, or a null handle if it has closed.
+      //  IDs are never reused, so they can be kept instead of handles. Only while running
+      Handle findConnection( ConnectionID ) const;
+
+      // Returns the compression totals over every connection, open or closed
+      CompressionStatistics getCompressionStatistics() const;
+
+      // Returns the current load on each worker thread
+      WorkerLoadVector getWorkerLoads() const;
+
+      // Moves the connection to the given worker thread without losing or reordering data.
+      //  Returns false if the connection is closed, already moving or the index is invalid
+      bool migrateConnection( const HandleRef&, size_t );
+
+
+      // Serializes the payload once and queues the bytes on every open connection accepted by the filter.
+      //  The filter is called with the connection map locked, so it must not call back into the manager.
+      void broadcast( const Payload*, ConnectionFilter = nullptr );
+
+      // Serializes the payload once and queues the bytes on each connection in the group
+      void broadcast( const Payload*, const HandleVector& );
+
 
       // Creates a timer for the user to use
       void createTimer( UniqueID, bool );
@@ -7,14 +7,22 @@
 #include "Configuration.h"
 #include "Handle.h"
 #include "ConnectionRequest.h"
+#include "WorkerThread.h"
+#include "Resolver.h"
+#include "TimerRegistry.h"
 
 #include <queue>
+#include <unordered_set>
 
 
 namespace Stewardess
 {
 
   class CallbackInterface;
+  class Serializer;
+  class ComputeExecutor;
+  class Resolver;
+  class ConnectionPool;
 
   class ManagerImpl
   {
@@ -27,15 +35,24 @@ namespace Stewardess
     // Callback functions are friends
     friend void listenerAcceptCB( evconnlistener*, evutil_socket_t, sockaddr*, int, void* );
     friend void listenerErrorCB( evconnlistener*, void* );
+    friend void workerAcceptCB( evconnlistener*, evutil_socket_t, sockaddr*, int, void* );
+    friend void workerListenerErrorCB( evconnlistener*, void* );
     friend void interruptSignalCB( evutil_socket_t, short, void* );
     friend void killTimerCB( evutil_socket_t, short, void* );
     friend void tickTimerCB( evutil_socket_t, short, void* );
-    friend void userTimerCB( evutil_socket_t, short, void* );
+    friend void userTimerCB( void* );
+    friend void timeoutSweepCB( void* );
+    friend void connectionTimerCB( void* );
     friend void connectCB( evutil_socket_t, short, void* );
+    friend void connectCompleteCB( evutil_socket_t, short, void* );
     friend void readCB( evutil_socket_t, short, void* );
     friend void writeCB( evutil_socket_t, short, void* );
     friend void destroyCB( evutil_socket_t, short, void* );
 
+    // Coroutines fall back to the control thread when they aren't on a worker
+    friend class SleepAwaitable;
+    friend class ConnectAwaitable;
+
     private:
 
       // Pointer to the configuration
@@ -48,22 +65,44 @@ namespace Stewardess
       std::atomic<bool> _abort;
 
 
-      // Map of all the connections currently with the process
-      ConnectionMap _connections;
-      mutable std::mutex _connectionsMutex;
+      // Number of connections across all the worker shards
+      std::atomic<size_t> _numberConnections;
+
+
+      // Compression totals from connections that have been closed
+      CompressionStatistics _closedCompressionStatistics;
+      mutable std::mutex _closedCompressionStatisticsMutex;
 
 
       // Vector of pending asynchronous connections
       std::queue< ConnectionRequest > _connectionRequests;
       mutable std::mutex _connectionRequestsMutex;
 
+      // Resolves and caches host names for the connects. Runs on the control thread
+      Resolver* _resolver;
+
+      // Reusable outbound connections. Exists while the manager is running
+      ConnectionPool* _pool;
+
+      // Connects waiting on a worker for the socket to become writable
+      std::unordered_set< PendingConnect* > _pendingConnects;
+      std::mutex _pendingConnectsMutex;
+
 
-      // Vector of all the user timers
-      TimerMap _userTimers;
-      mutable std::mutex _userTimersMutex;
+      // Pool that runs onRead off the connection threads, if configured
+      ComputeExecutor* _executor;
 
 
-      // Control event base runs listener, signal handling and server ticks runs listener, signal handling and server ticks
+      // Serializer used to build broadcast buffers once for all the recipients
+      Serializer* _broadcastSerializer;
+      std::mutex _broadcastMutex;
+
+
+      // All the user timers. Found without a lock when they are started
+      TimerRegistry _userTimers;
+
+
+      // Control event base runs listener, signal handling and server ticks
       event_base* _eventBase;
 
       // Pointer to a listener event
@@ -102,9 +141,11 @@ namespace Stewardess
       // All the threads
       ThreadVector _threads;
 
-      // The next thread to allocate a connection to
-      size_t _nextThread;
-      std::mutex _nextThreadMutex;
+      // The next thread to allocate a connection to with round-robin placement
+      std::atomic<size_t> _nextThread;
+
+      // Worker data for the control thread. Handles the connections if there are no worker threads
+      WorkerData _controlWorker;
 
 
 
@@ -115,13 +156,73 @@ namespace Stewardess
       // Update and return the next thread index
       size_t getNextThread();
 
-      // Return appropriate pointers for the read and write timeouts
+      // Return the worker that should handle the next connection, according to the placement policy.
+      //  The identifier, or failing that the address, is used by the hash policy
+      WorkerData* getNextWorker( UniqueID = 0, const sockaddr* = nullptr );
+
+      // Fold the busy time since the last sample into each worker's utilization
+      void updateWorkerLoads();
+
+      // Move a connection from the busiest worker to the idlest if they are far enough apart
+      void rebalanceWorkers();
+
+      // Create a connection for an accepted socket on the given worker and tell the server
+      void acceptConnection( WorkerData*, evutil_socket_t, sockaddr* );
+
+      // Bind a SO_REUSEPORT listener on each worker's event base
+      void createWorkerListeners();
+
+      // Choose CPU sets and NUMA nodes for the workers. Returns the CPUs for the control thread, if any
+      CPUSet assignAffinity();
+
+      // Serialize a payload into a single buffer that can be shared by many connections
+      SharedBuffer serializeShared( const Payload* );
+
+      // Post one job per worker that queues the buffer on each of its connections
+      void dispatchBroadcast( const SharedBuffer&, std::unordered_map< WorkerData*, HandleVector >& );
+
+      // Return appropriate pointers for the read, write, idle and connect timeouts
       const timeval* getReadTimeout() const;
       const timeval* getWriteTimeout() const;
+      const timeval* getIdleTimeout() const;
+      const timeval* getConnectTimeout() const;
+
+      // Start checking the worker's connections for timeouts, if any are enabled
+      void startTimeoutSweep( WorkerData* );
+
+      // Runs on the worker. Closes the connections that have timed out and tells the server
+      void checkTimeouts( WorkerData* );
+
+      // Resolve the host while blocking the caller. Uses the cache if it can. Returns false if it failed
+      bool resolveNow( const std::string&, const std::string&, sockaddr_storage&, const char*& );
 
-      // Add a newly created connection to the map
+      // Start a non-blocking connect to the address. Returns the socket, or -1 and the reason
+      evutil_socket_t beginConnect( const sockaddr_storage&, const char*& );
+
+      // Resolve the request's host, then connect and wait on the worker that will own the connection
+      void startConnect( ConnectionRequest&& );
+
+      // Continue a request once its host has been resolved
+      void connectResolved( ConnectionRequest&&, const AddressVector& );
+
+      // Runs on the worker when the socket is writable or the timeout expires. Takes ownership of the pending connect
+      void finishConnect( PendingConnect*, int );
+
+      // Tell the server and the requester that the connect failed
+      void failConnect( const ConnectionRequest&, const char* );
+
+      // Build a connection in the worker's slab
+      Connection* createConnection( const sockaddr&, WorkerData*, evutil_socket_t );
+
+      // Return the slab the ID came from, or null if there isn't one
+      ConnectionSlab* getConnectionSlab( ConnectionID ) const;
+
+      // Add a newly created connection to its worker's shard
       void addConnection( Connection* );
 
+      // Call the function for every connection, locking one shard at a time
+      void forEachConnection( const std::function< void( Connection* ) >& ) const;
+
       // Deletes connections that are closed and have no handles remaining
       void cleanupClosedConnections();
 
@@ -156,11 +257,45 @@ namespace Stewardess
       Handle connectTo( std::string, std::string, UniqueID = 0 );
 
       // Requests a new connection to provided host and port number. Runs asynchronously.
-      void requestConnectTo( std::string, std::string, UniqueID = 0 );
+      //  The function is called with the result once the attempt is finished
+      void requestConnectTo( std::string, std::string, UniqueID, ConnectCallback );
 
       // Returns the number of current active connections
       size_t getNumberConnections() const;
 
+      // Return a handle to the open connection with the ID, or a null handle if it has gone
+      Handle findConnection( ConnectionID ) const;
+
+
+      // Return the compression totals over every connection, open or closed
+      CompressionStatistics getCompressionStatistics() const;
+
+      // Return the current load on each worker thread
+      WorkerLoadVector getWorkerLoads() const;
+
+      // Move the connection to the given worker thread. Returns false if it can't be moved
+      bool migrateConnection( const HandleRef&, size_t );
+
+
+      // Lease a pooled connection to the host and port
+      void leaseConnection( std::string, std::string, ConnectCallback );
+
+      // Give a leased connection back to the pool. Returns false if it didn't come from the pool
+      bool returnConnection( const Handle& );
+
+      // Open the pool's minimum connections to the host and port
+      void preconnect( std::string, std::string );
+
+      // Return the pool's numbers for each endpoint
+      PoolStatisticsVector getPoolStatistics() const;
+
+
+      // Serializes the payload once and queues the bytes on every open connection accepted by the filter
+      void broadcast( const Payload*, ConnectionFilter = nullptr );
+
+      // Serializes the payload once and queues the bytes on each connection in the group
+      void broadcast( const Payload*, const HandleVector& );
+
 
 
       // Creates a timer for the user to use
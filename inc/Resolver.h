@@ -0,0 +1,124 @@
+
+#ifndef STEWARDESS_RESOLVER_H_
+#define STEWARDESS_RESOLVER_H_
+
+#include "Definitions.h"
+#include "LibeventIncludes.h"
+#include "Configuration.h"
+
+#include <atomic>
+
+
+namespace Stewardess
+{
+
+  // Addresses found for a host name. The ports are left at zero
+  typedef std::vector< sockaddr_storage > AddressVector;
+
+  // Called with the addresses, or an empty vector if the name could not be resolved
+  typedef std::function< void( const AddressVector& ) > ResolveCallback;
+
+
+  /*
+   * Asynchronous host name resolution with a cache.
+   *
+   * Numeric addresses and names in the hosts file are answered immediately. Everything else
+   *  goes to DNS through evdns, A records first and AAAA if there are none. Answers are kept
+   *  for their TTL, failures for the configured negative TTL. A name used in the last part of
+   *  its TTL is refreshed in the background while the cached answer is still handed out.
+   *
+   * Runs on the event base it is given. Only lookup may be called from other threads.
+   */
+  class Resolver
+  {
+    friend void resolverCB( int, char, int, int, void*, void* );
+
+    typedef std::chrono::steady_clock Clock;
+
+    private:
+      struct Entry
+      {
+        AddressVector addresses;
+        Clock::time_point expiry;
+        Clock::time_point refresh;
+        bool pending = false;
+        std::vector< ResolveCallback > waiting;
+      };
+
+      // Identifies an outstanding DNS query to the callback
+      struct Query
+      {
+        Resolver* resolver;
+        std::string name;
+        bool ipv6;
+      };
+
+      typedef std::unordered_map< std::string, Entry > EntryMap;
+      typedef std::unordered_map< std::string, AddressVector > HostsMap;
+
+
+      evdns_base* _dnsBase;
+
+      // How long failures are cached and when in the TTL the refresh starts
+      Clock::duration _negativeTTL;
+      double _refreshAhead;
+
+      // Static names from the hosts file
+      HostsMap _hosts;
+
+      // Cached answers, failures and lookups in progress. Locked so other threads can read it
+      EntryMap _entries;
+      mutable std::mutex _entriesMutex;
+
+      // Counters for the statistics
+      std::atomic<size_t> _queries;
+      std::atomic<size_t> _hits;
+
+
+      // Read the hosts file into the map
+      void _loadHosts( const std::string& );
+
+      // Answer from the hosts file or a numeric address. Returns false if DNS is needed
+      bool _staticLookup( const std::string&, AddressVector& ) const;
+
+      // Send a DNS query for the name
+      void _query( const std::string&, bool );
+
+      // Store the DNS answer and call everyone waiting for it
+      void _answer( Query*, int, char, int, int, void* );
+
+    public:
+      Resolver( event_base*, const ConfigurationData& );
+      ~Resolver();
+
+      Resolver( const Resolver& ) = delete;
+      Resolver( Resolver&& ) = delete;
+      Resolver& operator=( const Resolver& ) = delete;
+      Resolver& operator=( Resolver&& ) = delete;
+
+
+      // Resolve the name. The callback may run before this returns. Call on the resolver's event base only
+      void resolve( const std::string&, ResolveCallback );
+
+      // Return a usable answer without waiting. Returns false if the name needs a lookup. Thread safe
+      bool lookup( const std::string&, AddressVector& ) const;
+
+      // Drop everything that was cached
+      void clear();
+
+
+      // Number of DNS queries sent
+      size_t getNumberQueries() const;
+
+      // Number of resolves answered without a query
+      size_t getNumberHits() const;
+
+
+      // Set the port on an address from a number or service name. Returns false if it is not known
+      static bool setPort( sockaddr_storage&, const std::string& );
+  };
+
+}
+
+#endif // STEWARDESS_RESOLVER_H_
+
@@ -20,7 +20,7 @@ namespace Stewardess
 
       // Queue of serialized payloads
       BufferQueue _buffers;
-      std::mutex _bufferMutex;
+      mutable std::mutex _bufferMutex;
 
       // Queue of errors that occured
       ErrorQueue _errors;
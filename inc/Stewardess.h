@@ -7,9 +7,12 @@
 #include "Stewardess/Manager.h"
 #include "Stewardess/Configuration.h"
 #include "Stewardess/Handle.h"
+#include "Stewardess/LoadBalancer.h"
+#include "Stewardess/Coroutine.h"
 #include "Stewardess/Payload.h"
 #include "Stewardess/InetAddress.h"
 #include "Stewardess/Serializer.h"
+#include "Stewardess/Filter.h"
 #include "Stewardess/Buffer.h"
 #include "Stewardess/Exception.h"
 
@@ -6,6 +6,7 @@
 #include "CallbackInterface.h"
 #include "TestSerializer.h"
 #include "Connection.h"
+#include "Coroutine.h"
 
 
 namespace Stewardess
@@ -20,6 +21,9 @@ namespace Stewardess
 
       std::atomic<bool> _alive;
 
+      // Greets the server then prints everything it sends back
+      Task _converse( Handle );
+
     public:
       TestClient();
 
@@ -37,15 +41,15 @@ namespace Stewardess
 
 
       // Called when a read event is triggered.
-      virtual void onRead( Handle, Payload* ) override;
+      virtual void onRead( HandleRef, Payload* ) override;
 
 
       // Called when a read event is triggered.
-      virtual void onWrite( Handle ) override {}
+      virtual void onWrite( HandleRef ) override {}
 
 
       // Called when a connection event occurs
-      virtual void onConnectionEvent( Handle, ConnectionEvent, const char* ) override;
+      virtual void onConnectionEvent( HandleRef, ConnectionEvent, const char* ) override;
 
 
       // Called every server 'tick' with the elapsed time
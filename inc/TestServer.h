@@ -13,18 +13,22 @@ namespace Stewardess
   class TestServer : public CallbackInterface
   {
     private:
+      // Worker that the next connection to send a message is moved to
+      std::atomic<size_t> _nextWorker;
 
     public:
+      TestServer() : _nextWorker( 0 ) {}
+
       // Return a new'd serializer object to implement the transfer protocol
       virtual Serializer* buildSerializer() const override { return new TestSerializer(); }
 
 
       // Called when a read event is triggered.
-      virtual void onRead( Handle, Payload* ) override;
+      virtual void onRead( HandleRef, Payload* ) override;
 
 
       // Called when a connection event occurs
-      virtual void onConnectionEvent( Handle, ConnectionEvent, const char* ) override;
+      virtual void onConnectionEvent( HandleRef, ConnectionEvent, const char* ) override;
 
 
       // Called every server 'tick' with the elapsed time
@@ -3,11 +3,16 @@
 #define STEWARDESS_TIMER_DATA_H__
 
 #include "Definitions.h"
+#include "TimerWheel.h"
 
 
 namespace Stewardess
 {
 
+  class ManagerImpl;
+
+  void userTimerCB( void* );
+
   struct TimerData
   {
     // Pointer to the manager data
@@ -16,14 +21,16 @@ namespace Stewardess
     // Unique ID to distinguish between the timers
     UniqueID timerID;
 
-    // Pointer to the libevent timer event
-    event* theEvent;
+    // The timer in the control thread's wheel
+    WheelTimer timer;
 
     // Will be automatically added after the call back has been triggered
     bool repeat;
 
-    // Store the countdown time
-    timeval time;
+    // Store the countdown time. Any thread may start the timer
+    std::atomic< Milliseconds > time;
+
+    TimerData( ManagerImpl* m, UniqueID id, bool r ) : manager( m ), timerID( id ), timer( userTimerCB, (void*)this ), repeat( r ), time( Milliseconds( 0 ) ) {}
   };
 
 }
@@ -0,0 +1,77 @@
+
+#ifndef STEWARDESS_TIMER_REGISTRY_H_
+#define STEWARDESS_TIMER_REGISTRY_H_
+
+#include "Definitions.h"
+
+#include <atomic>
+
+
+namespace Stewardess
+{
+
+  /*
+   * User timers by ID, for arming them without a lock.
+   *
+   * Timers are only ever added, so the table is open addressing with atomic slots and
+   *  a lookup is a few loads. Adding takes a mutex. When the table grows the old array
+   *  is kept until the registry is cleared, so a lookup that started on it still finishes
+   *  safely. The arrays double in size, so what is kept is never more than the live table.
+   */
+  class TimerRegistry
+  {
+    private:
+      struct Slot
+      {
+        std::atomic< UniqueID > key;
+        std::atomic< TimerData* > value;
+      };
+
+      struct Table
+      {
+        size_t capacity;
+        Slot* slots;
+      };
+
+      // The current table and the ones it replaced
+      std::atomic< Table* > _table;
+      std::vector< Table* > _retired;
+      size_t _size;
+
+      // Only taken to add
+      std::mutex _mutex;
+
+
+      // Allocate an empty table. The capacity is a power of two
+      static Table* _newTable( size_t );
+
+      // Return the timer with the ID in the table, or null
+      static TimerData* _find( const Table*, UniqueID );
+
+      // Put a timer in a table that has room for it
+      static void _place( Table*, UniqueID, TimerData* );
+
+    public:
+      TimerRegistry();
+      ~TimerRegistry();
+
+      TimerRegistry( const TimerRegistry& ) = delete;
+      TimerRegistry( TimerRegistry&& ) = delete;
+      TimerRegistry& operator=( const TimerRegistry& ) = delete;
+      TimerRegistry& operator=( TimerRegistry&& ) = delete;
+
+
+      // Add a timer. Returns false if the ID is already used
+      bool insert( UniqueID, TimerData* );
+
+      // Return the timer with the ID, or null. Never locks
+      TimerData* find( UniqueID ) const;
+
+      // Delete every timer and forget them. Nothing else may use the registry at the same time
+      void clear();
+  };
+
+}
+
+#endif // STEWARDESS_TIMER_REGISTRY_H_
+
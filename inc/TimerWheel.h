@@ -0,0 +1,164 @@
+
+#ifndef STEWARDESS_TIMER_WHEEL_H_
+#define STEWARDESS_TIMER_WHEEL_H_
+
+#include "Definitions.h"
+#include "LibeventIncludes.h"
+
+#include <atomic>
+
+
+namespace Stewardess
+{
+
+  class TimerWheel;
+
+
+  /*
+   * A timer that lives in a timer wheel. Owned by the user, who must keep it alive while it is armed.
+   *  The callback runs on the wheel's thread.
+   */
+  class WheelTimer
+  {
+    friend class TimerWheel;
+
+    public:
+      typedef void (*Callback)( void* );
+
+    private:
+      Callback _callback;
+      void* _argument;
+
+      // Position in the wheel. Only touched by the wheel's thread
+      WheelTimer* _previous;
+      WheelTimer* _next;
+      uint64_t _expiry;
+      uint64_t _applied;
+      unsigned char _level;
+      unsigned char _slot;
+      bool _linked;
+
+      // Tick requested by the last arm, or zero for a cancel. Applied by the wheel's thread
+      std::atomic<uint64_t> _requested;
+
+      // True while waiting in the wheel's command stack, and the next timer in it
+      std::atomic_bool _queued;
+      WheelTimer* _queueNext;
+
+    public:
+      WheelTimer( Callback c = nullptr, void* a = nullptr ) : _callback( c ), _argument( a ), _previous( nullptr ), _next( nullptr ),
+        _expiry( 0 ), _applied( 0 ), _level( 0 ), _slot( 0 ), _linked( false ), _requested( 0 ), _queued( false ), _queueNext( nullptr ) {}
+
+      WheelTimer( const WheelTimer& ) = delete;
+      WheelTimer( WheelTimer&& ) = delete;
+      WheelTimer& operator=( const WheelTimer& ) = delete;
+      WheelTimer& operator=( WheelTimer&& ) = delete;
+
+      // Set what happens when it expires. Only while it isn't armed
+      void setCallback( Callback c, void* a ) { _callback = c; _argument = a; }
+  };
+
+
+  /*
+   * Hierarchical timing wheel with millisecond ticks, run by one event loop thread.
+   *
+   * Four levels of 64 slots cover about four and a half hours, anything later waits in an
+   *  overflow list. Arming and cancelling are O(1). Timers are moved down a level at a time as
+   *  their expiry gets closer. A timer given some slack has its expiry rounded up to the largest
+   *  power of two milliseconds within it, so timers that don't need precision fire together.
+   *
+   * The wheel's own thread arms and cancels timers directly. Other threads push them onto a
+   *  lock-free stack and wake the worker through its inbox eventfd, so a cancel from another thread
+   *  may arrive after the timer has fired. A single libevent timer is kept set for the next expiry.
+   */
+  class TimerWheel
+  {
+    // Fires the timers that are due
+    friend void wheelTimerCB( evutil_socket_t, short, void* );
+
+    public:
+      static const unsigned Levels = 4;
+      static const unsigned SlotBits = 6;
+      static const unsigned Slots = 1 << SlotBits;
+
+    private:
+      WorkerData* _owner;
+      event* _event;
+
+      // Tick zero, and the last tick processed
+      std::chrono::steady_clock::time_point _start;
+      uint64_t _current;
+
+      // Tick the libevent timer is set for. Max if it isn't set
+      uint64_t _scheduled;
+
+      // Lists of timers in each slot, and which slots are occupied
+      WheelTimer* _slots[ Levels ][ Slots ];
+      uint64_t _occupied[ Levels ];
+
+      // Timers beyond the last level
+      WheelTimer* _overflow;
+
+      // Timers armed or cancelled by other threads
+      std::atomic< WheelTimer* > _commands;
+
+      // Number of armed timers
+      std::atomic<size_t> _size;
+
+
+      // Current tick from the clock
+      uint64_t _now() const;
+
+      // Put the timer in the slot for its expiry
+      void _link( WheelTimer* );
+
+      // Take the timer out of its slot
+      void _unlink( WheelTimer* );
+
+      // Apply the last arm or cancel requested for the timer
+      void _apply( WheelTimer* );
+
+      // Move the timers in a slot of a higher level down towards level zero
+      void _cascade( unsigned, unsigned );
+
+      // Process every tick up to the given one, firing the timers
+      void _advance( uint64_t );
+
+      // Return the next tick something needs doing. Max if the wheel is empty
+      uint64_t _nextTick() const;
+
+      // Make sure the libevent timer fires by the next tick that needs doing
+      void _schedule();
+
+      // Run by the libevent timer
+      void _expire();
+
+    public:
+      explicit TimerWheel( WorkerData* );
+      ~TimerWheel();
+
+      TimerWheel( const TimerWheel& ) = delete;
+      TimerWheel( TimerWheel&& ) = delete;
+      TimerWheel& operator=( const TimerWheel& ) = delete;
+      TimerWheel& operator=( TimerWheel&& ) = delete;
+
+
+      // Arm the timer to fire after the delay, plus up to the slack to share a tick with others.
+      //  Re-arming moves it. Any thread
+      void arm( WheelTimer*, Milliseconds, Milliseconds = Milliseconds( 0 ) );
+
+      // Disarm the timer. Any thread
+      void cancel( WheelTimer* );
+
+      // Apply arms and cancels pushed by other threads. Called on the wheel's thread when its inbox wakes it
+      void processCommands();
+
+
+      // Number of armed timers. Arms and cancels from other threads only count once the wheel has applied them
+      size_t size() const { return _size.load( std::memory_order_relaxed ); }
+  };
+
+}
+
+#endif // STEWARDESS_TIMER_WHEEL_H_
+
@@ -0,0 +1,61 @@
+
+#ifndef STEWARDESS_TOPOLOGY_H_
+#define STEWARDESS_TOPOLOGY_H_
+
+#include "Definitions.h"
+
+#include <pthread.h>
+
+
+namespace Stewardess
+{
+
+  struct NUMANode
+  {
+    unsigned id;
+    CPUSet cpus;
+  };
+
+  typedef std::vector< NUMANode > NUMANodeVector;
+
+
+  /*
+   * CPU and memory layout of the machine, read from sysfs.
+   * Falls back to a single node holding every online CPU if sysfs is unavailable.
+   */
+  struct Topology
+  {
+    // Every CPU the kernel has online
+    CPUSet online;
+
+    // CPUs removed from the scheduler with isolcpus
+    CPUSet isolated;
+
+    // NUMA nodes that have CPUs
+    NUMANodeVector nodes;
+
+
+    // Read the current machine's layout
+    static Topology detect();
+
+    // Return the node that owns a CPU, or -1 if unknown
+    int nodeOf( unsigned ) const;
+  };
+
+
+  // Parse a kernel cpulist string, e.g. "0-3,8,10-11"
+  CPUSet parseCPUList( const std::string& );
+
+  // Format a CPU set as a kernel cpulist string
+  std::string formatCPUList( const CPUSet& );
+
+  // Restrict a thread to the given CPUs. Returns false if the kernel refused
+  bool pinThread( pthread_t, const CPUSet& );
+
+  // Ask the kernel to prefer the given node for the calling thread's new memory. Returns false if it refused
+  bool preferNUMANode( int );
+
+}
+
+#endif // STEWARDESS_TOPOLOGY_H_
+
@@ -4,16 +4,83 @@
 
 #include "Definitions.h"
 #include "LibeventIncludes.h"
+#include "ConnectionTable.h"
+#include "ConnectionSlab.h"
+#include "TimerWheel.h"
+
+#include <atomic>
 
 
 namespace Stewardess
 {
 
+  class ManagerImpl;
+
   struct WorkerData
   {
+    ManagerImpl* manager;
     event_base* eventBase;
     event* tickEvent;
     timeval tickTime;
+
+    // This worker's own SO_REUSEPORT listener, if configured
+    evconnlistener* listener;
+
+    // Jobs posted by other threads to run on this worker's event loop
+    WorkerJobQueue jobs;
+    std::mutex jobsMutex;
+    event* jobEvent;
+
+    // Lock-free stack of connections with writes queued by other threads, and the eventfd that wakes the worker
+    std::atomic< Connection* > inbox;
+    int inboxFD;
+    event* inboxEvent;
+
+    // Timers that run on this worker's loop
+    TimerWheel* timers;
+
+    // Periodic check of this worker's connections for read, write and idle timeouts
+    WheelTimer timeoutTimer;
+
+    // Connections created for this worker. They keep their slot, and so their ID, when they migrate
+    ConnectionSlab* connectionSlab;
+
+    // This worker's shard of the connection registry. Other threads only lock it to iterate
+    ConnectionTable connectionTable;
+    mutable std::mutex connectionTableMutex;
+
+    // Load counters read by the placement policies without locking
+    std::atomic<size_t> connections;
+    std::atomic<uint64_t> busyTime;
+    std::atomic<unsigned> utilization;
+
+    // CPUs the thread is pinned to when it starts, and the NUMA node to take memory from. Empty and -1 for neither
+    CPUSet cpus;
+    int numaNode;
+
+    // Last utilization sample and the busy time during it. Only touched by the control thread
+    uint64_t sampleBusyTime;
+    uint64_t sampleBusyDelta;
+    std::chrono::steady_clock::time_point sampleTime;
+  };
+
+
+  // Adds the time spent in a callback to the worker's busy time, and optionally a connection's
+  class WorkerBusyTimer
+  {
+    private:
+      WorkerData* _worker;
+      std::atomic<uint64_t>* _other;
+      std::chrono::steady_clock::time_point _start;
+
+    public:
+      explicit WorkerBusyTimer( WorkerData* w, std::atomic<uint64_t>* o = nullptr ) : _worker( w ), _other( o ), _start( std::chrono::steady_clock::now() ) {}
+      ~WorkerBusyTimer()
+      {
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - _start ).count();
+        _worker->busyTime.fetch_add( elapsed, std::memory_order_relaxed );
+        if ( _other != nullptr ) _other->fetch_add( elapsed, std::memory_order_relaxed );
+      }
   };
 
 
@@ -25,7 +92,31 @@ namespace Stewardess
   };
 
 
-  void workerThread( WorkerData );
+  void workerThread( WorkerData* );
+
+
+  // Return the worker whose loop the calling thread runs, or null
+  WorkerData* getCurrentWorker();
+
+  // Mark the calling thread as running the worker's loop
+  void setCurrentWorker( WorkerData* );
+
+
+  // Create the worker's inbox eventfd and its read event
+  void openWorkerInbox( WorkerData* );
+
+  // Free the inbox event and close the eventfd
+  void closeWorkerInbox( WorkerData* );
+
+  // Wake the worker to drain its inbox
+  void signalWorkerInbox( WorkerData* );
+
+
+  // Queue a job on the worker and make sure its job event is pending
+  void postWorkerJob( WorkerData*, WorkerJob );
+
+  // Run every job left on a worker whose loop has stopped, including any they post
+  void drainWorkerJobs( WorkerData* );
 
 }
 
@@ -14,7 +14,8 @@ namespace Stewardess
     capacity( c ),
     size( 0 ),
     next( nullptr ),
-    data( new char[ c ] )
+    data( new char[ c ] ),
+    memory( data )
   {
   }
 
@@ -23,22 +24,25 @@ namespace Stewardess
     capacity( size ),
     size( size ),
     next( nullptr ),
-    data( data )
+    data( data ),
+    memory( data )
   {
   }
 
 
   Buffer::Chunk::~Chunk()
   {
-    delete[] data;
+    delete[] memory;
   }
 
 
   void Buffer::Chunk::reallocate( size_t cap )
   {
     char* old_data = data;
+    char* old_memory = memory;
 
     data = new char[ cap ];
+    memory = data;
 
     if ( cap >= size )
     {
@@ -52,7 +56,7 @@ namespace Stewardess
       std::memcpy( data, old_data, size );
     }
 
-    delete[] old_data;
+    delete[] old_memory;
   }
 
 
@@ -64,6 +68,8 @@ namespace Stewardess
     _chunk( chunk ),
     _position( 0 )
   {
+    // Skip any empty chunks at the start
+    this->advance( 0 );
   }
 
 
@@ -75,11 +81,7 @@ namespace Stewardess
 
   void Buffer::Iterator::increment()
   {
-    if ( ++_position >= _chunk->size )
-    {
-      _position = 0;
-      _chunk = _chunk->next;
-    }
+    this->advance( 1 );
   }
 
 
@@ -89,6 +91,29 @@ namespace Stewardess
   }
 
 
+  const char* Buffer::Iterator::data() const
+  {
+    return &_chunk->data[ _position ];
+  }
+
+
+  size_t Buffer::Iterator::remaining() const
+  {
+    return _chunk->size - _position;
+  }
+
+
+  void Buffer::Iterator::advance( size_t num )
+  {
+    _position += num;
+    while ( _chunk != nullptr && _position >= _chunk->size )
+    {
+      _position -= _chunk->size;
+      _chunk = _chunk->next;
+    }
+  }
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
   // Buffer member function definitions
 
@@ -120,12 +145,14 @@ namespace Stewardess
         _finish = new Chunk( current->capacity );
         _start = _finish;
         std::memcpy( _finish->data, current->data, current->size );
+        _finish->size = current->size;
       }
       else
       {
         _finish->next = new Chunk( current->capacity );
         _finish = _finish->next;
         std::memcpy( _finish->data, current->data, current->size );
+        _finish->size = current->size;
       }
       current = current->next;
     }
@@ -149,12 +176,14 @@ namespace Stewardess
         _finish = new Chunk( current->capacity );
         _start = _finish;
         std::memcpy( _finish->data, current->data, current->size );
+        _finish->size = current->size;
       }
       else
       {
         _finish->next = new Chunk( current->capacity );
         _finish = _finish->next;
         std::memcpy( _finish->data, current->data, current->size );
+        _finish->size = current->size;
       }
       current = current->next;
     }
@@ -163,6 +192,14 @@ namespace Stewardess
   }
 
 
+  Buffer::Buffer( Buffer&& other ) :
+    _maxChunkSize( other._maxChunkSize ),
+    _start( std::exchange( other._start, nullptr ) ),
+    _finish( std::exchange( other._finish, nullptr ) )
+  {
+  }
+
+
   Buffer& Buffer::operator=( Buffer&& other )
   {
     this->clear();
@@ -237,6 +274,7 @@ namespace Stewardess
       _start = _start->next;
       delete temp;
     }
+    _finish = nullptr;
   }
 
 
@@ -320,6 +358,100 @@ namespace Stewardess
   }
 
 
+  void Buffer::append( Buffer&& other )
+  {
+    if ( other._start == nullptr )
+      return;
+
+    if ( _start != nullptr )
+    {
+      _finish->next = std::exchange( other._start, nullptr );
+    }
+    else
+    {
+      _start = std::exchange( other._start, nullptr );
+    }
+    _finish = std::exchange( other._finish, nullptr );
+  }
+
+
+  void Buffer::splice( Buffer& other, size_t num )
+  {
+    while ( num > 0 && other._start != nullptr )
+    {
+      Chunk* chunk = other._start;
+
+      if ( chunk->size <= num )
+      {
+        // All of it, so just relink the chunk
+        num -= chunk->size;
+        other._start = chunk->next;
+        if ( other._start == nullptr ) other._finish = nullptr;
+        chunk->next = nullptr;
+      }
+      else if ( num * 2 <= chunk->size )
+      {
+        // Copy the front and leave the rest where it is
+        char* front = new char[ num ];
+        std::memcpy( front, chunk->data, num );
+        chunk->data += num;
+        chunk->size -= num;
+        chunk->capacity -= num;
+
+        chunk = new Chunk( front, num );
+        num = 0;
+      }
+      else
+      {
+        // Copy the back into a chunk of its own and move the front
+        size_t rest = chunk->size - num;
+        char* back = new char[ rest ];
+        std::memcpy( back, chunk->data + num, rest );
+
+        Chunk* remainder = new Chunk( back, rest );
+        remainder->next = chunk->next;
+        other._start = remainder;
+        if ( other._finish == chunk ) other._finish = remainder;
+
+        chunk->size = num;
+        chunk->next = nullptr;
+        num = 0;
+      }
+
+      if ( _start != nullptr )
+      {
+        _finish->next = chunk;
+        _finish = chunk;
+      }
+      else
+      {
+        _start = chunk;
+        _finish = chunk;
+      }
+    }
+  }
+
+
+  void Buffer::skip( size_t num )
+  {
+    while ( num > 0 && _start != nullptr )
+    {
+      if ( _start->size <= num )
+      {
+        num -= _start->size;
+        this->popChunk();
+      }
+      else
+      {
+        _start->data += num;
+        _start->size -= num;
+        _start->capacity -= num;
+        num = 0;
+      }
+    }
+  }
+
+
   const char* Buffer::chunk() const
   {
     return _start->data;
@@ -340,6 +472,9 @@ namespace Stewardess
       _start = _start->next;
       delete temp;
     }
+
+    if ( _start == nullptr )
+      _finish = nullptr;
   }
 
 
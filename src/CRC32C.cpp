@@ -0,0 +1,154 @@
+
+#include "CRC32C.h"
+
+#include <cstring>
+
+#if defined( __x86_64__ )
+#include <nmmintrin.h>
+#include <cpuid.h>
+#endif
+
+
+namespace Stewardess
+{
+
+  // Reflected Castagnoli polynomial
+  static const uint32_t Polynomial = 0x82F63B78;
+
+
+  // Lookup tables for slicing-by-8. Table[0] is the classic byte-wise table
+  struct CRC32CTables
+  {
+    uint32_t table[8][256];
+
+    CRC32CTables()
+    {
+      for ( uint32_t i = 0; i < 256; ++i )
+      {
+        uint32_t crc = i;
+        for ( int j = 0; j < 8; ++j )
+        {
+          crc = ( crc & 1 ) ? ( crc >> 1 ) ^ Polynomial : ( crc >> 1 );
+        }
+        table[0][i] = crc;
+      }
+
+      for ( uint32_t i = 0; i < 256; ++i )
+      {
+        for ( int k = 1; k < 8; ++k )
+        {
+          table[k][i] = ( table[k-1][i] >> 8 ) ^ table[0][ table[k-1][i] & 0xFF ];
+        }
+      }
+    }
+  };
+
+  uint32_t crc32cSoftware( uint32_t crc, const char* data, size_t size )
+  {
+    static const CRC32CTables tables;
+    const unsigned char* bytes = (const unsigned char*)data;
+    const uint32_t (*t)[256] = tables.table;
+    crc = ~crc;
+
+    // Align to 8 bytes so the wide loads are cheap
+    while ( size > 0 && ( (uintptr_t)bytes & 7 ) != 0 )
+    {
+      crc = t[0][ ( crc ^ *bytes++ ) & 0xFF ] ^ ( crc >> 8 );
+      --size;
+    }
+
+    while ( size >= 8 )
+    {
+      uint32_t low;
+      uint32_t high;
+      std::memcpy( &low, bytes, 4 );
+      std::memcpy( &high, bytes + 4, 4 );
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      low = __builtin_bswap32( low );
+      high = __builtin_bswap32( high );
+#endif
+      low ^= crc;
+      crc = t[7][ low & 0xFF ] ^ t[6][ ( low >> 8 ) & 0xFF ] ^ t[5][ ( low >> 16 ) & 0xFF ] ^ t[4][ low >> 24 ] ^
+            t[3][ high & 0xFF ] ^ t[2][ ( high >> 8 ) & 0xFF ] ^ t[1][ ( high >> 16 ) & 0xFF ] ^ t[0][ high >> 24 ];
+      bytes += 8;
+      size -= 8;
+    }
+
+    while ( size > 0 )
+    {
+      crc = t[0][ ( crc ^ *bytes++ ) & 0xFF ] ^ ( crc >> 8 );
+      --size;
+    }
+
+    return ~crc;
+  }
+
+
+#if defined( __x86_64__ )
+
+  __attribute__(( target( "sse4.2" ) ))
+  uint32_t crc32cHardware( uint32_t crc, const char* data, size_t size )
+  {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t crc64 = ~crc;
+
+    while ( size > 0 && ( (uintptr_t)bytes & 7 ) != 0 )
+    {
+      crc64 = _mm_crc32_u8( (uint32_t)crc64, *bytes++ );
+      --size;
+    }
+
+    while ( size >= 8 )
+    {
+      uint64_t word;
+      std::memcpy( &word, bytes, 8 );
+      crc64 = _mm_crc32_u64( crc64, word );
+      bytes += 8;
+      size -= 8;
+    }
+
+    while ( size > 0 )
+    {
+      crc64 = _mm_crc32_u8( (uint32_t)crc64, *bytes++ );
+      --size;
+    }
+
+    return ~(uint32_t)crc64;
+  }
+
+
+  bool crc32cHardwareAvailable()
+  {
+    unsigned int eax, ebx, ecx, edx;
+    if ( ! __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+      return false;
+    return ( ecx & bit_SSE4_2 ) != 0;
+  }
+
+#else
+
+  uint32_t crc32cHardware( uint32_t crc, const char* data, size_t size )
+  {
+    return crc32cSoftware( crc, data, size );
+  }
+
+
+  bool crc32cHardwareAvailable()
+  {
+    return false;
+  }
+
+#endif
+
+
+  typedef uint32_t (*CRC32CFunction)( uint32_t, const char*, size_t );
+
+  uint32_t crc32c( uint32_t crc, const char* data, size_t size )
+  {
+    // Chosen once, the first time a checksum is needed
+    static const CRC32CFunction implementation = crc32cHardwareAvailable() ? crc32cHardware : crc32cSoftware;
+    return implementation( crc, data, size );
+  }
+
+}
+
@@ -0,0 +1,158 @@
+
+#include "ChecksumFilter.h"
+#include "CRC32C.h"
+
+#include <cstring>
+
+
+namespace Stewardess
+{
+
+  static const size_t FrameHeaderSize = 4;
+  static const size_t FrameTrailerSize = 4;
+
+  static const char* ErrorChecksum = "Frame failed the CRC32C check and was dropped.";
+  static const char* ErrorFrameSize = "Frame length is larger than the maximum. Stream is corrupt.";
+
+
+  // Write a 32 bit integer big-endian
+  static void packInteger( uint32_t value, unsigned char* data )
+  {
+    data[0] = ( value >> 24 ) & 0xFF;
+    data[1] = ( value >> 16 ) & 0xFF;
+    data[2] = ( value >> 8 ) & 0xFF;
+    data[3] = value & 0xFF;
+  }
+
+
+  // Read a big-endian 32 bit integer
+  static uint32_t unpackInteger( const unsigned char* data )
+  {
+    return ( (uint32_t)data[0] << 24 ) | ( (uint32_t)data[1] << 16 ) | ( (uint32_t)data[2] << 8 ) | (uint32_t)data[3];
+  }
+
+
+  ChecksumFilter::ChecksumFilter( size_t max_frame_size, size_t chunk_size ) :
+    _maxFrameSize( max_frame_size ),
+    _header(),
+    _headerFill( 0 ),
+    _frame( chunk_size ),
+    _frameRemaining( 0 ),
+    _trailer(),
+    _trailerFill( 0 ),
+    _crc( 0 )
+  {
+  }
+
+
+  bool ChecksumFilter::write( Buffer&& input, Buffer& output )
+  {
+    size_t size = input.getSize();
+    if ( size == 0 ) return true;
+
+    // The peer refuses anything bigger, so send it in pieces it will take
+    while ( size > _maxFrameSize )
+    {
+      Buffer piece( input.allocationSize() );
+      piece.splice( input, _maxFrameSize );
+      this->_writeFrame( std::move( piece ), output );
+      size -= _maxFrameSize;
+    }
+
+    this->_writeFrame( std::move( input ), output );
+    return true;
+  }
+
+
+  void ChecksumFilter::_writeFrame( Buffer&& input, Buffer& output )
+  {
+    char* header = new char[ FrameHeaderSize ];
+    packInteger( input.getSize(), (unsigned char*)header );
+    uint32_t crc = crc32c( 0, header, FrameHeaderSize );
+
+    for ( Buffer::Iterator it = input.getIterator(); it; it.advance( it.remaining() ) )
+    {
+      crc = crc32c( crc, it.data(), it.remaining() );
+    }
+
+    char* trailer = new char[ FrameTrailerSize ];
+    packInteger( crc, (unsigned char*)trailer );
+
+    output.pushChunk( header, FrameHeaderSize );
+    output.append( std::move( input ) );
+    output.pushChunk( trailer, FrameTrailerSize );
+  }
+
+
+  bool ChecksumFilter::read( Buffer&& input, Buffer& output )
+  {
+    while ( input )
+    {
+      const char* data = input.chunk();
+      size_t size = input.chunkSize();
+
+      if ( size == 0 )
+      {
+        input.popChunk();
+      }
+      else if ( _headerFill < FrameHeaderSize )
+      {
+        size_t num = std::min( FrameHeaderSize - _headerFill, size );
+        std::memcpy( &_header[ _headerFill ], data, num );
+        _headerFill += num;
+        input.skip( num );
+
+        if ( _headerFill == FrameHeaderSize )
+        {
+          _frameRemaining = unpackInteger( _header );
+          if ( _frameRemaining > _maxFrameSize )
+          {
+            this->pushError( ErrorFrameSize );
+            return false;
+          }
+          _crc = crc32c( 0, (const char*)_header, FrameHeaderSize );
+        }
+      }
+      else if ( _frameRemaining > 0 )
+      {
+        // Checksum the body in place, then move it over
+        size_t num = std::min( _frameRemaining, size );
+        _crc = crc32c( _crc, data, num );
+        _frame.splice( input, num );
+        _frameRemaining -= num;
+      }
+      else
+      {
+        size_t num = std::min( FrameTrailerSize - _trailerFill, size );
+        std::memcpy( &_trailer[ _trailerFill ], data, num );
+        _trailerFill += num;
+        input.skip( num );
+
+        if ( _trailerFill == FrameTrailerSize )
+          this->_finishFrame( output );
+      }
+    }
+
+    return true;
+  }
+
+
+  void ChecksumFilter::_finishFrame( Buffer& output )
+  {
+    if ( unpackInteger( _trailer ) == _crc )
+    {
+      output.append( std::move( _frame ) );
+    }
+    else
+    {
+      this->pushError( ErrorChecksum );
+      _frame.clear();
+    }
+
+    _headerFill = 0;
+    _trailerFill = 0;
+    _crc = 0;
+  }
+
+}
+
@@ -0,0 +1,379 @@
+
+#include "CompressionFilter.h"
+#include "Buffer.h"
+#include "Exception.h"
+
+#include <cstring>
+#include <ctime>
+
+
+namespace Stewardess
+{
+
+  static const char HelloMagic[3] = { 'S', 'W', 'Z' };
+  static const char HelloDeflate = 0x01;
+
+  static const unsigned char FrameRaw = 0;
+  static const unsigned char FrameDeflate = 1;
+  static const size_t FrameHeaderSize = 5;
+
+  static const char* ErrorUnknownFrame = "Unknown compression frame type.";
+  static const char* ErrorInflate = "Failed to inflate compressed frame.";
+  static const char* ErrorFrameSize = "Compression frame exceeds the maximum size.";
+  static const char* ErrorDeflate = "Failed to deflate serialized buffer.";
+  static const char* ErrorHandshake = "Compression handshake timed out.";
+
+
+  // CPU time used by the calling thread
+  static int64_t threadCPUTime()
+  {
+    timespec time;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &time );
+    return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+  }
+
+
+  // Copy a character array into a new chunk at the end of the buffer
+  static void pushCopy( const char* data, size_t size, Buffer& buffer )
+  {
+    char* chunk = new char[ size ];
+    std::memcpy( chunk, data, size );
+    buffer.pushChunk( chunk, size );
+  }
+
+
+  CompressionFilter::CompressionFilter( int level, size_t threshold, size_t chunk_size, size_t max_frame_size, Microseconds negotiation_timeout ) :
+    _state( State::Negotiating ),
+    _level( level ),
+    _threshold( threshold ),
+    _chunkSize( chunk_size ),
+    _maxFrameSize( max_frame_size ),
+    _deflate(),
+    _inflate(),
+    _scratch( new char[ chunk_size ] ),
+    _hello(),
+    _helloFill( 0 ),
+    _negotiationTimeout( negotiation_timeout ),
+    _negotiationDeadline( CoarseClock::now() + negotiation_timeout ),
+    _header(),
+    _headerFill( 0 ),
+    _frameRemaining( 0 ),
+    _frameInflated( 0 ),
+    _plainBytesOut( 0 ),
+    _wireBytesOut( 0 ),
+    _wireBytesIn( 0 ),
+    _plainBytesIn( 0 ),
+    _compressTime( 0 ),
+    _decompressTime( 0 )
+  {
+    // Raw deflate streams. The frame header already says what the data is
+    if ( deflateInit2( &_deflate, _level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+      delete[] _scratch;
+      throw Exception( "Could not initialise the deflate stream." );
+    }
+    if ( inflateInit2( &_inflate, -15 ) != Z_OK )
+    {
+      deflateEnd( &_deflate );
+      delete[] _scratch;
+      throw Exception( "Could not initialise the inflate stream." );
+    }
+  }
+
+
+  CompressionFilter::~CompressionFilter()
+  {
+    deflateEnd( &_deflate );
+    inflateEnd( &_inflate );
+    delete[] _scratch;
+  }
+
+
+  void CompressionFilter::open( Buffer& output )
+  {
+    char* data = new char[ 4 ];
+    std::memcpy( data, HelloMagic, 3 );
+    data[3] = HelloDeflate;
+    output.pushChunk( data, 4 );
+  }
+
+
+  bool CompressionFilter::expire( SteadyTime now )
+  {
+    if ( _state == State::Failed ) return false;
+
+    // A partial hello means the peer is negotiating, the rest is on its way
+    if ( _state != State::Negotiating || _helloFill > 0 || _negotiationTimeout.count() == 0 ) return true;
+
+    if ( now > _negotiationDeadline )
+    {
+      // Can't tell a peer that doesn't compress from one that is slow to say so
+      _state = State::Failed;
+      this->pushError( ErrorHandshake );
+      return false;
+    }
+    return true;
+  }
+
+
+  bool CompressionFilter::write( Buffer&& input, Buffer& output )
+  {
+    if ( _state == State::Failed )
+    {
+      return false;
+    }
+    else if ( _state == State::Enabled )
+    {
+      return this->_compress( input, output );
+    }
+    else
+    {
+      output.append( std::move( input ) );
+      return true;
+    }
+  }
+
+
+  bool CompressionFilter::_compress( const Buffer& input, Buffer& output )
+  {
+    int64_t start_time = threadCPUTime();
+    size_t size = input.getSize();
+    Buffer body( _chunkSize );
+    unsigned char type;
+
+    if ( size < _threshold )
+    {
+      type = FrameRaw;
+      body = input;
+    }
+    else
+    {
+      type = FrameDeflate;
+
+      // Feed every chunk through, then flush so the peer can inflate the whole frame now
+      for ( Buffer::Iterator it = input.getIterator(); it; it.advance( it.remaining() ) )
+      {
+        if ( ! this->_deflateData( it.data(), it.remaining(), Z_NO_FLUSH, body ) )
+          return false;
+      }
+      if ( ! this->_deflateData( nullptr, 0, Z_SYNC_FLUSH, body ) )
+        return false;
+    }
+
+    size_t body_size = body.getSize();
+    char* header = new char[ FrameHeaderSize ];
+    header[0] = type;
+    header[1] = ( body_size >> 24 ) & 0xFF;
+    header[2] = ( body_size >> 16 ) & 0xFF;
+    header[3] = ( body_size >> 8 ) & 0xFF;
+    header[4] = body_size & 0xFF;
+
+    output.pushChunk( header, FrameHeaderSize );
+    output.append( std::move( body ) );
+
+    _plainBytesOut += size;
+    _wireBytesOut += FrameHeaderSize + body_size;
+    _compressTime += threadCPUTime() - start_time;
+    return true;
+  }
+
+
+  bool CompressionFilter::read( Buffer&& input, Buffer& output )
+  {
+    // Anything after a failed handshake can't be read safely
+    if ( _state == State::Failed )
+    {
+      return false;
+    }
+
+    // Peer didn't negotiate, so nothing to do
+    if ( _state == State::Disabled )
+    {
+      size_t size = input.getSize();
+      _wireBytesIn += size;
+      _plainBytesIn += size;
+      output.append( std::move( input ) );
+      return true;
+    }
+
+    int64_t start_time = threadCPUTime();
+    size_t start_size = output.getSize();
+    bool good = true;
+
+    for ( Buffer::Iterator it = input.getIterator(); it && good; it.advance( it.remaining() ) )
+    {
+      const char* data = it.data();
+      size_t size = it.remaining();
+      _wireBytesIn += size;
+
+      // Look for the peer's hello
+      while ( size > 0 && _state == State::Negotiating )
+      {
+        _hello[ _helloFill++ ] = *data;
+        ++data;
+        --size;
+
+        if ( _helloFill <= 3 && _hello[ _helloFill-1 ] != HelloMagic[ _helloFill-1 ] )
+        {
+          // Peer isn't negotiating. Everything received so far is plain data
+          _state = State::Disabled;
+          pushCopy( _hello, _helloFill, output );
+        }
+        else if ( _helloFill == 4 )
+        {
+          _state = ( _hello[3] & HelloDeflate ) ? State::Enabled : State::Disabled;
+        }
+      }
+
+      if ( size == 0 ) continue;
+
+      if ( _state == State::Enabled )
+      {
+        good = this->_decode( data, size, output );
+      }
+      else
+      {
+        pushCopy( data, size, output );
+      }
+    }
+
+    _plainBytesIn += output.getSize() - start_size;
+    _decompressTime += threadCPUTime() - start_time;
+    return good;
+  }
+
+
+  bool CompressionFilter::_decode( const char* data, size_t size, Buffer& output )
+  {
+    while ( size > 0 )
+    {
+      if ( _headerFill < FrameHeaderSize )
+      {
+        size_t num = std::min( FrameHeaderSize - _headerFill, size );
+        std::memcpy( &_header[ _headerFill ], data, num );
+        _headerFill += num;
+        data += num;
+        size -= num;
+
+        if ( _headerFill == FrameHeaderSize )
+        {
+          if ( _header[0] != FrameRaw && _header[0] != FrameDeflate )
+          {
+            this->pushError( ErrorUnknownFrame );
+            return false;
+          }
+          _frameRemaining = ( (size_t)_header[1] << 24 ) | ( (size_t)_header[2] << 16 ) | ( (size_t)_header[3] << 8 ) | (size_t)_header[4];
+          _frameInflated = 0;
+          if ( _frameRemaining > _maxFrameSize )
+          {
+            this->pushError( ErrorFrameSize );
+            return false;
+          }
+          if ( _frameRemaining == 0 )
+            _headerFill = 0;
+        }
+        continue;
+      }
+
+      size_t num = std::min( _frameRemaining, size );
+      if ( _header[0] == FrameDeflate )
+      {
+        if ( ! this->_inflateData( data, num, output ) )
+          return false;
+      }
+      else
+      {
+        pushCopy( data, num, output );
+      }
+
+      data += num;
+      size -= num;
+      _frameRemaining -= num;
+
+      if ( _frameRemaining == 0 )
+        _headerFill = 0;
+    }
+
+    return true;
+  }
+
+
+  bool CompressionFilter::_deflateData( const char* data, size_t size, int flush, Buffer& output )
+  {
+    _deflate.next_in = (Bytef*)data;
+    _deflate.avail_in = size;
+
+    do
+    {
+      _deflate.next_out = (Bytef*)_scratch;
+      _deflate.avail_out = _chunkSize;
+
+      int result = ::deflate( &_deflate, flush );
+      if ( result == Z_STREAM_ERROR )
+      {
+        this->pushError( ErrorDeflate );
+        return false;
+      }
+
+      size_t produced = _chunkSize - _deflate.avail_out;
+      if ( produced > 0 )
+        pushCopy( _scratch, produced, output );
+    }
+    while ( _deflate.avail_out == 0 );
+
+    return true;
+  }
+
+
+  bool CompressionFilter::_inflateData( const char* data, size_t size, Buffer& output )
+  {
+    _inflate.next_in = (Bytef*)data;
+    _inflate.avail_in = size;
+
+    do
+    {
+      _inflate.next_out = (Bytef*)_scratch;
+      _inflate.avail_out = _chunkSize;
+
+      int result = ::inflate( &_inflate, Z_SYNC_FLUSH );
+      if ( result != Z_OK && result != Z_BUF_ERROR )
+      {
+        this->pushError( ErrorInflate );
+        return false;
+      }
+
+      // A small frame can inflate to almost anything, so stop as soon as it is too big
+      size_t produced = _chunkSize - _inflate.avail_out;
+      _frameInflated += produced;
+      if ( _frameInflated > _maxFrameSize )
+      {
+        this->pushError( ErrorFrameSize );
+        return false;
+      }
+      if ( produced > 0 )
+        pushCopy( _scratch, produced, output );
+
+      // Nothing more can be done until the next section arrives
+      if ( result == Z_BUF_ERROR )
+        break;
+    }
+    while ( _inflate.avail_in > 0 || _inflate.avail_out == 0 );
+
+    return true;
+  }
+
+
+  CompressionStatistics CompressionFilter::getStatistics() const
+  {
+    CompressionStatistics stats;
+    stats.plainBytesOut = _plainBytesOut;
+    stats.wireBytesOut = _wireBytesOut;
+    stats.wireBytesIn = _wireBytesIn;
+    stats.plainBytesIn = _plainBytesIn;
+    stats.compressTime = std::chrono::nanoseconds( _compressTime );
+    stats.decompressTime = std::chrono::nanoseconds( _decompressTime );
+    return stats;
+  }
+
+}
+
@@ -0,0 +1,115 @@
+
+#include "ComputeExecutor.h"
+
+
+namespace Stewardess
+{
+
+  // Index of the pool queue owned by this thread
+  static thread_local ComputeExecutor* currentExecutor = nullptr;
+  static thread_local size_t currentQueue = 0;
+
+
+  ComputeExecutor::ComputeExecutor( unsigned number ) :
+    _queues(),
+    _threads(),
+    _pending( 0 ),
+    _nextQueue( 0 ),
+    _stop( false )
+  {
+    for ( unsigned i = 0; i < number; ++i )
+    {
+      _queues.push_back( new WorkQueue() );
+    }
+    for ( unsigned i = 0; i < number; ++i )
+    {
+      _threads.push_back( std::thread( &ComputeExecutor::_run, this, i ) );
+    }
+  }
+
+
+  ComputeExecutor::~ComputeExecutor()
+  {
+    {
+      GuardLock lk( _sleepMutex );
+      _stop = true;
+    }
+    _sleepCondition.notify_all();
+
+    for ( std::vector< std::thread >::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      it->join();
+    }
+
+    // Anything left is dropped
+    for ( WorkQueueVector::iterator it = _queues.begin(); it != _queues.end(); ++it )
+    {
+      delete (*it);
+    }
+  }
+
+
+  void ComputeExecutor::submit( WorkerJob job )
+  {
+    size_t index = ( currentExecutor == this ) ? currentQueue : _nextQueue.fetch_add( 1, std::memory_order_relaxed ) % _queues.size();
+
+    // Counted before it can be taken, so the count never drops below zero.
+    //  Locked so a thread can't miss the job between checking and sleeping
+    {
+      GuardLock lk( _sleepMutex );
+      _pending.fetch_add( 1 );
+    }
+
+    {
+      GuardLock lk( _queues[ index ]->mutex );
+      _queues[ index ]->jobs.push_back( std::move( job ) );
+    }
+    _sleepCondition.notify_one();
+  }
+
+
+  bool ComputeExecutor::_take( size_t index, WorkerJob& job )
+  {
+    // Our own queue first, then everyone else's
+    for ( size_t i = 0; i < _queues.size(); ++i )
+    {
+      WorkQueue* queue = _queues[ ( index + i ) % _queues.size() ];
+      GuardLock lk( queue->mutex );
+      if ( ! queue->jobs.empty() )
+      {
+        job = std::move( queue->jobs.front() );
+        queue->jobs.pop_front();
+        _pending.fetch_sub( 1 );
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  void ComputeExecutor::_run( size_t index )
+  {
+    currentExecutor = this;
+    currentQueue = index;
+
+    while ( true )
+    {
+      {
+        UniqueLock lk( _sleepMutex );
+        _sleepCondition.wait( lk, [this]() { return _stop || _pending > 0; } );
+        if ( _stop ) break;
+      }
+
+      WorkerJob job;
+      if ( this->_take( index, job ) )
+      {
+        job();
+      }
+    }
+
+    currentExecutor = nullptr;
+  }
+
+}
+
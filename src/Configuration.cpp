@@ -15,12 +15,32 @@ namespace Stewardess
     _data.tickTimeModifier = 1.0;
     _data.readTimeout = { 3, 0 };
     _data.writeTimeout = { 3, 0 };
+    _data.idleTimeout = { 0, 0 };
+    _data.connectTimeout = { 10, 0 };
     _data.deathTime = { 5, 0 };
     _data.connectionCloseOnShutdown = true;
     _data.bufferSize = 4096;
     _data.numThreads = 2;
+    _data.numComputeThreads = 0;
     _data.requestListener = false;
     _data.requestSignalHandler = true;
+    _data.reusePortListeners = false;
+    _data.placementPolicy = PlacementPolicy::RoundRobin;
+    _data.rebalanceThreshold = 0.0;
+    _data.pinThreads = false;
+    _data.useIsolatedCPUs = false;
+    _data.requestCompression = false;
+    _data.compressionLevel = 6;
+    _data.compressionThreshold = 128;
+    _data.compressionTimeout = { 2, 0 };
+    _data.frameChecksum = false;
+    _data.maxFrameSize = 64*1024*1024;
+    _data.hostsFile = "/etc/hosts";
+    _data.dnsNegativeTTL = 5;
+    _data.dnsRefreshAhead = 0.1;
+    _data.poolMinConnections = 0;
+    _data.poolMaxConnections = 8;
+    _data.poolIdleTimeout = { 60, 0 };
   }
 
 
@@ -35,6 +55,12 @@ namespace Stewardess
   }
 
 
+  void Configuration::setNumberComputeThreads( unsigned n )
+  {
+    _data.numComputeThreads = n;
+  }
+
+
   void Configuration::setDefaultBufferSize( size_t buffer_size )
   {
     _data.bufferSize = buffer_size;
@@ -53,6 +79,18 @@ namespace Stewardess
   }
 
 
+  void Configuration::setIdleTimeout( unsigned int sec )
+  {
+    _data.idleTimeout.tv_sec = sec;
+  }
+
+
+  void Configuration::setConnectTimeout( unsigned int sec )
+  {
+    _data.connectTimeout.tv_sec = sec;
+  }
+
+
   void Configuration::setTickTimeModifier( float m )
   {
     if ( m < 1.0E-6 )
@@ -96,5 +134,150 @@ namespace Stewardess
     _data.requestSignalHandler = sig;
   }
 
+
+  void Configuration::setReusePortListeners( bool reuse )
+  {
+    _data.reusePortListeners = reuse;
+  }
+
+
+  void Configuration::setPlacementPolicy( PlacementPolicy policy )
+  {
+    _data.placementPolicy = policy;
+  }
+
+
+  void Configuration::setPinThreads( bool pin )
+  {
+    _data.pinThreads = pin;
+  }
+
+
+  void Configuration::setUseIsolatedCPUs( bool isolated )
+  {
+    _data.useIsolatedCPUs = isolated;
+  }
+
+
+  void Configuration::setWorkerCPUs( unsigned worker, CPUSet cpus )
+  {
+    if ( worker >= _data.workerCPUs.size() )
+    {
+      _data.workerCPUs.resize( worker+1 );
+    }
+    _data.workerCPUs[ worker ] = std::move( cpus );
+  }
+
+
+  void Configuration::setControlCPUs( CPUSet cpus )
+  {
+    _data.controlCPUs = std::move( cpus );
+  }
+
+
+  void Configuration::setRebalanceThreshold( double threshold )
+  {
+    if ( threshold < 0.0 || threshold > 1.0 )
+    {
+      throw Exception( "Rebalance threshold must be between 0 and 1" );
+    }
+    _data.rebalanceThreshold = threshold;
+  }
+
+
+  void Configuration::setRequestCompression( bool comp )
+  {
+    _data.requestCompression = comp;
+  }
+
+
+  void Configuration::setCompressionLevel( int level )
+  {
+    if ( level < 0 || level > 9 )
+    {
+      throw Exception( "Compression level must be between 0 and 9" );
+    }
+    _data.compressionLevel = level;
+  }
+
+
+  void Configuration::setCompressionThreshold( size_t threshold )
+  {
+    _data.compressionThreshold = threshold;
+  }
+
+
+  void Configuration::setCompressionTimeout( unsigned int sec )
+  {
+    _data.compressionTimeout.tv_sec = sec;
+  }
+
+
+  void Configuration::setFrameChecksum( bool check )
+  {
+    _data.frameChecksum = check;
+  }
+
+
+  void Configuration::setMaxFrameSize( size_t size )
+  {
+    if ( size == 0 )
+    {
+      throw Exception( "Maximum frame size cannot be zero" );
+    }
+    _data.maxFrameSize = size;
+  }
+
+
+  void Configuration::addNameServer( std::string address )
+  {
+    _data.nameServers.push_back( address );
+  }
+
+
+  void Configuration::setHostsFile( std::string file )
+  {
+    _data.hostsFile = file;
+  }
+
+
+  void Configuration::setDNSNegativeTTL( unsigned ttl )
+  {
+    _data.dnsNegativeTTL = ttl;
+  }
+
+
+  void Configuration::setDNSRefreshAhead( double fraction )
+  {
+    if ( fraction < 0.0 || fraction > 1.0 )
+    {
+      throw Exception( "DNS refresh ahead fraction must be between 0 and 1" );
+    }
+    _data.dnsRefreshAhead = fraction;
+  }
+
+
+  void Configuration::setPoolConnections( size_t minimum, size_t maximum )
+  {
+    if ( maximum == 0 || minimum > maximum )
+    {
+      throw Exception( "Pool maximum must be non-zero and at least the minimum" );
+    }
+    _data.poolMinConnections = minimum;
+    _data.poolMaxConnections = maximum;
+  }
+
+
+  void Configuration::setPoolIdleTimeout( unsigned int sec )
+  {
+    _data.poolIdleTimeout.tv_sec = sec;
+  }
+
+
+  void Configuration::addPoolEndpoint( std::string host, std::string port )
+  {
+    _data.poolEndpoints.push_back( std::make_pair( host, port ) );
+  }
+
 }
 
@@ -1,14 +1,51 @@
 
 #include "Connection.h"
 #include "Serializer.h"
+#include "FilterChain.h"
+#include "CompressionFilter.h"
+#include "ChecksumFilter.h"
 #include "CallbackInterface.h"
 #include "EventCallbacks.h"
+#include "WorkerThread.h"
+#include "Buffer.h"
+#include "ComputeExecutor.h"
+#include "Exception.h"
+#include "Payload.h"
+
+#include <algorithm>
 
 
 namespace Stewardess
 {
 
-  Connection::Connection( sockaddr address, ManagerImpl& manager, event_base* worker_base, evutil_socket_t new_socket ) :
+  FilterChain* Connection::_buildFilterChain( ManagerImpl& manager, CompressionFilter*& compression )
+  {
+    FilterVector filters;
+    manager._server.buildFilters( filters );
+
+    if ( manager._configuration.requestCompression )
+    {
+      compression = new CompressionFilter( manager._configuration.compressionLevel, manager._configuration.compressionThreshold, manager._configuration.bufferSize,
+                                           manager._configuration.maxFrameSize, convertFromTimeval( manager._configuration.compressionTimeout ) );
+      filters.push_back( compression );
+    }
+
+    // Outermost, so it covers exactly what goes over the wire
+    if ( manager._configuration.frameChecksum )
+    {
+      filters.push_back( new ChecksumFilter( manager._configuration.maxFrameSize, manager._configuration.bufferSize ) );
+    }
+
+    if ( filters.empty() )
+      return nullptr;
+    else
+      return new FilterChain( std::move( filters ) );
+  }
+
+
+  Connection::Connection( ConnectionID id, sockaddr address, ManagerImpl& manager, WorkerData* worker, evutil_socket_t new_socket,
+                          Serializer* new_serializer, FilterChain* new_filters, CompressionFilter* compression ) :
+    _id( id ),
     _references( 0 ),
     _identifier( 0 ),
     _close( false ),
@@ -16,17 +53,44 @@ namespace Stewardess
     _readEvent( nullptr ),
     _writeEvent( nullptr ),
     _destroyEvent( nullptr ),
+    _readTimeout( nullptr ),
+    _worker( worker ),
+    _migrating( false ),
+    _busyTime( 0 ),
+    _sampleBusyTime( 0 ),
+    _output(),
+    _current(),
+    _outputOffset( 0 ),
+    _writeScheduled( false ),
+    _inboxNext( nullptr ),
+    _pendingReads(),
+    _readsRunning( false ),
+    _coroutineReads( false ),
+    _readWaiter(),
+    _readSlot( nullptr ),
+    _writeSequence( 0 ),
+    _flushedSequence( 0 ),
+    _writeWaiter(),
+    _writeSlot( nullptr ),
+    _requests(),
+    _outstanding( 0 ),
+    _latency( 0 ),
+    _compression( compression ),
     _connectionTime( std::chrono::system_clock::now() ),
-    _lastAccess( _connectionTime ),
+    _lastAccess( CoarseClock::now() ),
+    _lastRead( _lastAccess.load() ),
+    _lastWrite( _lastRead ),
+    _writeBlocked( false ),
     socketAddress( &address ),
     manager( manager ),
-    serializer( manager._server.buildSerializer() ),
+    serializer( new_serializer ),
+    filters( new_filters ),
     bufferSize( 4096 )
   {
     GuardLock lk( _theMutex );
-    _readEvent = event_new( worker_base, new_socket, EV_READ|EV_PERSIST, readCB, this );
-    _writeEvent = event_new( worker_base, new_socket, EV_WRITE, writeCB, this );
-    _destroyEvent = event_new( worker_base, new_socket, EV_TIMEOUT, destroyCB, this );
+    _readEvent = event_new( worker->eventBase, new_socket, EV_READ|EV_PERSIST, readCB, this );
+    _writeEvent = event_new( worker->eventBase, new_socket, EV_WRITE, writeCB, this );
+    _destroyEvent = event_new( worker->eventBase, new_socket, EV_TIMEOUT, destroyCB, this );
     DEBUG_STREAM( "Stewardess::Connection" ) << "Created connection " << this->getConnectionID();
   }
 
@@ -41,6 +105,15 @@ namespace Stewardess
       event_free( _destroyEvent );
     if ( serializer != nullptr )
       delete serializer;
+    if ( filters != nullptr )
+      delete filters;
+
+    // Payloads that never reached onRead
+    while ( ! _pendingReads.empty() )
+    {
+      delete _pendingReads.front();
+      _pendingReads.pop();
+    }
 
     DEBUG_STREAM( "Stewardess::Connection" ) << "Deleted connection " << this->getConnectionID();
   }
@@ -67,6 +140,23 @@ namespace Stewardess
 
   void Connection::open( const timeval* timeout )
   {
+    // Anything the filters need to send goes out before the payloads
+    if ( filters != nullptr )
+    {
+      Buffer* opening = new Buffer( bufferSize );
+      filters->open( *opening );
+      if ( *opening )
+      {
+        _current = SharedBuffer( opening );
+        event_add( _writeEvent, nullptr );
+      }
+      else
+      {
+        delete opening;
+      }
+    }
+
+    _readTimeout = timeout;
     event_add( _readEvent, timeout );
   }
 
@@ -89,6 +179,13 @@ namespace Stewardess
       // Damn C libraries and their lack of namespaces....
       ::close( _socket );
 
+      // Waiting coroutines and requests are finished on the worker. The job's handle keeps the connection until then
+      if ( this->_hasWaiters() )
+      {
+        Handle handle( this );
+        postWorkerJob( _worker, [this, handle]() { this->_wakeWaiters(); } );
+      }
+
       // If no one else cares we suicide.
       if ( _references == 0 )
         event_add( _destroyEvent, &immediately );
@@ -102,11 +199,531 @@ namespace Stewardess
   }
 
 
-  void Connection::write( Payload* p )
+  bool Connection::migrate( WorkerData* target )
+  {
+    Handle handle = this->requestHandle();
+    WorkerData* source;
+    {
+      GuardLock lk( _theMutex );
+      source = _worker;
+      if ( ! handle || _close || _migrating || target == source )
+        return false;
+      _migrating = true;
+    }
+
+    // The old worker must finish with the connection before the new one starts
+    DEBUG_STREAM( "Stewardess::Connection" ) << "Migrating connection " << this->getConnectionID();
+    postWorkerJob( source, [this, source, target, handle]() { this->_detach( source, target, handle ); } );
+    return true;
+  }
+
+
+  void Connection::_detach( WorkerData* source, WorkerData* target, Handle handle )
+  {
+    {
+      GuardLock lk( _theMutex );
+      if ( _close )
+      {
+        _migrating = false;
+        return;
+      }
+
+      // Running on the old worker's loop, so none of the callbacks can be in progress
+      event_del( _readEvent );
+      event_del( _writeEvent );
+      event_del( _destroyEvent );
+
+      event_assign( _readEvent, target->eventBase, _socket, EV_READ|EV_PERSIST, readCB, this );
+      event_assign( _writeEvent, target->eventBase, _socket, EV_WRITE, writeCB, this );
+      event_assign( _destroyEvent, target->eventBase, _socket, EV_TIMEOUT, destroyCB, this );
+
+      // Only the old worker can take its timers out of its wheel. The new one arms them again
+      for ( ConnectionTimerMap::iterator it = _timers.begin(); it != _timers.end(); ++it )
+      {
+        if ( it->second->armed )
+        {
+          source->timers->cancel( &it->second->timer );
+          it->second->armed = false;
+        }
+      }
+
+      _worker = target;
+      source->connections.fetch_sub( 1, std::memory_order_relaxed );
+      target->connections.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    // Move to the new worker's shard. The handle stops it being destroyed in between
+    {
+      GuardLock lk( source->connectionTableMutex );
+      source->connectionTable.erase( this->getConnectionID() );
+    }
+    {
+      GuardLock lk( target->connectionTableMutex );
+      target->connectionTable.insert( this->getConnectionID(), this );
+    }
+
+    // Unread data waits in the socket until the new worker picks it up
+    postWorkerJob( target, [this, handle]() { this->_attach( handle ); } );
+  }
+
+
+  void Connection::_attach( Handle )
+  {
+    GuardLock lk( _theMutex );
+    _migrating = false;
+    if ( _close ) return;
+
+    event_add( _readEvent, _readTimeout );
+    if ( _current || ! _output.empty() )
+    {
+      event_add( _writeEvent, nullptr );
+    }
+
+    for ( ConnectionTimerMap::iterator it = _timers.begin(); it != _timers.end(); )
+    {
+      ConnectionTimerMap::iterator current = it++;
+      this->_syncTimer( current );
+    }
+    DEBUG_STREAM( "Stewardess::Connection" ) << "Migrated connection " << this->getConnectionID();
+  }
+
+
+  uint64_t Connection::write( Payload* p )
+  {
+    uint64_t sequence;
+    {
+      GuardLock lk( _theMutex );
+      serializer->serialize( p );
+      while ( ! serializer->bufferEmpty() )
+      {
+        _output.push_back( SharedBuffer( serializer->getBuffer() ) );
+      }
+      sequence = ++_writeSequence;
+    }
+    this->_scheduleWrite();
+    return sequence;
+  }
+
+
+  void Connection::writeRaw( Buffer&& buffer )
+  {
+    {
+      GuardLock lk( _theMutex );
+      _output.push_back( std::make_shared< Buffer >( std::move( buffer ) ) );
+    }
+    this->_scheduleWrite();
+  }
+
+
+  void Connection::writeRaw( BufferVector&& buffers )
+  {
+    {
+      GuardLock lk( _theMutex );
+      for ( BufferVector::iterator it = buffers.begin(); it != buffers.end(); ++it )
+      {
+        _output.push_back( std::make_shared< Buffer >( std::move( *it ) ) );
+      }
+    }
+    buffers.clear();
+    this->_scheduleWrite();
+  }
+
+
+  void Connection::writeShared( const SharedBuffer& buffer )
+  {
+    {
+      GuardLock lk( _theMutex );
+      _output.push_back( buffer );
+    }
+    this->_scheduleWrite();
+  }
+
+
+  void Connection::_scheduleWrite()
+  {
+    WorkerData* worker = _worker;
+
+    // On the worker's own thread the event can be added without contention
+    if ( getCurrentWorker() == worker )
+    {
+      event_add( _writeEvent, nullptr );
+      return;
+    }
+
+    // Already waiting in an inbox, it will pick up this data too
+    if ( _writeScheduled.exchange( true ) ) return;
+
+    // The inbox holds a reference until the worker has drained it
+    this->incrementReferences();
+
+    Connection* head = worker->inbox.load( std::memory_order_relaxed );
+    do
+    {
+      _inboxNext = head;
+    }
+    while ( ! worker->inbox.compare_exchange_weak( head, this, std::memory_order_release, std::memory_order_relaxed ) );
+
+    // Only the first connection into an empty inbox needs to wake the worker
+    if ( head == nullptr )
+    {
+      signalWorkerInbox( worker );
+    }
+  }
+
+
+  void Connection::_queueReads( std::queue< Payload* >&& payloads, const Handle& handle )
+  {
+    {
+      GuardLock lk( _pendingReadsMutex );
+      while ( ! payloads.empty() )
+      {
+        _pendingReads.push( payloads.front() );
+        payloads.pop();
+      }
+
+      // A job is already going, it will find these
+      if ( _readsRunning ) return;
+      _readsRunning = true;
+    }
+
+    manager._executor->submit( [this, handle]() { this->_runReads( handle ); } );
+  }
+
+
+  void Connection::_runReads( Handle handle )
+  {
+    // Limit the batch so one busy connection doesn't hold a pool thread forever
+    static const unsigned BatchSize = 16;
+
+    for ( unsigned i = 0; i < BatchSize; ++i )
+    {
+      Payload* payload;
+      {
+        GuardLock lk( _pendingReadsMutex );
+        if ( _pendingReads.empty() )
+        {
+          _readsRunning = false;
+          return;
+        }
+        payload = _pendingReads.front();
+        _pendingReads.pop();
+      }
+
+      manager._server.onRead( handle, payload );
+    }
+
+    // Back of the queue so other connections get a turn
+    manager._executor->submit( [this, handle]() { this->_runReads( handle ); } );
+  }
+
+
+  bool Connection::takeRead( Payload*& payload )
+  {
+    if ( ! _coroutineReads )
+    {
+      throw Exception( "Read awaited on a connection whose payloads go to onRead. Call readInCoroutine() first." );
+    }
+
+    GuardLock lk( _pendingReadsMutex );
+    if ( ! _pendingReads.empty() )
+    {
+      payload = _pendingReads.front();
+      _pendingReads.pop();
+      return true;
+    }
+
+    payload = nullptr;
+    return _close;
+  }
+
+
+  bool Connection::awaitRead( std::coroutine_handle<> coroutine, Payload*& payload )
+  {
+    GuardLock lk( _pendingReadsMutex );
+    if ( ! _pendingReads.empty() )
+    {
+      payload = _pendingReads.front();
+      _pendingReads.pop();
+      return false;
+    }
+
+    // Closed while we were getting here. Close checks for waiters after setting the flag
+    if ( _close ) return false;
+
+    _readWaiter = coroutine;
+    _readSlot = &payload;
+    return true;
+  }
+
+
+  void Connection::_deliverRead( Payload* payload )
+  {
+    std::coroutine_handle<> waiter;
+    {
+      GuardLock lk( _pendingReadsMutex );
+      if ( _readWaiter )
+      {
+        *_readSlot = payload;
+        waiter = std::exchange( _readWaiter, nullptr );
+      }
+      else
+      {
+        _pendingReads.push( payload );
+      }
+    }
+
+    if ( waiter ) waiter.resume();
+  }
+
+
+  void Connection::beginRequest( ResponseCallback callback )
+  {
+    GuardLock lk( _requestsMutex );
+    _requests.push_back( { std::chrono::steady_clock::now(), std::move( callback ) } );
+    _outstanding.fetch_add( 1, std::memory_order_relaxed );
+  }
+
+
+  bool Connection::_responded( Payload* payload )
+  {
+    // Most connections are never balanced
+    if ( _outstanding.load( std::memory_order_relaxed ) == 0 ) return false;
+
+    OutstandingRequest request;
+    {
+      GuardLock lk( _requestsMutex );
+      if ( _requests.empty() ) return false;
+      request = std::move( _requests.front() );
+      _requests.pop_front();
+      _outstanding.fetch_sub( 1, std::memory_order_relaxed );
+    }
+
+    // Moving average weighted 1/8 to the newest sample, the same as TCP's smoothed RTT
+    uint64_t sample = std::chrono::duration_cast< Microseconds >( std::chrono::steady_clock::now() - request.sent ).count();
+    uint64_t latency = _latency.load( std::memory_order_relaxed );
+    if ( latency == 0 )
+      latency = sample;
+    else
+      latency = latency - latency / 8 + sample / 8;
+    _latency.store( std::max( latency, (uint64_t)1 ), std::memory_order_relaxed );
+
+    if ( ! request.callback ) return false;
+
+    request.callback( Handle( this ), payload );
+    return true;
+  }
+
+
+  void Connection::_failRequests()
+  {
+    std::deque< OutstandingRequest > requests;
+    {
+      GuardLock lk( _requestsMutex );
+      requests.swap( _requests );
+      _outstanding.store( 0, std::memory_order_relaxed );
+    }
+
+    Handle handle( this );
+    for ( std::deque< OutstandingRequest >::iterator it = requests.begin(); it != requests.end(); ++it )
+    {
+      if ( it->callback ) it->callback( handle, nullptr );
+    }
+  }
+
+
+  bool Connection::awaitFlush( std::coroutine_handle<> coroutine, uint64_t sequence, bool& flushed )
   {
     GuardLock lk( _theMutex );
-    serializer->serialize( p );
-    event_add( _writeEvent, nullptr );
+    if ( this->isFlushed( sequence ) )
+    {
+      flushed = true;
+      return false;
+    }
+    if ( _close )
+    {
+      flushed = false;
+      return false;
+    }
+
+    _writeWaiter = coroutine;
+    _writeSlot = &flushed;
+    return true;
+  }
+
+
+  void Connection::_flushed()
+  {
+    std::coroutine_handle<> waiter;
+    {
+      GuardLock lk( _theMutex );
+      if ( ! _output.empty() ) return;
+
+      // Everything written so far has gone
+      _flushedSequence = _writeSequence;
+      if ( _writeWaiter )
+      {
+        *_writeSlot = true;
+        waiter = std::exchange( _writeWaiter, nullptr );
+      }
+    }
+
+    if ( waiter ) waiter.resume();
+  }
+
+
+  bool Connection::_hasWaiters()
+  {
+    if ( _outstanding.load( std::memory_order_relaxed ) > 0 ) return true;
+    {
+      GuardLock lk( _pendingReadsMutex );
+      if ( _readWaiter ) return true;
+    }
+    GuardLock lk( _theMutex );
+    return (bool)_writeWaiter || ! _timers.empty();
+  }
+
+
+  void Connection::_wakeWaiters()
+  {
+    std::coroutine_handle<> reader;
+    {
+      GuardLock lk( _pendingReadsMutex );
+      if ( _readWaiter )
+      {
+        *_readSlot = nullptr;
+        reader = std::exchange( _readWaiter, nullptr );
+      }
+    }
+
+    std::coroutine_handle<> writer;
+    {
+      GuardLock lk( _theMutex );
+      if ( _writeWaiter )
+      {
+        *_writeSlot = false;
+        writer = std::exchange( _writeWaiter, nullptr );
+      }
+    }
+
+    if ( reader ) reader.resume();
+    if ( writer ) writer.resume();
+
+    this->_failRequests();
+    this->_cancelTimers();
+  }
+
+
+  bool Connection::startTimer( UniqueID id, Milliseconds delay, bool repeat )
+  {
+    Handle handle;
+    WorkerData* worker;
+    {
+      GuardLock lk( _theMutex );
+      if ( _close ) return false;
+
+      std::unique_ptr< ConnectionTimer >& timer = _timers[ id ];
+      if ( ! timer )
+      {
+        timer.reset( new ConnectionTimer() );
+        timer->connection = this;
+        timer->identifier = id;
+        timer->timer.setCallback( connectionTimerCB, (void*)timer.get() );
+        timer->armed = false;
+      }
+      timer->time = delay;
+      timer->repeat = repeat;
+      timer->due = std::chrono::steady_clock::now() + delay;
+      timer->active = true;
+
+      // Only the worker touches its wheel. Other threads hand the timer over
+      worker = _worker;
+      if ( getCurrentWorker() == worker )
+      {
+        this->_syncTimer( _timers.find( id ) );
+        return true;
+      }
+      handle = Handle( this );
+    }
+
+    postWorkerJob( worker, [this, handle, id]() { this->_syncTimerJob( id ); } );
+    return true;
+  }
+
+
+  void Connection::stopTimer( UniqueID id )
+  {
+    Handle handle;
+    WorkerData* worker;
+    {
+      GuardLock lk( _theMutex );
+      ConnectionTimerMap::iterator found = _timers.find( id );
+      if ( found == _timers.end() ) return;
+      found->second->active = false;
+
+      worker = _worker;
+      if ( getCurrentWorker() == worker )
+      {
+        this->_syncTimer( found );
+        return;
+      }
+      handle = Handle( this );
+    }
+
+    postWorkerJob( worker, [this, handle, id]() { this->_syncTimerJob( id ); } );
+  }
+
+
+  void Connection::_syncTimer( ConnectionTimerMap::iterator found )
+  {
+    ConnectionTimer* timer = found->second.get();
+    WorkerData* worker = _worker;
+
+    if ( timer->armed )
+    {
+      worker->timers->cancel( &timer->timer );
+      timer->armed = false;
+    }
+
+    if ( ! timer->active || _close )
+    {
+      _timers.erase( found );
+      return;
+    }
+
+    // The new worker arms it once the connection arrives
+    if ( _migrating ) return;
+
+    std::chrono::steady_clock::duration remaining = std::max( timer->due - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero() );
+    worker->timers->arm( &timer->timer, std::chrono::ceil< Milliseconds >( remaining ) );
+    timer->armed = true;
+  }
+
+
+  void Connection::_syncTimerJob( UniqueID id )
+  {
+    GuardLock lk( _theMutex );
+    ConnectionTimerMap::iterator found = _timers.find( id );
+    if ( found == _timers.end() ) return;
+
+    // Moved on since the job was posted. The connection's new worker arms everything when it arrives
+    if ( getCurrentWorker() != _worker ) return;
+
+    this->_syncTimer( found );
+  }
+
+
+  void Connection::_cancelTimers()
+  {
+    GuardLock lk( _theMutex );
+    WorkerData* worker = _worker;
+    for ( ConnectionTimerMap::iterator it = _timers.begin(); it != _timers.end(); ++it )
+    {
+      if ( it->second->armed )
+      {
+        worker->timers->cancel( &it->second->timer );
+      }
+    }
+    _timers.clear();
   }
 
 
@@ -138,17 +755,74 @@ namespace Stewardess
   }
 
 
-  void Connection::touchAccess()
+  const char* Connection::checkTimeout( SteadyTime now )
   {
-    GuardLock lk( _lastAccessMutex );
-    _lastAccess = std::chrono::system_clock::now();
+    const timeval* read_timeout = manager.getReadTimeout();
+    if ( read_timeout != nullptr )
+    {
+      Microseconds timeout = convertFromTimeval( *read_timeout );
+      bool outstanding = _outstanding.load( std::memory_order_relaxed ) > 0;
+
+      if ( now - _lastRead > timeout )
+        return outstanding ? "Timed out waiting for a response" : "Timed out waiting to read";
+
+      // A request must be answered in time even while other data keeps arriving.
+      //  Request stamps are precise, so they are compared against the precise clock
+      if ( outstanding )
+      {
+        GuardLock lk( _requestsMutex );
+        if ( ! _requests.empty() && std::chrono::steady_clock::now() - _requests.front().sent > timeout )
+          return "Timed out waiting for a response";
+      }
+    }
+
+    const timeval* write_timeout = manager.getWriteTimeout();
+    if ( write_timeout != nullptr && _writeBlocked && now - _lastWrite > convertFromTimeval( *write_timeout ) )
+    {
+      return "Timed out waiting to write";
+    }
+
+    const timeval* idle_timeout = manager.getIdleTimeout();
+    if ( idle_timeout != nullptr && now - this->getAccess() > convertFromTimeval( *idle_timeout ) )
+    {
+      return "Idle for too long";
+    }
+
+    return nullptr;
+  }
+
+
+  const char* Connection::expireFilters( SteadyTime now )
+  {
+    if ( filters == nullptr || filters->ready() ) return nullptr;
+
+    if ( ! filters->expire( now ) )
+    {
+      // Only the first is reported, the rest are just logged
+      const char* reason = filters->errorEmpty() ? "Filter failed while waiting" : filters->getError();
+      ERROR_STREAM( "Stewardess::Timeout" ) << "Filter error occured: " << reason;
+      while ( ! filters->errorEmpty() )
+      {
+        ERROR_STREAM( "Stewardess::Timeout" ) << "Filter error occured: " << filters->getError();
+      }
+      return reason;
+    }
+
+    // Release anything the filters were holding back
+    if ( filters->ready() )
+    {
+      event_add( _writeEvent, nullptr );
+    }
+    return nullptr;
   }
 
 
-  TimeStamp Connection::getAccess() const
+  CompressionStatistics Connection::getCompressionStatistics() const
   {
-    GuardLock lk( _lastAccessMutex );
-    return _lastAccess;
+    if ( _compression == nullptr )
+      return CompressionStatistics();
+    else
+      return _compression->getStatistics();
   }
 
 }
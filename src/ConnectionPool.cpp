@@ -0,0 +1,302 @@
+
+#include "ConnectionPool.h"
+#include "ManagerImpl.h"
+
+#include <algorithm>
+
+
+namespace Stewardess
+{
+
+  // Longest wait between attempts to top up a failing endpoint
+  static const std::chrono::seconds MaxRetryDelay( 60 );
+
+
+  ConnectionPool::ConnectionPool( ManagerImpl& manager, const ConfigurationData& configuration ) :
+    _manager( manager ),
+    _minimum( configuration.poolMinConnections ),
+    _maximum( configuration.poolMaxConnections ),
+    _idleTimeout( configuration.poolIdleTimeout.tv_sec ),
+    _endpoints(),
+    _leases()
+  {
+  }
+
+
+  ConnectionPool::~ConnectionPool()
+  {
+    this->clear();
+  }
+
+
+  ConnectionPool::Endpoint& ConnectionPool::_endpoint( const std::string& host, const std::string& port )
+  {
+    std::string key = host + ":" + port;
+    EndpointMap::iterator found = _endpoints.find( key );
+    if ( found != _endpoints.end() )
+    {
+      return found->second;
+    }
+
+    Endpoint& endpoint = _endpoints[ key ];
+    endpoint.host = host;
+    endpoint.port = port;
+    return endpoint;
+  }
+
+
+  void ConnectionPool::_connect( const std::string& key, Endpoint& endpoint )
+  {
+    endpoint.connecting += 1;
+
+    // The result always arrives later, from the connect pipeline, so the lock is never taken twice
+    _manager.requestConnectTo( endpoint.host, endpoint.port, 0, [this, key]( Handle handle ) { this->_connected( key, std::move( handle ) ); } );
+  }
+
+
+  void ConnectionPool::_connected( const std::string& key, Handle handle )
+  {
+    ConnectCallback callback;
+    {
+      GuardLock lk( _mutex );
+      EndpointMap::iterator found = _endpoints.find( key );
+      if ( found == _endpoints.end() ) return;
+      Endpoint& endpoint = found->second;
+      endpoint.connecting -= 1;
+
+      if ( ! handle )
+      {
+        // Back off exponentially before the maintenance pass tries again
+        endpoint.failed += 1;
+        endpoint.consecutiveFailures += 1;
+        endpoint.retryTime = std::chrono::steady_clock::now() + std::min( MaxRetryDelay, std::chrono::seconds( 1L << std::min( endpoint.consecutiveFailures, (size_t)6 ) ) );
+
+        // Fail one waiting lease per failed attempt, so a dead endpoint can't queue forever
+        if ( endpoint.waiting.empty() ) return;
+        callback = std::move( endpoint.waiting.front() );
+        endpoint.waiting.pop();
+      }
+      else
+      {
+        endpoint.created += 1;
+        endpoint.consecutiveFailures = 0;
+        if ( endpoint.waiting.empty() )
+        {
+          endpoint.idle.push_back( { std::move( handle ), std::chrono::steady_clock::now() } );
+          return;
+        }
+        callback = std::move( endpoint.waiting.front() );
+        endpoint.waiting.pop();
+        endpoint.leased += 1;
+        _leases[ handle.getConnectionID() ] = key;
+      }
+    }
+
+    callback( std::move( handle ) );
+  }
+
+
+  void ConnectionPool::lease( const std::string& host, const std::string& port, ConnectCallback callback )
+  {
+    Handle handle;
+    {
+      GuardLock lk( _mutex );
+      Endpoint& endpoint = this->_endpoint( host, port );
+      endpoint.leases += 1;
+
+      // Most recently used first, it is the least likely to have been closed by the peer
+      while ( ! endpoint.idle.empty() && ! handle )
+      {
+        if ( endpoint.idle.back().handle.isOpen() )
+        {
+          handle = std::move( endpoint.idle.back().handle );
+        }
+        endpoint.idle.pop_back();
+      }
+
+      if ( ! handle )
+      {
+        endpoint.waiting.push( std::move( callback ) );
+        if ( endpoint.total() < _maximum )
+        {
+          this->_connect( host + ":" + port, endpoint );
+        }
+        return;
+      }
+
+      endpoint.reused += 1;
+      endpoint.leased += 1;
+      _leases[ handle.getConnectionID() ] = host + ":" + port;
+    }
+
+    callback( std::move( handle ) );
+  }
+
+
+  bool ConnectionPool::release( const Handle& handle )
+  {
+    ConnectCallback callback;
+    {
+      GuardLock lk( _mutex );
+      LeaseMap::iterator lease = _leases.find( handle.getConnectionID() );
+      if ( lease == _leases.end() ) return false;
+
+      std::string key = lease->second;
+      _leases.erase( lease );
+      Endpoint& endpoint = _endpoints[ key ];
+      endpoint.leased -= 1;
+
+      if ( ! handle.isOpen() )
+      {
+        // Replace it if there are leases waiting for a connection
+        if ( endpoint.waiting.size() > endpoint.connecting && endpoint.total() < _maximum )
+        {
+          this->_connect( key, endpoint );
+        }
+        return true;
+      }
+
+      if ( endpoint.waiting.empty() )
+      {
+        endpoint.idle.push_back( { handle, std::chrono::steady_clock::now() } );
+        return true;
+      }
+
+      callback = std::move( endpoint.waiting.front() );
+      endpoint.waiting.pop();
+      endpoint.leased += 1;
+      endpoint.reused += 1;
+      _leases[ handle.getConnectionID() ] = key;
+    }
+
+    callback( handle );
+    return true;
+  }
+
+
+  void ConnectionPool::preconnect( const std::string& host, const std::string& port )
+  {
+    GuardLock lk( _mutex );
+    Endpoint& endpoint = this->_endpoint( host, port );
+    while ( endpoint.total() < _minimum )
+    {
+      this->_connect( host + ":" + port, endpoint );
+    }
+  }
+
+
+  void ConnectionPool::maintain()
+  {
+    // Leases whose connection has closed are never released, so find them without the lock held
+    std::vector< ConnectionID > leased;
+    {
+      GuardLock lk( _mutex );
+      leased.reserve( _leases.size() );
+      for ( LeaseMap::iterator it = _leases.begin(); it != _leases.end(); ++it )
+        leased.push_back( it->first );
+    }
+
+    std::vector< ConnectionID > closed;
+    for ( std::vector< ConnectionID >::iterator it = leased.begin(); it != leased.end(); ++it )
+    {
+      if ( ! _manager.findConnection( *it ) )
+        closed.push_back( *it );
+    }
+
+    HandleVector expired;
+    {
+      GuardLock lk( _mutex );
+
+      // Stop counting them against their endpoint, unless they were released in the meantime
+      for ( std::vector< ConnectionID >::iterator it = closed.begin(); it != closed.end(); ++it )
+      {
+        LeaseMap::iterator lease = _leases.find( *it );
+        if ( lease == _leases.end() ) continue;
+
+        std::string key = lease->second;
+        _leases.erase( lease );
+        Endpoint& endpoint = _endpoints[ key ];
+        endpoint.leased -= 1;
+
+        // Same as releasing a closed connection
+        if ( endpoint.waiting.size() > endpoint.connecting && endpoint.total() < _maximum )
+        {
+          this->_connect( key, endpoint );
+        }
+      }
+
+      SteadyTime now = std::chrono::steady_clock::now();
+      SteadyTime oldest = now - _idleTimeout;
+
+      for ( EndpointMap::iterator it = _endpoints.begin(); it != _endpoints.end(); ++it )
+      {
+        Endpoint& endpoint = it->second;
+
+        // Forget the ones the peer has closed
+        for ( std::deque< IdleConnection >::iterator idle = endpoint.idle.begin(); idle != endpoint.idle.end(); )
+        {
+          if ( idle->handle.isOpen() )
+            ++idle;
+          else
+            idle = endpoint.idle.erase( idle );
+        }
+
+        // Oldest are at the front
+        while ( ! endpoint.idle.empty() && endpoint.total() > _minimum && endpoint.idle.front().since < oldest )
+        {
+          expired.push_back( std::move( endpoint.idle.front().handle ) );
+          endpoint.idle.pop_front();
+          endpoint.reaped += 1;
+        }
+
+        if ( endpoint.consecutiveFailures > 0 && now < endpoint.retryTime ) continue;
+
+        while ( endpoint.total() < _minimum )
+        {
+          this->_connect( it->first, endpoint );
+        }
+      }
+    }
+
+    for ( HandleVector::iterator it = expired.begin(); it != expired.end(); ++it )
+    {
+      it->close();
+    }
+  }
+
+
+  void ConnectionPool::clear()
+  {
+    GuardLock lk( _mutex );
+    _endpoints.clear();
+    _leases.clear();
+  }
+
+
+  PoolStatisticsVector ConnectionPool::getStatistics() const
+  {
+    PoolStatisticsVector statistics;
+
+    GuardLock lk( _mutex );
+    for ( EndpointMap::const_iterator it = _endpoints.begin(); it != _endpoints.end(); ++it )
+    {
+      const Endpoint& endpoint = it->second;
+      PoolStatistics stats;
+      stats.endpoint = it->first;
+      stats.idle = endpoint.idle.size();
+      stats.leased = endpoint.leased;
+      stats.connecting = endpoint.connecting;
+      stats.waiting = endpoint.waiting.size();
+      stats.consecutiveFailures = endpoint.consecutiveFailures;
+      stats.leases = endpoint.leases;
+      stats.reused = endpoint.reused;
+      stats.created = endpoint.created;
+      stats.failed = endpoint.failed;
+      stats.reaped = endpoint.reaped;
+      statistics.push_back( stats );
+    }
+    return statistics;
+  }
+
+}
+
@@ -0,0 +1,214 @@
+
+#include "ConnectionSlab.h"
+#include "Connection.h"
+#include "Exception.h"
+
+#include <new>
+
+
+namespace Stewardess
+{
+
+  // IDs are [ slab index : 15 | slot : 24 | generation : 24 ], so they are always positive
+  static const unsigned GenerationBits = 24;
+  static const unsigned SlotBits = 24;
+  static const unsigned IndexBits = 15;
+
+  static const uint64_t GenerationMask = ( 1ull << GenerationBits ) - 1;
+  static const uint64_t SlotMask = ( 1ull << SlotBits ) - 1;
+
+  // Slots are added this many at a time
+  static const size_t ChunkSize = 256;
+
+  // Marks the end of the free list
+  static const size_t NoSlot = ~(size_t)0;
+
+
+  struct ConnectionSlab::Slot
+  {
+    alignas( Connection ) unsigned char storage[ sizeof( Connection ) ];
+
+    // Odd while a connection lives here
+    uint32_t generation = 0;
+
+    // Next free slot while it is on the free list
+    size_t nextFree = NoSlot;
+
+    Connection* connection() { return std::launder( (Connection*)storage ); }
+  };
+
+
+  ConnectionSlab::ConnectionSlab( size_t index ) :
+    _index( index ),
+    _chunks(),
+    _free( NoSlot ),
+    _size( 0 )
+  {
+    if ( index > maxIndex() )
+    {
+      throw Exception( "Too many connection slabs for the ID format." );
+    }
+  }
+
+
+  ConnectionSlab::~ConnectionSlab()
+  {
+    this->clear();
+
+    for ( std::vector< Slot* >::iterator it = _chunks.begin(); it != _chunks.end(); ++it )
+    {
+      delete[] (*it);
+    }
+  }
+
+
+  ConnectionSlab::Slot* ConnectionSlab::_slot( size_t number ) const
+  {
+    if ( number / ChunkSize >= _chunks.size() )
+      return nullptr;
+
+    return &_chunks[ number / ChunkSize ][ number % ChunkSize ];
+  }
+
+
+  Connection* ConnectionSlab::_find( ConnectionID id ) const
+  {
+    if ( slabIndex( id ) != _index )
+      return nullptr;
+
+    Slot* slot = this->_slot( ( (uint64_t)id >> GenerationBits ) & SlotMask );
+    if ( slot == nullptr )
+      return nullptr;
+
+    // Only the generation it was created with matches, so stale IDs are never confused with a reused slot
+    if ( ( slot->generation & 1 ) == 0 || ( slot->generation & GenerationMask ) != ( (uint64_t)id & GenerationMask ) )
+      return nullptr;
+
+    return slot->connection();
+  }
+
+
+  void ConnectionSlab::_grow()
+  {
+    size_t first = _chunks.size() * ChunkSize;
+    if ( first + ChunkSize > SlotMask + 1 )
+    {
+      throw Exception( "Connection slab is full." );
+    }
+
+    Slot* chunk = new Slot[ ChunkSize ];
+    _chunks.push_back( chunk );
+
+    // Lowest numbers first, so the live slots stay packed together
+    for ( size_t i = ChunkSize; i > 0; --i )
+    {
+      chunk[ i - 1 ].nextFree = _free;
+      _free = first + i - 1;
+    }
+  }
+
+
+  Connection* ConnectionSlab::create( const sockaddr& address, ManagerImpl& manager, WorkerData* worker, evutil_socket_t socket,
+                                     Serializer* serializer, FilterChain* filters, CompressionFilter* compression )
+  {
+    // Built with the lock held, so no one can find it half made
+    GuardLock lk( _mutex );
+    if ( _free == NoSlot )
+    {
+      this->_grow();
+    }
+
+    size_t number = _free;
+    Slot* slot = this->_slot( number );
+
+    // Odd generations mean the ID is never zero
+    uint32_t generation = slot->generation + 1;
+
+    ConnectionID id = (ConnectionID)( ( (uint64_t)_index << ( SlotBits + GenerationBits ) ) | ( (uint64_t)number << GenerationBits ) | ( generation & GenerationMask ) );
+
+    // Nothing about the slot changes until the connection is built. If it throws the slot is still free
+    Connection* connection = new ( slot->storage ) Connection( id, address, manager, worker, socket, serializer, filters, compression );
+
+    slot->generation = generation;
+    _free = slot->nextFree;
+    slot->nextFree = NoSlot;
+    _size += 1;
+    return connection;
+  }
+
+
+  Handle ConnectionSlab::acquire( ConnectionID id )
+  {
+    GuardLock lk( _mutex );
+    Connection* connection = this->_find( id );
+    if ( connection == nullptr || ! connection->isOpen() )
+      return Handle();
+
+    return connection->requestHandle();
+  }
+
+
+  bool ConnectionSlab::retire( Connection* connection )
+  {
+    GuardLock lk( _mutex );
+    if ( connection->getNumberHandles() > 0 )
+      return false;
+
+    Slot* slot = this->_slot( ( (uint64_t)connection->getConnectionID() >> GenerationBits ) & SlotMask );
+    slot->generation += 1;
+    _size -= 1;
+    return true;
+  }
+
+
+  void ConnectionSlab::release( Connection* connection )
+  {
+    size_t number = ( (uint64_t)connection->getConnectionID() >> GenerationBits ) & SlotMask;
+
+    // Retired, so nothing else can reach it
+    connection->~Connection();
+
+    GuardLock lk( _mutex );
+    Slot* slot = this->_slot( number );
+    slot->nextFree = _free;
+    _free = number;
+  }
+
+
+  void ConnectionSlab::clear()
+  {
+    GuardLock lk( _mutex );
+    for ( size_t number = 0; number < _chunks.size() * ChunkSize; ++number )
+    {
+      Slot* slot = this->_slot( number );
+      if ( ( slot->generation & 1 ) == 0 ) continue;
+
+      slot->connection()->~Connection();
+      slot->generation += 1;
+      slot->nextFree = _free;
+      _free = number;
+    }
+    _size = 0;
+  }
+
+
+  size_t ConnectionSlab::size() const
+  {
+    GuardLock lk( _mutex );
+    return _size;
+  }
+
+
+  size_t ConnectionSlab::slabIndex( ConnectionID id )
+  {
+    return (uint64_t)id >> ( SlotBits + GenerationBits );
+  }
+
+
+  size_t ConnectionSlab::maxIndex()
+  {
+    return ( 1ull << IndexBits ) - 1;
+  }
+
+}
+
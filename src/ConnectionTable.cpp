@@ -0,0 +1,136 @@
+
+#include "ConnectionTable.h"
+
+
+namespace Stewardess
+{
+
+  ConnectionTable::ConnectionTable( size_t capacity ) :
+    _entries( nullptr ),
+    _capacity( 16 ),
+    _size( 0 )
+  {
+    // Keep the capacity a power of two so the hash can be masked
+    while ( _capacity < capacity )
+      _capacity *= 2;
+
+    _entries = new Entry[ _capacity ]();
+  }
+
+
+  ConnectionTable::~ConnectionTable()
+  {
+    delete[] _entries;
+  }
+
+
+  size_t ConnectionTable::_home( ConnectionID key ) const
+  {
+    // Fibonacci hashing. Connection IDs keep the slot in the middle bits, so mix them all down
+    uint64_t hash = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    return ( hash >> 32 ) & ( _capacity - 1 );
+  }
+
+
+  void ConnectionTable::_grow()
+  {
+    Entry* old_entries = _entries;
+    size_t old_capacity = _capacity;
+
+    _capacity *= 2;
+    _entries = new Entry[ _capacity ]();
+    _size = 0;
+
+    for ( size_t i = 0; i < old_capacity; ++i )
+    {
+      if ( old_entries[i].key != 0 )
+        this->insert( old_entries[i].key, old_entries[i].value );
+    }
+
+    delete[] old_entries;
+  }
+
+
+  void ConnectionTable::insert( ConnectionID key, Connection* value )
+  {
+    // Keep at most half full so the probe chains stay short
+    if ( ( _size + 1 ) * 2 > _capacity )
+      this->_grow();
+
+    size_t mask = _capacity - 1;
+    for ( size_t i = this->_home( key ); ; i = ( i + 1 ) & mask )
+    {
+      if ( _entries[i].key == key )
+      {
+        _entries[i].value = value;
+        return;
+      }
+      if ( _entries[i].key == 0 )
+      {
+        _entries[i].key = key;
+        _entries[i].value = value;
+        ++_size;
+        return;
+      }
+    }
+  }
+
+
+  bool ConnectionTable::erase( ConnectionID key )
+  {
+    size_t mask = _capacity - 1;
+    size_t i = this->_home( key );
+
+    while ( _entries[i].key != key )
+    {
+      if ( _entries[i].key == 0 )
+        return false;
+      i = ( i + 1 ) & mask;
+    }
+
+    // Shift later entries in the chain back into the gap
+    size_t gap = i;
+    for ( size_t j = ( i + 1 ) & mask; _entries[j].key != 0; j = ( j + 1 ) & mask )
+    {
+      size_t home = this->_home( _entries[j].key );
+
+      // Only move an entry if its home is not between the gap and its current position
+      bool movable = ( gap <= j ) ? ( home <= gap || home > j ) : ( home <= gap && home > j );
+      if ( movable )
+      {
+        _entries[gap] = _entries[j];
+        gap = j;
+      }
+    }
+
+    _entries[gap].key = 0;
+    _entries[gap].value = nullptr;
+    --_size;
+    return true;
+  }
+
+
+  Connection* ConnectionTable::find( ConnectionID key ) const
+  {
+    size_t mask = _capacity - 1;
+    for ( size_t i = this->_home( key ); _entries[i].key != 0; i = ( i + 1 ) & mask )
+    {
+      if ( _entries[i].key == key )
+        return _entries[i].value;
+    }
+    return nullptr;
+  }
+
+
+  void ConnectionTable::clear()
+  {
+    for ( size_t i = 0; i < _capacity; ++i )
+    {
+      _entries[i].key = 0;
+      _entries[i].value = nullptr;
+    }
+    _size = 0;
+  }
+
+}
+
@@ -0,0 +1,127 @@
+
+#include "Coroutine.h"
+#include "Connection.h"
+#include "ManagerImpl.h"
+#include "WorkerThread.h"
+#include "Payload.h"
+#include "TimerWheel.h"
+
+#include <exception>
+
+
+namespace Stewardess
+{
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Task
+
+  void Task::promise_type::unhandled_exception()
+  {
+    // Nobody is waiting on a task to pass the exception to
+    try
+    {
+      throw;
+    }
+    catch ( std::exception& ex )
+    {
+      ERROR_STREAM( "Stewardess::Coroutine" ) << "Unhandled exception in a coroutine: " << ex.what();
+    }
+    catch ( ... )
+    {
+      ERROR_LOG( "Stewardess::Coroutine", "Unhandled exception of unknown type in a coroutine" );
+    }
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Connection awaitables
+
+  bool ReadAwaitable::await_ready()
+  {
+    return _connection->takeRead( _payload );
+  }
+
+
+  bool ReadAwaitable::await_suspend( std::coroutine_handle<> coroutine )
+  {
+    return _connection->awaitRead( coroutine, _payload );
+  }
+
+
+  bool WriteAwaitable::await_ready()
+  {
+    _flushed = _connection->isFlushed( _sequence );
+    return _flushed;
+  }
+
+
+  bool WriteAwaitable::await_suspend( std::coroutine_handle<> coroutine )
+  {
+    return _connection->awaitFlush( coroutine, _sequence, _flushed );
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Manager awaitables
+
+  SleepAwaitable::SleepAwaitable( ManagerImpl* manager, Milliseconds time ) :
+    _manager( manager ),
+    _time( time ),
+    _worker( nullptr ),
+    _coroutine(),
+    _timer()
+  {
+  }
+
+
+  SleepAwaitable::SleepAwaitable( SleepAwaitable&& ) = default;
+
+
+  SleepAwaitable::~SleepAwaitable() = default;
+
+
+  void SleepAwaitable::_wake( void* arg )
+  {
+    SleepAwaitable* sleeper = (SleepAwaitable*)arg;
+
+    // The wheel has finished with the timer, so the coroutine may destroy the awaitable
+    sleeper->_coroutine.resume();
+  }
+
+
+  void SleepAwaitable::await_suspend( std::coroutine_handle<> coroutine )
+  {
+    _coroutine = coroutine;
+    _worker = getCurrentWorker();
+    if ( _worker == nullptr )
+    {
+      _worker = &_manager->_controlWorker;
+    }
+
+    _timer.reset( new WheelTimer() );
+    _timer->setCallback( _wake, (void*)this );
+    _worker->timers->arm( _timer.get(), _time );
+  }
+
+
+  void ConnectAwaitable::await_suspend( std::coroutine_handle<> coroutine )
+  {
+    WorkerData* worker = getCurrentWorker();
+    if ( worker == nullptr )
+    {
+      worker = &_manager->_controlWorker;
+    }
+
+    _manager->requestConnectTo( _host, _port, _identifier, [this, worker, coroutine]( Handle handle )
+    {
+      _result = std::move( handle );
+
+      if ( getCurrentWorker() == worker )
+        coroutine.resume();
+      else
+        postWorkerJob( worker, [coroutine]() { coroutine.resume(); } );
+    } );
+  }
+
+}
+
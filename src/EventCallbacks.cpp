@@ -3,13 +3,18 @@
 #include "CallbackInterface.h"
 #include "ManagerImpl.h"
 #include "TimerData.h"
+#include "TimerWheel.h"
 #include "WorkerThread.h"
 #include "Handle.h"
 #include "Connection.h"
 #include "Serializer.h"
+#include "FilterChain.h"
 #include "Buffer.h"
+#include "Resolver.h"
+#include "ConnectionPool.h"
 
 #include <cmath>
+#include <algorithm>
 #include <cstring>
 #include <cerrno>
 
@@ -20,7 +25,7 @@ namespace Stewardess
   ////////////////////////////////////////////////////////////////////////////////
   // Listener call back functions
 
-  void listenerAcceptCB( evconnlistener* /*listener*/, evutil_socket_t new_socket, sockaddr* address, int /*address_length*/, void* arg )
+  void listenerAcceptCB( evconnlistener* /*listener*/, evutil_socket_t new_socket, sockaddr* address, int address_length, void* arg )
   {
     ManagerImpl* data = (ManagerImpl*)arg;
     DEBUG_LOG( "Stewardess::Listener", "New connection found" );
@@ -28,26 +33,11 @@ namespace Stewardess
     // Make the socket non-blocking - this happens by default when using a listener
 //    evutil_make_socket_nonblocking( new_socket );
 
-    event_base* worker_base;
-    // Choose a worker to handle it
-    if ( data->_threads.size() == 0 )
-    {
-      worker_base = data->_eventBase;
-    }
-    else
-    {
-      worker_base = data->_threads[ data->getNextThread() ]->data.eventBase;
-    }
-
-    // Create the connection 
-    Connection* connection = new Connection( *address, *data, worker_base, new_socket );
-    connection->bufferSize = data->_configuration.bufferSize;
-      
-    // Add the new connection to the manager
-    data->addConnection( connection );
-
-    // Signal that something has connected
-    data->_server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
+    // Choose a worker to handle it. Accepted on that worker, so the Connect event comes before anything is read
+    WorkerData* worker = data->getNextWorker( 0, address );
+    sockaddr_storage storage = {};
+    std::memcpy( &storage, address, std::min( (size_t)address_length, sizeof( storage ) ) );
+    postWorkerJob( worker, [data, worker, new_socket, storage]() { data->acceptConnection( worker, new_socket, (sockaddr*)&storage ); } );
   }
 
 
@@ -62,6 +52,27 @@ namespace Stewardess
   }
 
 
+  void workerAcceptCB( evconnlistener* /*listener*/, evutil_socket_t new_socket, sockaddr* address, int /*address_length*/, void* arg )
+  {
+    WorkerData* worker = (WorkerData*)arg;
+    DEBUG_LOG( "Stewardess::Listener", "New connection found by worker" );
+
+    // The kernel already chose this worker
+    worker->manager->acceptConnection( worker, new_socket, address );
+  }
+
+
+  void workerListenerErrorCB( evconnlistener* /*listener*/, void* arg )
+  {
+    WorkerData* worker = (WorkerData*)arg;
+
+    int err = EVUTIL_SOCKET_ERROR();
+    ERROR_STREAM( "Stewardess::Listener" ) << "An error occured with a worker listener: " << evutil_socket_error_to_string( err );
+
+    worker->manager->_server.onEvent( ServerEvent::ListenerError, evutil_socket_error_to_string( err ) );
+  }
+
+
   ////////////////////////////////////////////////////////////////////////////////
   // Server signal callbacks
 
@@ -94,6 +105,13 @@ namespace Stewardess
     auto duration = new_stamp - data->_tickTimeStamp;
     data->_tickTimeStamp = new_stamp;
 
+    // Refresh the worker load figures used for placement
+    data->updateWorkerLoads();
+    data->rebalanceWorkers();
+
+    // Reap idle pooled connections and top the endpoints back up
+    data->_pool->maintain();
+
     // Trigger the callback
     data->_server.onTick( std::chrono::duration_cast<std::chrono::milliseconds>( duration ) );
 
@@ -102,7 +120,7 @@ namespace Stewardess
   }
 
 
-  void userTimerCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
+  void userTimerCB( void* arg )
   {
     TimerData* timer = (TimerData*)arg;
 
@@ -110,107 +128,100 @@ namespace Stewardess
 
     if ( timer->repeat )
     {
-      event_add( timer->theEvent, &timer->time );
+      timer->manager->_controlWorker.timers->arm( &timer->timer, timer->time.load() );
     }
   }
 
 
-  void connectCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
+  void connectionTimerCB( void* arg )
   {
-    ManagerImpl* data = (ManagerImpl*)arg;
+    Connection::ConnectionTimer* timer = (Connection::ConnectionTimer*)arg;
+    Connection* connection = timer->connection;
+    UniqueID id = timer->identifier;
 
-    ConnectionRequest request;
+    // Once the connection has closed its timers are being cancelled
+    HandleRef handle = connection->borrowHandle();
+    bool fire;
     {
-      GuardLock lk( data->_connectionRequestsMutex );
-      if ( data->_connectionRequests.empty() ) return;
-      request = data->_connectionRequests.front();
-      data->_connectionRequests.pop();
-    }
-
-    // Find the server address
-    evutil_addrinfo address_hints;
-    evutil_addrinfo* address_answer = nullptr;
-
-    memset( &address_hints, 0, sizeof( address_hints ) );
-    address_hints.ai_family = AF_UNSPEC;
-    address_hints.ai_socktype = SOCK_STREAM;
-    address_hints.ai_protocol = IPPROTO_TCP;
-    address_hints.ai_flags = EVUTIL_AI_ADDRCONFIG;
+      GuardLock lk( connection->_theMutex );
+      fire = ! connection->_close && timer->active;
+      timer->armed = false;
 
+      if ( fire && timer->repeat )
+        timer->due = std::chrono::steady_clock::now() + timer->time;
+      else
+        timer->active = false;
 
-    // Resolve the hostname
-    int result = evutil_getaddrinfo( request.address.c_str(), request.port.c_str(), &address_hints, &address_answer );
-    if ( result != 0 )
-    {
-      ERROR_STREAM( "Stewardess::Manager" ) << "Could not resolve hostname: " << request.address;
-      data->_server.onEvent( ServerEvent::RequestConnectFail, "Could not resolve hostname" );
-      return;
+      // Frees the timer unless it repeats
+      connection->_syncTimer( connection->_timers.find( id ) );
     }
 
-    // Request a socket
-    evutil_socket_t new_socket = socket( address_answer->ai_family, address_answer->ai_socktype, address_answer->ai_protocol );
-    if ( new_socket < 0 )
+    if ( fire )
     {
-      while( address_answer != nullptr )
-      {
-        evutil_addrinfo* temp = address_answer->ai_next;
-        free( address_answer );
-        address_answer = temp;
-      }
-      ERROR_LOG( "Stewardess::Manager", "Failed to create a socket" );
-      data->_server.onEvent( ServerEvent::RequestConnectFail, "Could not create socket" );
-      return;
+      connection->manager._server.onConnectionTimer( handle, id );
     }
+  }
+
+
+  void timeoutSweepCB( void* arg )
+  {
+    WorkerData* worker = (WorkerData*)arg;
+
+    worker->manager->checkTimeouts( worker );
+  }
+
+
+  void wheelTimerCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
+  {
+    TimerWheel* wheel = (TimerWheel*)arg;
+    WorkerBusyTimer busy_timer( wheel->_owner );
+
+    wheel->_expire();
+  }
 
-    // Try to connect to the remote host
-    INFO_STREAM( "Stewardess::Manager" ) << "Connecting to host: " << request.address;
-    if ( connect( new_socket, address_answer->ai_addr, address_answer->ai_addrlen ) )
-    {
-      EVUTIL_CLOSESOCKET( new_socket );
-      while( address_answer != nullptr )
-      {
-        evutil_addrinfo* temp = address_answer->ai_next;
-        free( address_answer );
-        address_answer = temp;
-      }
-      ERROR_STREAM( "Stewardess::Manager" ) << "Failed to connect to server " << request.address << ":" << request.port;
-      data->_server.onEvent( ServerEvent::RequestConnectFail, "Failed to connect to server" );
-      return;
-    }
 
-    // Make the socket non-blocking
-    evutil_make_socket_nonblocking( new_socket );
+  void connectCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
+  {
+    ManagerImpl* data = (ManagerImpl*)arg;
 
-    event_base* worker_base;
-    if ( data->_threads.size() == 0 )
+    // Take every queued request at once. None of them wait here for the handshake
+    std::queue< ConnectionRequest > requests;
     {
-      worker_base = data->_eventBase;
+      GuardLock lk( data->_connectionRequestsMutex );
+      std::swap( requests, data->_connectionRequests );
     }
-    else
+
+    while ( ! requests.empty() )
     {
-      worker_base = data->_threads[ data->getNextThread() ]->data.eventBase;
+      data->startConnect( std::move( requests.front() ) );
+      requests.pop();
     }
+  }
 
-    // Create the connection 
-    Connection* connection = new Connection( *address_answer->ai_addr, *data, worker_base, new_socket );
-    connection->setIdentifier( request.uniqueId );
-    connection->bufferSize =  data->_configuration.bufferSize;
 
-    DEBUG_STREAM( "Stewardess::RequestConnection" ) << "Connected to " << request.address << " : " << request.port.c_str();
+  void connectCompleteCB( evutil_socket_t fd, short what, void* arg )
+  {
+    PendingConnect* pending = (PendingConnect*)arg;
 
-    // Clear the address memory
-    while( address_answer != nullptr )
+    int socket_error = ETIMEDOUT;
+    if ( what & EV_WRITE )
     {
-      evutil_addrinfo* temp = address_answer->ai_next;
-      free( address_answer );
-      address_answer = temp;
+      socklen_t length = sizeof( socket_error );
+      if ( getsockopt( fd, SOL_SOCKET, SO_ERROR, &socket_error, &length ) != 0 )
+      {
+        socket_error = errno;
+      }
     }
 
-    // Add the new connection to the manager
-    data->addConnection( connection );
+    pending->manager->finishConnect( pending, socket_error );
+  }
+
 
-    // Signal that something has connected
-    data->_server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
+  void resolverCB( int result, char type, int count, int ttl, void* addresses, void* arg )
+  {
+    Resolver::Query* query = (Resolver::Query*)arg;
+
+    query->resolver->_answer( query, result, type, count, ttl, addresses );
   }
 
 
@@ -220,13 +231,14 @@ namespace Stewardess
   void readCB( evutil_socket_t fd, short /*flags*/, void* arg )
   {
     Connection* connection = (Connection*)arg;
+    WorkerBusyTimer busy_timer( connection->getWorker(), &connection->_busyTime );
     DEBUG_LOG( "Stewardess::SocketRead", "Socket Read called" );
 
-    // Keep hold of a handle before anything happens
-    Handle temp_handle = connection->requestHandle();
+    // The connection can only be destroyed by this worker's loop, so borrowing it is enough
+    HandleRef temp_handle = connection->borrowHandle();
 
     ssize_t result;
-    bool good = connection->isOpen() && temp_handle;
+    bool good = connection->isOpen();
 
     Buffer buffer;
 
@@ -269,15 +281,94 @@ namespace Stewardess
       }
     }
 
+    if ( buffer )
+    {
+      connection->_lastRead = CoarseClock::now();
+    }
+
+    if ( buffer && connection->filters != nullptr )
+    {
+      FilterChain* filters = connection->filters;
+      bool ready = filters->ready();
+
+      Buffer plain( connection->bufferSize );
+      bool filtered = filters->read( std::move( buffer ), plain );
+
+      while( ! filters->errorEmpty() )
+      {
+        const char* error = filters->getError();
+        ERROR_STREAM( "Stewardess::SocketRead" ) << "Filter error occured: " << error;
+        connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::SerializationError, error );
+      }
+
+      if ( filtered )
+      {
+        buffer = std::move( plain );
+
+        // Release anything the filters were holding back
+        if ( ! ready && filters->ready() )
+        {
+          event_add( connection->_writeEvent, nullptr );
+        }
+      }
+      else
+      {
+        ERROR_STREAM( "Stewardess::SocketRead" ) << "Filter failed. Closing connection: " << connection->getConnectionID();
+        buffer.clear();
+        if ( connection->isOpen() )
+        {
+          connection->close();
+          connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::DisconnectError, "Filter failed while reading" );
+        }
+      }
+    }
+
     if ( buffer )
     {
       connection->serializer->deserialize( &buffer );
     }
 
-    while ( ! connection->serializer->payloadEmpty() )
+    if ( connection->_coroutineReads )
     {
-      DEBUG_LOG( "Stewardess::SocketRead", "Calling on read handler" );
-      connection->manager._server.onRead( temp_handle, connection->serializer->getPayload() );
+      // A coroutine is reading this connection. It resumes here, on the worker
+      while ( ! connection->serializer->payloadEmpty() )
+      {
+        Payload* payload = connection->serializer->getPayload();
+        if ( ! connection->_responded( payload ) )
+        {
+          connection->_deliverRead( payload );
+        }
+      }
+    }
+    else if ( connection->manager._executor != nullptr )
+    {
+      // Heavy handlers run on the compute pool. Their writes come back through the inbox
+      std::queue< Payload* > payloads;
+      while ( ! connection->serializer->payloadEmpty() )
+      {
+        Payload* payload = connection->serializer->getPayload();
+        if ( ! connection->_responded( payload ) )
+        {
+          payloads.push( payload );
+        }
+      }
+      if ( ! payloads.empty() )
+      {
+        DEBUG_LOG( "Stewardess::SocketRead", "Queueing payloads for the compute pool" );
+        connection->_queueReads( std::move( payloads ), Handle( temp_handle ) );
+      }
+    }
+    else
+    {
+      while ( ! connection->serializer->payloadEmpty() )
+      {
+        Payload* payload = connection->serializer->getPayload();
+        if ( ! connection->_responded( payload ) )
+        {
+          DEBUG_LOG( "Stewardess::SocketRead", "Calling on read handler" );
+          connection->manager._server.onRead( temp_handle, payload );
+        }
+      }
     }
 
     while( ! connection->serializer->errorEmpty() )
@@ -296,14 +387,17 @@ namespace Stewardess
   {
     Connection* connection = (Connection*)arg;
     Serializer* serializer = connection->serializer;
+    FilterChain* filters = connection->filters;
+    WorkerBusyTimer busy_timer( connection->getWorker(), &connection->_busyTime );
     DEBUG_LOG( "Stewardess::SocketWrite", "Socket Write Called" );
 
-    // Keep hold of a handle before anything happens
-    Handle temp_handle = connection->requestHandle();
+    // The connection can only be destroyed by this worker's loop, so borrowing it is enough
+    HandleRef temp_handle = connection->borrowHandle();
 
     ssize_t result;
-    ssize_t write_count;
-    bool good = connection->isOpen() && temp_handle;
+    bool good = connection->isOpen();
+    bool blocked = false;
+    bool wrote = false;
 
     while( ! serializer->errorEmpty() )
     {
@@ -312,55 +406,116 @@ namespace Stewardess
       connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::SerializationError, error );
     }
 
-    while ( ! serializer->bufferEmpty() && good )
+    while ( good && ! blocked )
     {
-      write_count = 0;
-      Buffer* buf = serializer->getBuffer();
-      while ( *buf )
+      if ( ! connection->_current )
       {
-        result = write( fd, buf->chunk() + write_count, buf->chunkSize() - write_count );
-        DEBUG_STREAM( "Stewardess::SocketWrite" ) << "Wrote " << result;
+        // Hold everything back while the filters aren't ready, e.g. during a handshake
+        if ( filters != nullptr && ! filters->ready() ) break;
 
-        if ( result <= 0 )
+        SharedBuffer next;
         {
-          if ( result == 0 ) // EOF
+          GuardLock lk( connection->_theMutex );
+          if ( connection->_output.empty() ) break;
+          next = std::move( connection->_output.front() );
+          connection->_output.pop_front();
+        }
+
+        if ( filters != nullptr )
+        {
+          // Take the data if nobody else is sharing it, otherwise the filters work on a copy
+          Buffer input = ( next.use_count() == 1 ) ? std::move( const_cast< Buffer& >( *next ) ) : Buffer( *next );
+          next.reset();
+
+          Buffer* wire = new Buffer( connection->bufferSize );
+          bool filtered = filters->write( std::move( input ), *wire );
+
+          while( ! filters->errorEmpty() )
           {
-            ERROR_LOG( "Stewardess::WriteSocket", "Unexpected end of File" );
-            good = false;
-            break;
+            const char* error = filters->getError();
+            ERROR_STREAM( "Stewardess::SocketWrite" ) << "Filter error occured: " << error;
+            connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::SerializationError, error );
           }
-          else if ( errno == EAGAIN )
+
+          if ( ! filtered )
           {
-            WARN_STREAM( "Stewardess::SocketWrite" ) << "Connection closed during write operation: " << connection->getConnectionID();
+            delete wire;
+            ERROR_STREAM( "Stewardess::SocketWrite" ) << "Filter failed. Closing connection: " << connection->getConnectionID();
             connection->close();
-            connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::DisconnectError );
+            connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::DisconnectError, "Filter failed while writing" );
             good = false;
             break;
           }
-          else 
+          next = SharedBuffer( wire );
+        }
+
+        connection->_current = std::move( next );
+        connection->_outputOffset = 0;
+      }
+
+      // Skip anything written during a previous call
+      Buffer::Iterator it = connection->_current->getIterator();
+      it.advance( connection->_outputOffset );
+
+      while ( it )
+      {
+        result = write( fd, it.data(), it.remaining() );
+        DEBUG_STREAM( "Stewardess::SocketWrite" ) << "Wrote " << result;
+
+        if ( result < 0 )
+        {
+          if ( errno == EAGAIN )
+          {
+            // Socket buffer is full. Carry on when it is writable again
+            DEBUG_STREAM( "Stewardess::SocketWrite" ) << "EAGAIN";
+            blocked = true;
+          }
+          else
           {
             ERROR_STREAM( "Stewardess::WriteSocket" ) << "An error occured on connection: " << connection->getConnectionID() << ". Error: " << std::strerror( errno );
             connection->close();
             connection->manager._server.onConnectionEvent( temp_handle, ConnectionEvent::DisconnectError );
             good = false;
-            break;
           }
+          break;
         }
-        else if ( result == (ssize_t)buf->chunkSize()-write_count ) // Wrote everything
+        else if ( result == 0 ) // EOF
         {
-          buf->popChunk();
-          write_count = 0;
-        }
-        else
-        {
-          write_count += result;
+          ERROR_LOG( "Stewardess::WriteSocket", "Unexpected end of File" );
+          good = false;
+          break;
         }
+
+        it.advance( result );
+        connection->_outputOffset += result;
+        wrote = true;
       }
-      delete buf;
+
+      if ( ! it ) // Wrote everything
+      {
+        connection->_current.reset();
+        connection->_outputOffset = 0;
+      }
+    }
+
+    // The write timeout runs from the last progress, or from when the socket first filled up
+    if ( wrote || ( blocked && ! connection->_writeBlocked ) )
+    {
+      connection->_lastWrite = CoarseClock::now();
     }
+    connection->_writeBlocked = blocked;
 
-    if ( good )
+    if ( blocked )
+    {
+      event_add( connection->_writeEvent, nullptr );
+    }
+    else if ( good )
     {
+      if ( ! connection->_current )
+      {
+        connection->_flushed();
+      }
+
       DEBUG_LOG( "Stewardess::SocketWrite", "Calling on write handler" );
       connection->manager._server.onWrite( temp_handle );
     }
@@ -379,6 +534,76 @@ namespace Stewardess
   }
 
 
+  void workerInboxCB( evutil_socket_t fd, short /*what*/, void* arg )
+  {
+    WorkerData* data = (WorkerData*)arg;
+    WorkerBusyTimer busy_timer( data );
+
+    // Reset the eventfd before taking the inbox, so a later push always wakes us again
+    uint64_t count;
+    if ( read( fd, &count, sizeof( count ) ) < 0 && errno != EAGAIN )
+    {
+      ERROR_STREAM( "Stewardess::WorkerInbox" ) << "Could not read the inbox eventfd: " << std::strerror( errno );
+    }
+
+    // Timers armed and cancelled from other threads share the eventfd
+    data->timers->processCommands();
+
+    // Take everything at once. The stack is newest first, so reverse it
+    Connection* connection = data->inbox.exchange( nullptr, std::memory_order_acquire );
+    Connection* ordered = nullptr;
+    while ( connection != nullptr )
+    {
+      Connection* next = connection->_inboxNext;
+      connection->_inboxNext = ordered;
+      ordered = connection;
+      connection = next;
+    }
+
+    while ( ordered != nullptr )
+    {
+      connection = ordered;
+      ordered = connection->_inboxNext;
+      connection->_inboxNext = nullptr;
+
+      // Writes queued from now on need to schedule again
+      connection->_writeScheduled = false;
+
+      if ( connection->getWorker() == data )
+      {
+        writeCB( connection->_socket, EV_WRITE, connection );
+      }
+      else
+      {
+        // Migrated since it was scheduled. Its new worker does the writing
+        event_add( connection->_writeEvent, nullptr );
+      }
+
+      connection->decrementReferences();
+    }
+  }
+
+
+  void workerJobCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
+  {
+    WorkerData* data = (WorkerData*)arg;
+    WorkerBusyTimer busy_timer( data );
+
+    // Take every job queued so far, so the lock isn't held while they run
+    WorkerJobQueue jobs;
+    {
+      GuardLock lk( data->jobsMutex );
+      std::swap( jobs, data->jobs );
+    }
+
+    while ( ! jobs.empty() )
+    {
+      jobs.front()();
+      jobs.pop();
+    }
+  }
+
+
   void workerTickCB( evutil_socket_t /*socket*/, short /*what*/, void* arg )
   {
     WorkerData* data = (WorkerData*)arg;
@@ -0,0 +1,43 @@
+
+#include "Filter.h"
+#include "Buffer.h"
+
+
+namespace Stewardess
+{
+
+  void Filter::pushError( const char* e )
+  {
+    _errors.push( e );
+  }
+
+
+  bool Filter::write( Buffer&& input, Buffer& output )
+  {
+    output.append( std::move( input ) );
+    return true;
+  }
+
+
+  bool Filter::read( Buffer&& input, Buffer& output )
+  {
+    output.append( std::move( input ) );
+    return true;
+  }
+
+
+  const char* Filter::getError()
+  {
+    const char* temp = _errors.front();
+    _errors.pop();
+    return temp;
+  }
+
+
+  bool Filter::errorEmpty() const
+  {
+    return _errors.empty();
+  }
+
+}
+
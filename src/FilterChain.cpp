@@ -0,0 +1,121 @@
+
+#include "FilterChain.h"
+#include "Buffer.h"
+
+
+namespace Stewardess
+{
+
+  FilterChain::FilterChain( FilterVector&& filters ) :
+    _filters( std::move( filters ) )
+  {
+  }
+
+
+  FilterChain::~FilterChain()
+  {
+    for ( FilterVector::iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      delete (*it);
+    }
+  }
+
+
+  void FilterChain::open( Buffer& output )
+  {
+    for ( size_t i = 0; i < _filters.size(); ++i )
+    {
+      Buffer data( output.allocationSize() );
+      _filters[i]->open( data );
+
+      for ( size_t j = i+1; j < _filters.size() && data; ++j )
+      {
+        Buffer next( output.allocationSize() );
+        _filters[j]->write( std::move( data ), next );
+        data = std::move( next );
+      }
+
+      output.append( std::move( data ) );
+    }
+  }
+
+
+  bool FilterChain::write( Buffer&& input, Buffer& output )
+  {
+    Buffer data( std::move( input ) );
+
+    for ( FilterVector::iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      Buffer next( output.allocationSize() );
+      if ( ! (*it)->write( std::move( data ), next ) )
+        return false;
+      data = std::move( next );
+    }
+
+    output.append( std::move( data ) );
+    return true;
+  }
+
+
+  bool FilterChain::read( Buffer&& input, Buffer& output )
+  {
+    Buffer data( std::move( input ) );
+
+    for ( FilterVector::reverse_iterator it = _filters.rbegin(); it != _filters.rend(); ++it )
+    {
+      Buffer next( output.allocationSize() );
+      if ( ! (*it)->read( std::move( data ), next ) )
+        return false;
+      data = std::move( next );
+    }
+
+    output.append( std::move( data ) );
+    return true;
+  }
+
+
+  bool FilterChain::ready() const
+  {
+    for ( FilterVector::const_iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      if ( ! (*it)->ready() )
+        return false;
+    }
+    return true;
+  }
+
+
+  bool FilterChain::expire( SteadyTime now )
+  {
+    for ( FilterVector::iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      if ( ! (*it)->ready() && ! (*it)->expire( now ) )
+        return false;
+    }
+    return true;
+  }
+
+
+  const char* FilterChain::getError()
+  {
+    for ( FilterVector::iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      if ( ! (*it)->errorEmpty() )
+        return (*it)->getError();
+    }
+    return nullptr;
+  }
+
+
+  bool FilterChain::errorEmpty() const
+  {
+    for ( FilterVector::const_iterator it = _filters.begin(); it != _filters.end(); ++it )
+    {
+      if ( ! (*it)->errorEmpty() )
+        return false;
+    }
+    return true;
+  }
+
+}
+
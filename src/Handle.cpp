@@ -4,24 +4,36 @@
 #include "InetAddress.h"
 #include "Payload.h"
 #include "Serializer.h"
+#include "Buffer.h"
+#include "Coroutine.h"
 
 
 namespace Stewardess
 {
 
   Handle::Handle() :
-    _connection( nullptr )
+    HandleRef()
   {
   }
 
 
   Handle::Handle( Connection* d ) :
-    _connection( d )
+    HandleRef( d )
   {
     _connection->incrementReferences();
   }
 
 
+  Handle::Handle( const HandleRef& other ) :
+    HandleRef( other )
+  {
+    if ( _connection )
+    {
+      _connection->incrementReferences();
+    }
+  }
+
+
   Handle::~Handle()
   {
     if ( _connection )
@@ -32,7 +44,7 @@ namespace Stewardess
 
 
   Handle::Handle( const Handle& other ) :
-    _connection( other._connection )
+    HandleRef( other._connection )
   {
     if ( _connection )
     {
@@ -42,7 +54,7 @@ namespace Stewardess
 
 
   Handle::Handle( Handle&& other ) :
-    _connection( std::exchange( other._connection, nullptr ) )
+    HandleRef( std::exchange( other._connection, nullptr ) )
   {
   }
 
@@ -88,7 +100,7 @@ namespace Stewardess
   }
 
 
-  const InetAddress& Handle::getIPAddress() const
+  const InetAddress& HandleRef::getIPAddress() const
   {
     return _connection->socketAddress;
 //    if ( _connection->socketAddress.sa_family == AF_INET )
@@ -106,51 +118,105 @@ namespace Stewardess
   }
 
 
-  bool Handle::isOpen() const
+  bool HandleRef::isOpen() const
   {
     return _connection->isOpen();
   }
 
 
-  void Handle::close() const
+  void HandleRef::close() const
   {
     _connection->close();
   }
 
 
-  void Handle::write( Payload* p ) const
+  WriteAwaitable HandleRef::write( Payload* p ) const
+  {
+    return WriteAwaitable( _connection, _connection->write( p ) );
+  }
+
+
+  ReadAwaitable Handle::read() const
+  {
+    return ReadAwaitable( _connection );
+  }
+
+
+  void HandleRef::readInCoroutine() const
+  {
+    _connection->readInCoroutine();
+  }
+
+
+  void HandleRef::writeRaw( Buffer&& buffer ) const
+  {
+    _connection->writeRaw( std::move( buffer ) );
+  }
+
+
+  void HandleRef::writeRaw( BufferVector&& buffers ) const
   {
-    _connection->write( p );
+    _connection->writeRaw( std::move( buffers ) );
   }
 
 
-  ConnectionID Handle::getConnectionID() const
+  ConnectionID HandleRef::getConnectionID() const
   {
     return _connection->getConnectionID();
   }
 
 
-  UniqueID Handle::getIdentifier() const
+  UniqueID HandleRef::getIdentifier() const
   {
     return _connection->getIdentifier();
   }
 
 
-  void Handle::setIdentifier( UniqueID id )
+  void HandleRef::setIdentifier( UniqueID id ) const
   {
     _connection->setIdentifier( id );
   }
 
 
-  TimeStamp Handle::creationTime() const
+  TimeStamp HandleRef::creationTime() const
   {
     return _connection->getCreationTime();
   }
 
 
-  TimeStamp Handle::lastAccess() const
+  TimeStamp HandleRef::lastAccess() const
+  {
+    return convertToWallTime( _connection->getAccess() );
+  }
+
+
+  size_t HandleRef::getOutstanding() const
+  {
+    return _connection->getOutstanding();
+  }
+
+
+  Microseconds HandleRef::getLatency() const
+  {
+    return _connection->getLatency();
+  }
+
+
+  bool HandleRef::startTimer( UniqueID id, Milliseconds delay, bool repeat ) const
+  {
+    return _connection->startTimer( id, delay, repeat );
+  }
+
+
+  void HandleRef::stopTimer( UniqueID id ) const
+  {
+    _connection->stopTimer( id );
+  }
+
+
+  CompressionStatistics HandleRef::getCompressionStatistics() const
   {
-    return _connection->getAccess();
+    return _connection->getCompressionStatistics();
   }
 
 }
@@ -0,0 +1,796 @@
+
+#include "LoadBalancer.h"
+#include "Connection.h"
+#include "Coroutine.h"
+#include "Exception.h"
+#include "WorkerThread.h"
+#include "EventCallbacks.h"
+#include "Payload.h"
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace Stewardess
+{
+
+  // Response times kept for the hedge delay, how many are needed before hedging starts and
+  //  how many new ones trigger recalculating it
+  static const size_t MaxSamples = 1024;
+  static const size_t MinSamples = 32;
+  static const size_t SampleInterval = 32;
+
+  // Most hedges that can be saved up while things are quiet
+  static const double MaxHedgeTokens = 10.0;
+
+
+  struct LoadBalancer::Request
+  {
+    LoadBalancer* balancer;
+    ResponseCallback callback;
+    std::string key;
+    ConnectionID primary;
+
+    // Kept until the hedge has been sent or is no longer possible. Only the timer releases it
+    std::unique_ptr< Payload > payload;
+
+    // Timer for the hedge and the worker whose wheel it runs in
+    WorkerData* worker;
+    WheelTimer timer;
+
+    // Guards the fields below
+    std::mutex mutex;
+    bool done = false;
+    unsigned attempts = 0;
+  };
+
+
+  // Spread the bits of a hash, so neighbouring IDs land far apart on the ring
+  static uint64_t mixHash( uint64_t x )
+  {
+    x += 0x9E3779B97F4A7C15ull;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+    return x ^ ( x >> 31 );
+  }
+
+
+  LoadBalancer::LoadBalancer( BalancePolicy policy, double load_factor, unsigned virtual_nodes ) :
+    _policy( policy ),
+    _loadFactor( load_factor ),
+    _virtualNodes( virtual_nodes ),
+    _connections(),
+    _ring(),
+    _next( 0 ),
+    _generator( std::random_device()() ),
+    _candidates(),
+    _eligible(),
+    _outlierDetection( false ),
+    _outliers(),
+    _lastLatencyCheck(),
+    _maxOutstanding( 0 ),
+    _hedgePercentile( 0.95 ),
+    _hedgeBudget( 0.0 ),
+    _hedgeTokens( 0.0 ),
+    _samples(),
+    _nextSample( 0 ),
+    _newSamples( 0 ),
+    _hedgeDelay( 0 ),
+    _numberRequests( 0 ),
+    _numberHedges( 0 ),
+    _numberHedgeWins( 0 ),
+    _numberEjections( 0 ),
+    _numberRejected( 0 )
+  {
+    if ( _loadFactor < 1.0 )
+    {
+      throw Exception( "Load balancer load factor must be at least 1" );
+    }
+    if ( _virtualNodes == 0 )
+    {
+      throw Exception( "Load balancer needs at least one virtual node per connection" );
+    }
+  }
+
+
+  void LoadBalancer::add( const Handle& handle )
+  {
+    if ( ! handle ) return;
+
+    GuardLock lk( _mutex );
+    for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      if ( it->handle.getConnectionID() == handle.getConnectionID() ) return;
+    }
+
+    Backend backend;
+    backend.handle = handle;
+    _connections.push_back( backend );
+    this->_buildRing();
+  }
+
+
+  bool LoadBalancer::remove( const Handle& handle )
+  {
+    if ( ! handle ) return false;
+
+    GuardLock lk( _mutex );
+    for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      if ( it->handle.getConnectionID() == handle.getConnectionID() )
+      {
+        _connections.erase( it );
+        this->_buildRing();
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  void LoadBalancer::clear()
+  {
+    GuardLock lk( _mutex );
+    _connections.clear();
+    _ring.clear();
+  }
+
+
+  size_t LoadBalancer::size() const
+  {
+    GuardLock lk( _mutex );
+    return _connections.size();
+  }
+
+
+  void LoadBalancer::_buildRing()
+  {
+    _ring.clear();
+    if ( _policy != BalancePolicy::ConsistentHash ) return;
+
+    // Points depend only on the connection, so the others don't move when one is added or removed
+    _ring.reserve( _connections.size() * _virtualNodes );
+    for ( size_t i = 0; i < _connections.size(); ++i )
+    {
+      uint64_t id = (uint64_t)_connections[i].handle.getConnectionID();
+      for ( unsigned v = 0; v < _virtualNodes; ++v )
+      {
+        _ring.push_back( { mixHash( id ^ mixHash( v ) ), i } );
+      }
+    }
+    std::sort( _ring.begin(), _ring.end() );
+  }
+
+
+  void LoadBalancer::_prune()
+  {
+    size_t before = _connections.size();
+    _connections.erase( std::remove_if( _connections.begin(), _connections.end(), []( const Backend& b ) { return ! b.handle.isOpen(); } ), _connections.end() );
+
+    if ( _connections.size() != before )
+    {
+      DEBUG_STREAM( "Stewardess::LoadBalancer" ) << "Dropped " << before - _connections.size() << " closed connections";
+      this->_buildRing();
+    }
+  }
+
+
+  bool LoadBalancer::_available( Backend& backend, std::chrono::steady_clock::time_point now )
+  {
+    if ( _maxOutstanding != 0 && backend.handle.getOutstanding() >= _maxOutstanding ) return false;
+
+    switch ( backend.state )
+    {
+      case BackendState::Ejected :
+        if ( now < backend.ejectedUntil ) return false;
+        DEBUG_STREAM( "Stewardess::LoadBalancer" ) << "Probing connection " << backend.handle.getConnectionID();
+        backend.state = BackendState::HalfOpen;
+        backend.ejectedUntil = now;
+        backend.probes = 0;
+        backend.probeSuccesses = 0;
+        return true;
+
+      case BackendState::HalfOpen :
+        // Probes sent without a callback may never be reported. Try again rather than wait forever
+        if ( backend.probes >= _outliers.halfOpenRequests && now - backend.ejectedUntil >= _outliers.baseEjectionTime )
+        {
+          backend.ejectedUntil = now;
+          backend.probes = 0;
+          backend.probeSuccesses = 0;
+        }
+        return backend.probes < _outliers.halfOpenRequests;
+
+      case BackendState::Healthy :
+      default :
+        return true;
+    }
+  }
+
+
+  size_t LoadBalancer::_roundRobin()
+  {
+    return _candidates[ _next++ % _candidates.size() ];
+  }
+
+
+  size_t LoadBalancer::_leastOutstanding()
+  {
+    size_t number = _candidates.size();
+    size_t start = _next % number;
+    size_t best = start;
+    size_t best_outstanding = _connections[ _candidates[ start ] ].handle.getOutstanding();
+
+    for ( size_t i = 1; i < number && best_outstanding > 0; ++i )
+    {
+      size_t position = ( start + i ) % number;
+      size_t outstanding = _connections[ _candidates[ position ] ].handle.getOutstanding();
+      if ( outstanding < best_outstanding )
+      {
+        best = position;
+        best_outstanding = outstanding;
+      }
+    }
+
+    // Start after the winner next time, so ties are shared out
+    _next = best + 1;
+    return _candidates[ best ];
+  }
+
+
+  size_t LoadBalancer::_powerOfTwo()
+  {
+    size_t number = _candidates.size();
+    if ( number == 1 ) return _candidates[ 0 ];
+
+    size_t first = _generator() % number;
+    size_t second = ( first + 1 + _generator() % ( number - 1 ) ) % number;
+    first = _candidates[ first ];
+    second = _candidates[ second ];
+
+    uint64_t first_outstanding = _connections[ first ].handle.getOutstanding() + 1;
+    uint64_t second_outstanding = _connections[ second ].handle.getOutstanding() + 1;
+    uint64_t first_latency = _connections[ first ].handle.getLatency().count();
+    uint64_t second_latency = _connections[ second ].handle.getLatency().count();
+
+    // Until both have answered something, only the load can be compared
+    if ( first_latency == 0 || second_latency == 0 )
+    {
+      return ( second_outstanding < first_outstanding ) ? second : first;
+    }
+
+    return ( second_latency * second_outstanding < first_latency * first_outstanding ) ? second : first;
+  }
+
+
+  size_t LoadBalancer::_consistentHash( const std::string& key )
+  {
+    size_t total = 0;
+    for ( std::vector< size_t >::iterator it = _candidates.begin(); it != _candidates.end(); ++it )
+    {
+      total += _connections[ *it ].handle.getOutstanding();
+    }
+
+    // Bounded load: nobody takes more than the load factor times the average, counting this request
+    size_t capacity = (size_t)std::ceil( _loadFactor * ( total + 1 ) / _candidates.size() );
+
+    Ring::iterator start = std::lower_bound( _ring.begin(), _ring.end(), RingPoint { mixHash( std::hash< std::string >()( key ) ), 0 } );
+    size_t offset = start - _ring.begin();
+
+    for ( size_t i = 0; i < _ring.size(); ++i )
+    {
+      const RingPoint& point = _ring[ ( offset + i ) % _ring.size() ];
+      if ( _eligible[ point.index ] && _connections[ point.index ].handle.getOutstanding() < capacity )
+      {
+        return point.index;
+      }
+    }
+
+    // The capacity is above the average, so someone always has room
+    return _candidates[ 0 ];
+  }
+
+
+  size_t LoadBalancer::_pick( const std::string& key, ConnectionID exclude )
+  {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if ( _outlierDetection && _outliers.latencyFactor > 0.0 )
+    {
+      this->_checkLatency( now );
+    }
+
+    _candidates.clear();
+    _eligible.assign( _connections.size(), false );
+    for ( size_t i = 0; i < _connections.size(); ++i )
+    {
+      if ( _connections[i].handle.getConnectionID() == exclude ) continue;
+      if ( this->_available( _connections[i], now ) )
+      {
+        _candidates.push_back( i );
+        _eligible[i] = true;
+      }
+    }
+
+    if ( _candidates.empty() ) return _connections.size();
+
+    size_t index;
+    switch ( _policy )
+    {
+      case BalancePolicy::LeastOutstanding :
+        index = this->_leastOutstanding();
+        break;
+
+      case BalancePolicy::PowerOfTwoChoices :
+        index = this->_powerOfTwo();
+        break;
+
+      case BalancePolicy::ConsistentHash :
+        index = this->_consistentHash( key );
+        break;
+
+      case BalancePolicy::RoundRobin :
+      default :
+        index = this->_roundRobin();
+        break;
+    }
+
+    if ( _connections[ index ].state == BackendState::HalfOpen )
+    {
+      _connections[ index ].probes += 1;
+    }
+    return index;
+  }
+
+
+  Handle LoadBalancer::_select( const std::string& key, ConnectionID exclude )
+  {
+    GuardLock lk( _mutex );
+    this->_prune();
+
+    size_t index = this->_pick( key, exclude );
+    if ( index == _connections.size() )
+    {
+      _numberRejected += 1;
+      return Handle();
+    }
+
+    return _connections[ index ].handle;
+  }
+
+
+  Handle LoadBalancer::select( const std::string& key )
+  {
+    return this->_select( key );
+  }
+
+
+  Handle LoadBalancer::send( Payload* payload, const std::string& key )
+  {
+    Handle handle = this->_select( key );
+    if ( handle )
+    {
+      // Counted first, so a quick response can't arrive before it
+      handle._connection->beginRequest();
+      handle.write( payload );
+    }
+    return handle;
+  }
+
+
+  bool LoadBalancer::request( Payload* payload, ResponseCallback callback, const std::string& key )
+  {
+    Handle handle = this->_select( key );
+    if ( ! handle )
+    {
+      delete payload;
+      return false;
+    }
+
+    RequestPointer request = std::make_shared< Request >();
+    request->balancer = this;
+    request->callback = std::move( callback );
+    request->key = key;
+    request->primary = handle.getConnectionID();
+    request->payload.reset( payload );
+    request->worker = handle._connection->getWorker();
+
+    Microseconds delay( 0 );
+    {
+      GuardLock lk( _mutex );
+      _numberRequests += 1;
+      if ( _hedgeBudget > 0.0 )
+      {
+        _hedgeTokens = std::min( MaxHedgeTokens, _hedgeTokens + _hedgeBudget );
+        delay = _hedgeDelay;
+      }
+    }
+
+    this->_attempt( request, handle );
+
+    if ( delay.count() == 0 )
+    {
+      request->payload.reset();
+      return true;
+    }
+
+    // The timer holds its own reference, so the request outlives a quick answer
+    // The wheel ticks in milliseconds, so round up rather than hedge early
+    request->timer.setCallback( hedgeTimerCB, (void*)new RequestPointer( request ) );
+    request->worker->timers->arm( &request->timer, std::chrono::ceil< Milliseconds >( delay ) );
+    return true;
+  }
+
+
+  void LoadBalancer::_attempt( const RequestPointer& request, const Handle& handle )
+  {
+    {
+      GuardLock lk( request->mutex );
+      request->attempts += 1;
+    }
+
+    std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+    handle._connection->beginRequest( [this, request, sent]( const Handle& h, Payload* p ) { this->_answered( request, h, p, sent ); } );
+    handle.write( request->payload.get() );
+  }
+
+
+  void LoadBalancer::_answered( const RequestPointer& request, const Handle& handle, Payload* payload, std::chrono::steady_clock::time_point sent )
+  {
+    // Late answers count too, they are what the percentile is looking for
+    if ( payload != nullptr )
+    {
+      uint64_t time = std::chrono::duration_cast< Microseconds >( std::chrono::steady_clock::now() - sent ).count();
+      {
+        GuardLock lk( _mutex );
+        this->_addSample( time );
+      }
+      this->_result( handle.getConnectionID(), true, time );
+    }
+    else
+    {
+      this->_result( handle.getConnectionID(), false );
+    }
+
+    ResponseCallback callback;
+    {
+      GuardLock lk( request->mutex );
+      request->attempts -= 1;
+
+      // The other attempt already answered
+      if ( request->done )
+      {
+        delete payload;
+        return;
+      }
+
+      // Failed, but the other attempt may still answer
+      if ( payload == nullptr && request->attempts > 0 ) return;
+
+      request->done = true;
+      callback = std::move( request->callback );
+    }
+
+    if ( payload != nullptr && handle.getConnectionID() != request->primary )
+    {
+      GuardLock lk( _mutex );
+      _numberHedgeWins += 1;
+    }
+
+    callback( handle, payload );
+  }
+
+
+  void hedgeTimerCB( void* arg )
+  {
+    LoadBalancer::RequestPointer* pointer = (LoadBalancer::RequestPointer*)arg;
+    LoadBalancer::RequestPointer request = std::move( *pointer );
+    delete pointer;
+
+    request->balancer->_hedge( request );
+  }
+
+
+  void LoadBalancer::_hedge( const RequestPointer& request )
+  {
+    bool waiting;
+    {
+      GuardLock lk( request->mutex );
+      waiting = ! request->done && request->attempts > 0;
+    }
+
+    Handle other;
+    if ( waiting )
+    {
+      GuardLock lk( _mutex );
+      this->_prune();
+      if ( _hedgeTokens >= 1.0 )
+      {
+        size_t index = this->_pick( request->key, request->primary );
+        if ( index != _connections.size() )
+        {
+          other = _connections[ index ].handle;
+          _hedgeTokens -= 1.0;
+          _numberHedges += 1;
+        }
+      }
+    }
+
+    if ( other )
+    {
+      DEBUG_STREAM( "Stewardess::LoadBalancer" ) << "Hedging request to " << other.getConnectionID();
+      this->_attempt( request, other );
+    }
+
+    request->payload.reset();
+  }
+
+
+  void LoadBalancer::_addSample( uint64_t time )
+  {
+    if ( _samples.size() < MaxSamples )
+    {
+      _samples.push_back( time );
+    }
+    else
+    {
+      _samples[ _nextSample ] = time;
+      _nextSample = ( _nextSample + 1 ) % MaxSamples;
+    }
+
+    _newSamples += 1;
+    if ( _samples.size() < MinSamples || _newSamples < SampleInterval ) return;
+    _newSamples = 0;
+
+    std::vector< uint64_t > sorted( _samples );
+    size_t position = std::min( sorted.size() - 1, (size_t)( _hedgePercentile * sorted.size() ) );
+    std::nth_element( sorted.begin(), sorted.begin() + position, sorted.end() );
+    _hedgeDelay = Microseconds( std::max( sorted[ position ], (uint64_t)1 ) );
+  }
+
+
+  void LoadBalancer::_result( ConnectionID id, bool success, uint64_t time )
+  {
+    GuardLock lk( _mutex );
+    if ( ! _outlierDetection ) return;
+
+    BackendVector::iterator backend = _connections.begin();
+    while ( backend != _connections.end() && backend->handle.getConnectionID() != id ) ++backend;
+    if ( backend == _connections.end() ) return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if ( success )
+    {
+      backend->successes += 1.0;
+      backend->consecutiveFailures = 0;
+      if ( time != 0 )
+      {
+        backend->latency = ( backend->latency == 0 ) ? time : backend->latency - backend->latency / 8 + time / 8;
+      }
+
+      if ( backend->state == BackendState::HalfOpen && ++backend->probeSuccesses >= _outliers.halfOpenRequests )
+      {
+        INFO_STREAM( "Stewardess::LoadBalancer" ) << "Restored connection " << id;
+        backend->state = BackendState::Healthy;
+        backend->ejections = 0;
+      }
+      return;
+    }
+
+    backend->failures += 1.0;
+    backend->consecutiveFailures += 1;
+
+    if ( backend->state == BackendState::HalfOpen )
+    {
+      this->_eject( *backend, now, "failed while half open" );
+      return;
+    }
+    if ( backend->state != BackendState::Healthy ) return;
+
+    if ( _outliers.consecutiveFailures != 0 && backend->consecutiveFailures >= _outliers.consecutiveFailures )
+    {
+      this->_eject( *backend, now, "too many failures in a row" );
+      return;
+    }
+
+    // Halving the counts after each check keeps the rate recent
+    double total = backend->successes + backend->failures;
+    if ( _outliers.errorRate > 0.0 && _outliers.minimumRequests != 0 && total >= _outliers.minimumRequests )
+    {
+      if ( backend->failures >= _outliers.errorRate * total )
+      {
+        this->_eject( *backend, now, "error rate too high" );
+        return;
+      }
+      backend->successes /= 2.0;
+      backend->failures /= 2.0;
+    }
+  }
+
+
+  void LoadBalancer::_eject( Backend& backend, std::chrono::steady_clock::time_point now, const char* reason )
+  {
+    // Never eject so many that the rest are swamped. A half open connection is already counted
+    if ( backend.state == BackendState::Healthy )
+    {
+      size_t ejected = 0;
+      for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+      {
+        if ( it->state != BackendState::Healthy ) ejected += 1;
+      }
+      if ( ejected + 1 > _outliers.maxEjectedFraction * _connections.size() )
+      {
+        DEBUG_STREAM( "Stewardess::LoadBalancer" ) << "Not ejecting connection " << backend.handle.getConnectionID() << ", too many already ejected";
+        return;
+      }
+    }
+
+    Milliseconds duration = _outliers.baseEjectionTime * ( 1u << std::min( backend.ejections, 16u ) );
+    duration = std::min( duration, _outliers.maxEjectionTime );
+
+    WARN_STREAM( "Stewardess::LoadBalancer" ) << "Ejecting connection " << backend.handle.getConnectionID() << " for " << duration.count() << "ms: " << reason;
+
+    backend.state = BackendState::Ejected;
+    backend.ejectedUntil = now + duration;
+    backend.ejections += 1;
+    backend.successes = 0.0;
+    backend.failures = 0.0;
+    backend.consecutiveFailures = 0;
+    backend.latency = 0;
+    _numberEjections += 1;
+  }
+
+
+  void LoadBalancer::_checkLatency( std::chrono::steady_clock::time_point now )
+  {
+    if ( now - _lastLatencyCheck < std::chrono::seconds( 1 ) ) return;
+    _lastLatencyCheck = now;
+
+    std::vector< uint64_t > latencies;
+    for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      if ( it->state == BackendState::Healthy && it->latency != 0 ) latencies.push_back( it->latency );
+    }
+
+    // A median of fewer than three says nothing about who is slow
+    if ( latencies.size() < 3 ) return;
+
+    std::nth_element( latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end() );
+    double limit = _outliers.latencyFactor * latencies[ latencies.size() / 2 ];
+
+    for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      if ( it->state == BackendState::Healthy && it->latency > limit )
+      {
+        this->_eject( *it, now, "responses too slow" );
+      }
+    }
+  }
+
+
+  void LoadBalancer::reportSuccess( const Handle& handle )
+  {
+    if ( handle ) this->_result( handle.getConnectionID(), true );
+  }
+
+
+  void LoadBalancer::reportFailure( const Handle& handle )
+  {
+    if ( handle ) this->_result( handle.getConnectionID(), false );
+  }
+
+
+  void LoadBalancer::setOutlierDetection( const OutlierSettings& settings )
+  {
+    if ( settings.errorRate < 0.0 || settings.errorRate > 1.0 )
+    {
+      throw Exception( "Outlier error rate must be between 0 and 1" );
+    }
+    if ( settings.maxEjectedFraction < 0.0 || settings.maxEjectedFraction > 1.0 )
+    {
+      throw Exception( "Outlier ejected fraction must be between 0 and 1" );
+    }
+    if ( settings.halfOpenRequests == 0 || settings.baseEjectionTime.count() <= 0 || settings.maxEjectionTime < settings.baseEjectionTime )
+    {
+      throw Exception( "Outlier ejection needs a probe request and a positive ejection time" );
+    }
+
+    GuardLock lk( _mutex );
+    _outlierDetection = true;
+    _outliers = settings;
+  }
+
+
+  void LoadBalancer::disableOutlierDetection()
+  {
+    GuardLock lk( _mutex );
+    _outlierDetection = false;
+    for ( BackendVector::iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      it->state = BackendState::Healthy;
+      it->ejections = 0;
+    }
+  }
+
+
+  void LoadBalancer::setMaxOutstanding( size_t maximum )
+  {
+    GuardLock lk( _mutex );
+    _maxOutstanding = maximum;
+  }
+
+
+  void LoadBalancer::setHedging( double percentile, double budget )
+  {
+    if ( percentile <= 0.0 || percentile > 1.0 )
+    {
+      throw Exception( "Hedging percentile must be between 0 and 1" );
+    }
+    if ( budget < 0.0 || budget > 1.0 )
+    {
+      throw Exception( "Hedging budget must be between 0 and 1" );
+    }
+
+    GuardLock lk( _mutex );
+    _hedgePercentile = percentile;
+    _hedgeBudget = budget;
+    _hedgeTokens = std::min( _hedgeTokens, MaxHedgeTokens * budget );
+    _newSamples = SampleInterval;
+  }
+
+
+  Microseconds LoadBalancer::getHedgeDelay() const
+  {
+    GuardLock lk( _mutex );
+    return _hedgeDelay;
+  }
+
+
+  uint64_t LoadBalancer::getNumberRequests() const
+  {
+    GuardLock lk( _mutex );
+    return _numberRequests;
+  }
+
+
+  uint64_t LoadBalancer::getNumberHedges() const
+  {
+    GuardLock lk( _mutex );
+    return _numberHedges;
+  }
+
+
+  uint64_t LoadBalancer::getNumberHedgeWins() const
+  {
+    GuardLock lk( _mutex );
+    return _numberHedgeWins;
+  }
+
+
+  uint64_t LoadBalancer::getNumberEjections() const
+  {
+    GuardLock lk( _mutex );
+    return _numberEjections;
+  }
+
+
+  uint64_t LoadBalancer::getNumberRejected() const
+  {
+    GuardLock lk( _mutex );
+    return _numberRejected;
+  }
+
+
+  size_t LoadBalancer::getNumberEjected() const
+  {
+    GuardLock lk( _mutex );
+    size_t ejected = 0;
+    for ( BackendVector::const_iterator it = _connections.begin(); it != _connections.end(); ++it )
+    {
+      if ( it->state != BackendState::Healthy ) ejected += 1;
+    }
+    return ejected;
+  }
+
+}
+
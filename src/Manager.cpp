@@ -4,6 +4,7 @@
 #include "EventCallbacks.h"
 #include "WorkerThread.h"
 #include "Connection.h"
+#include "Coroutine.h"
 #include "Exception.h"
 
 #include <signal.h>
@@ -106,10 +107,67 @@ namespace Stewardess
   }
 
 
-  void Manager::requestConnectTo( std::string host, std::string port, UniqueID id )
+  std::future< Handle > Manager::requestConnectTo( std::string host, std::string port, UniqueID id )
   {
     DEBUG_STREAM( "Manager::RequestConnection" ) << "Requesting connection to : " << host << " : " << port << ". ID = " << id;
-    _impl->requestConnectTo( host, port, id );
+
+    // The callback has to be copyable, so the promise is shared
+    std::shared_ptr< std::promise< Handle > > promise = std::make_shared< std::promise< Handle > >();
+    std::future< Handle > result = promise->get_future();
+    _impl->requestConnectTo( host, port, id, [promise]( Handle handle ) { promise->set_value( std::move( handle ) ); } );
+    return result;
+  }
+
+
+  void Manager::requestConnectTo( std::string host, std::string port, ConnectCallback callback, UniqueID id )
+  {
+    DEBUG_STREAM( "Manager::RequestConnection" ) << "Requesting connection to : " << host << " : " << port << ". ID = " << id;
+    _impl->requestConnectTo( host, port, id, std::move( callback ) );
+  }
+
+
+  ConnectAwaitable Manager::connect( std::string host, std::string port, UniqueID id )
+  {
+    return ConnectAwaitable( _impl, std::move( host ), std::move( port ), id );
+  }
+
+
+  SleepAwaitable Manager::sleep( Milliseconds time )
+  {
+    return SleepAwaitable( _impl, time );
+  }
+
+
+  void Manager::leaseConnection( std::string host, std::string port, ConnectCallback callback )
+  {
+    _impl->leaseConnection( host, port, std::move( callback ) );
+  }
+
+
+  std::future< Handle > Manager::leaseConnection( std::string host, std::string port )
+  {
+    std::shared_ptr< std::promise< Handle > > promise = std::make_shared< std::promise< Handle > >();
+    std::future< Handle > result = promise->get_future();
+    _impl->leaseConnection( host, port, [promise]( Handle handle ) { promise->set_value( std::move( handle ) ); } );
+    return result;
+  }
+
+
+  bool Manager::returnConnection( const Handle& handle )
+  {
+    return _impl->returnConnection( handle );
+  }
+
+
+  void Manager::preconnect( std::string host, std::string port )
+  {
+    _impl->preconnect( host, port );
+  }
+
+
+  PoolStatisticsVector Manager::getPoolStatistics() const
+  {
+    return _impl->getPoolStatistics();
   }
 
 
@@ -119,6 +177,42 @@ namespace Stewardess
   }
 
 
+  Handle Manager::findConnection( ConnectionID id ) const
+  {
+    return _impl->findConnection( id );
+  }
+
+
+  CompressionStatistics Manager::getCompressionStatistics() const
+  {
+    return _impl->getCompressionStatistics();
+  }
+
+
+  WorkerLoadVector Manager::getWorkerLoads() const
+  {
+    return _impl->getWorkerLoads();
+  }
+
+
+  bool Manager::migrateConnection( const HandleRef& handle, size_t worker )
+  {
+    return _impl->migrateConnection( handle, worker );
+  }
+
+
+  void Manager::broadcast( const Payload* payload, ConnectionFilter filter )
+  {
+    _impl->broadcast( payload, filter );
+  }
+
+
+  void Manager::broadcast( const Payload* payload, const HandleVector& group )
+  {
+    _impl->broadcast( payload, group );
+  }
+
+
   void Manager::run()
   {
     _impl->run();
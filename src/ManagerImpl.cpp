@@ -5,16 +5,34 @@
 #include "WorkerThread.h"
 #include "Connection.h"
 #include "TimerData.h"
+#include "TimerWheel.h"
 #include "Exception.h"
+#include "Serializer.h"
+#include "FilterChain.h"
+#include "Buffer.h"
+#include "Topology.h"
+#include "ComputeExecutor.h"
+#include "Resolver.h"
+#include "ConnectionPool.h"
 
 #include <signal.h>
+#include <poll.h>
+#include <cerrno>
 #include <cstring>
 #include <cmath>
+#include <random>
+#include <future>
+#include <algorithm>
 
 
 namespace Stewardess
 {
 
+  // How often each worker checks its connections for timeouts, and how late the check may run to share a tick
+  static const Milliseconds TimeoutSweepInterval( 250 );
+  static const Milliseconds TimeoutSweepSlack( 64 );
+
+
   ////////////////////////////////////////////////////////////////////////////////
   // Member functions definitions
 
@@ -22,7 +40,12 @@ namespace Stewardess
     _configuration( config ),
     _server( server ),
     _abort( false ),
-    _connections(),
+    _numberConnections( 0 ),
+    _closedCompressionStatistics(),
+    _resolver( nullptr ),
+    _pool( nullptr ),
+    _executor( nullptr ),
+    _broadcastSerializer( nullptr ),
     _userTimers(),
     _eventBase( nullptr ),
     _listener( nullptr ),
@@ -35,7 +58,8 @@ namespace Stewardess
     _tickTimeStamp(),
     _serverStartTime(),
     _threads(),
-    _nextThread( 0 )
+    _nextThread( 0 ),
+    _controlWorker()
   {
     memset( &_socketAddress, 0, sizeof( _socketAddress ) );
   }
@@ -48,37 +72,108 @@ namespace Stewardess
 
   void ManagerImpl::_cleanup()
   {
+    // Join all the worker threads. Nothing can touch the connections from a worker loop after this
+    INFO_LOG( "Stewardess::Manager", "Joining worker threads" );
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
     {
-      GuardLock lk( _connectionsMutex );
-      // Delete all the outstanding connections
-      for (ConnectionMap::iterator it = _connections.begin(); it != _connections.end(); ++it )
+      if ( (*it)->theThread.joinable() )
       {
-        delete it->second;
+        (*it)->theThread.join();
       }
-      _connections.clear();
     }
 
+    // Finish the running callbacks before the connections go
+    if ( _executor )
+    {
+      delete _executor;
+      _executor = nullptr;
+    }
+
+    // Jobs still queued hold handles and expect their connections to exist
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      drainWorkerJobs( &(*it)->data );
+    }
+    drainWorkerJobs( &_controlWorker );
+
+    // The pool's handles must go before the connections
+    if ( _pool )
+    {
+      delete _pool;
+      _pool = nullptr;
+    }
+
+    // Abandon any connects still waiting. Their events belong to the worker bases
+    {
+      GuardLock lk( _pendingConnectsMutex );
+      for ( std::unordered_set< PendingConnect* >::iterator it = _pendingConnects.begin(); it != _pendingConnects.end(); ++it )
+      {
+        event_free( (*it)->connectEvent );
+        EVUTIL_CLOSESOCKET( (*it)->socket );
+        delete (*it);
+      }
+      _pendingConnects.clear();
+    }
+
+
+    // Delete all the outstanding connections, wherever they migrated to
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      if ( (*it)->data.connectionSlab ) (*it)->data.connectionSlab->clear();
+    }
+    if ( _controlWorker.connectionSlab ) _controlWorker.connectionSlab->clear();
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      GuardLock lk( (*it)->data.connectionTableMutex );
+      (*it)->data.connectionTable.clear();
+    }
+    {
+      GuardLock lk( _controlWorker.connectionTableMutex );
+      _controlWorker.connectionTable.clear();
+    }
+    _numberConnections = 0;
+
 
-    // Join all the worker threads.
-    INFO_LOG( "Stewardess::Manager", "Joining worker threads" );
     for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
     {
-      (*it)->theThread.join();
+      if ( (*it)->data.jobEvent )
+      {
+        event_free( (*it)->data.jobEvent );
+      }
+      closeWorkerInbox( &(*it)->data );
+      delete (*it)->data.timers;
+      delete (*it)->data.connectionSlab;
+      if ( (*it)->data.listener )
+      {
+        evconnlistener_free( (*it)->data.listener );
+      }
       event_base_free( (*it)->data.eventBase );
       delete (*it);
     }
     _threads.clear();
 
 
-    // Clear all the user timers
-    for ( TimerMap::iterator it = _userTimers.begin(); it != _userTimers.end(); ++it )
+    if ( _broadcastSerializer )
     {
-      event_free( it->second->theEvent );
-      delete it->second;
+      delete _broadcastSerializer;
+      _broadcastSerializer = nullptr;
     }
+
+
+    // Clear all the user timers. The control wheel forgets them when it goes
     _userTimers.clear();
 
 
+    if ( _controlWorker.jobEvent )
+    {
+      event_free( _controlWorker.jobEvent );
+    }
+    closeWorkerInbox( &_controlWorker );
+    delete _controlWorker.timers;
+    _controlWorker.timers = nullptr;
+    delete _controlWorker.connectionSlab;
+    _controlWorker.connectionSlab = nullptr;
+    setCurrentWorker( nullptr );
     if ( _deathEvent )
     {
       event_free( _deathEvent );
@@ -87,6 +182,11 @@ namespace Stewardess
     {
       event_free( _connectorEvent );
     }
+    if ( _resolver )
+    {
+      delete _resolver;
+      _resolver = nullptr;
+    }
     if ( _tickEvent )
     {
       event_free( _tickEvent );
@@ -142,6 +242,21 @@ namespace Stewardess
       }
 
 
+      // The control thread handles connections itself if there are no workers
+      _controlWorker.manager = this;
+      _controlWorker.eventBase = _eventBase;
+      _controlWorker.jobEvent = evtimer_new( _eventBase, workerJobCB, (void*)&_controlWorker );
+      if ( _controlWorker.jobEvent == nullptr )
+      {
+        throw Exception( "Could not create the control job event." );
+      }
+      openWorkerInbox( &_controlWorker );
+      _controlWorker.timers = new TimerWheel( &_controlWorker );
+      _controlWorker.connectionSlab = new ConnectionSlab( 0 );
+      setCurrentWorker( &_controlWorker );
+      this->startTimeoutSweep( &_controlWorker );
+
+
       // Create an event to force shutdown, but don't enable it
       _deathEvent = evtimer_new( _eventBase, killTimerCB, (void*)this );
       if ( _deathEvent == nullptr )
@@ -159,6 +274,12 @@ namespace Stewardess
       }
       // event_add( _connectorEvent, &immediately );
 
+      // Resolver for the connection requests
+      _resolver = new Resolver( _eventBase, _configuration );
+
+      // Pool of reusable outbound connections
+      _pool = new ConnectionPool( *this, _configuration );
+
 
       // Create a tick event
       _tickEvent = evtimer_new( _eventBase, tickTimerCB, (void*)this );
@@ -181,8 +302,9 @@ namespace Stewardess
       }
 
 
-      // Build a listener if wanted
-      if ( _configuration.requestListener )
+      // Build a listener on the control thread if wanted. Workers make their own if they can
+      bool worker_listeners = _configuration.requestListener && _configuration.reusePortListeners && _configuration.numThreads > 0;
+      if ( _configuration.requestListener && ! worker_listeners )
       {
         INFO_STREAM( "Stewardess::Manager" ) << "Configuring listener on port " << _configuration.portNumber;
         _listener = evconnlistener_new_bind( _eventBase, listenerAcceptCB, (void*)this,
@@ -196,21 +318,68 @@ namespace Stewardess
       }
 
 
+      // Create the compute pool
+      if ( _configuration.numComputeThreads > 0 )
+      {
+        INFO_STREAM( "Stewardess::Manager" ) << "Starting " << _configuration.numComputeThreads << " compute threads.";
+        _executor = new ComputeExecutor( _configuration.numComputeThreads );
+      }
+
+
       // Create the worker threads
       INFO_LOG( "Stewardess::Manager", "Intialising worker threads." );
       for ( unsigned int i = 0; i < _configuration.numThreads; ++i )
       {
         ThreadInfo* info = new ThreadInfo();
+        info->data.manager = this;
+        info->data.connectionSlab = nullptr;
         info->data.tickTime = _configuration.workerTickTime;
+        info->data.sampleTime = std::chrono::steady_clock::now();
+        info->data.numaNode = -1;
 
         info->data.eventBase = event_base_new();
         if ( info->data.eventBase == nullptr )
         {
+          delete info;
           throw Exception( "Could not create a worker event base. Unknown error." );
         }
-
-        info->theThread = std::thread( workerThread, info->data );
         _threads.push_back( info );
+
+        info->data.jobEvent = evtimer_new( info->data.eventBase, workerJobCB, (void*)&info->data );
+        if ( info->data.jobEvent == nullptr )
+        {
+          throw Exception( "Could not create a worker job event." );
+        }
+        openWorkerInbox( &info->data );
+        info->data.timers = new TimerWheel( &info->data );
+        info->data.connectionSlab = new ConnectionSlab( i + 1 );
+        this->startTimeoutSweep( &info->data );
+      }
+
+      // Listeners must exist before the workers start looping
+      if ( worker_listeners )
+      {
+        this->createWorkerListeners();
+      }
+
+      CPUSet control_cpus = this->assignAffinity();
+
+      for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+      {
+        (*it)->theThread = std::thread( workerThread, &(*it)->data );
+      }
+
+      // Pinned after the workers start, otherwise they would inherit it
+      if ( ! control_cpus.empty() )
+      {
+        if ( pinThread( pthread_self(), control_cpus ) )
+        {
+          INFO_STREAM( "Stewardess::Manager" ) << "Control thread CPUs: " << formatCPUList( control_cpus );
+        }
+        else
+        {
+          WARN_STREAM( "Stewardess::Manager" ) << "Could not pin control thread to CPUs " << formatCPUList( control_cpus );
+        }
       }
 
 
@@ -220,6 +389,12 @@ namespace Stewardess
       // Start the libevent loop using the base event
       INFO_LOG( "Stewardess::Manager", "Operation start." );
 
+      // Warm up the configured endpoints
+      for ( std::vector< std::pair< std::string, std::string > >::const_iterator it = _configuration.poolEndpoints.begin(); it != _configuration.poolEndpoints.end(); ++it )
+      {
+        _pool->preconnect( it->first, it->second );
+      }
+
       _server.onStart();
       if ( ! _abort )
       {
@@ -253,6 +428,13 @@ namespace Stewardess
       // Disable the listener
       evconnlistener_disable( _listener );
     }
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      if ( (*it)->data.listener != nullptr )
+      {
+        evconnlistener_disable( (*it)->data.listener );
+      }
+    }
 
     // Disable the signal event. If someone sends it twice we just die.
     if ( _signalEvent != nullptr )
@@ -277,6 +459,13 @@ namespace Stewardess
     {
       evconnlistener_disable( _listener );
     }
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      if ( (*it)->data.listener != nullptr )
+      {
+        evconnlistener_disable( (*it)->data.listener );
+      }
+    }
 
     // Disable the signal event. If someone sends it twice we just die.
     if ( _signalEvent != nullptr )
@@ -298,99 +487,258 @@ namespace Stewardess
 
   Handle ManagerImpl::connectTo( std::string host, std::string port, UniqueID id )
   {
-    // Find the server address
-    evutil_addrinfo address_hints;
-    evutil_addrinfo* address_answer = nullptr;
+    sockaddr_storage address;
+    const char* error = nullptr;
+    evutil_socket_t new_socket = -1;
+    if ( this->resolveNow( host, port, address, error ) )
+    {
+      new_socket = this->beginConnect( address, error );
+    }
+    if ( new_socket < 0 )
+    {
+      ERROR_STREAM( "Stewardess::Manager" ) << error << ": " << host << ":" << port;
+      return Handle();
+    }
 
-    memset( &address_hints, 0, sizeof( address_hints ) );
-    address_hints.ai_family = AF_UNSPEC;
-    address_hints.ai_socktype = SOCK_STREAM;
-    address_hints.ai_protocol = IPPROTO_TCP;
-    address_hints.ai_flags = EVUTIL_AI_ADDRCONFIG;
+    // Still blocks the caller, but never for longer than the connect timeout
+    const timeval* timeout = this->getConnectTimeout();
+    pollfd poll_data = { new_socket, POLLOUT, 0 };
+    int ready = poll( &poll_data, 1, ( timeout == nullptr ) ? -1 : ( timeout->tv_sec * 1000 + timeout->tv_usec / 1000 ) );
 
+    int socket_error = ETIMEDOUT;
+    if ( ready > 0 )
+    {
+      socklen_t length = sizeof( socket_error );
+      if ( getsockopt( new_socket, SOL_SOCKET, SO_ERROR, &socket_error, &length ) != 0 )
+      {
+        socket_error = errno;
+      }
+    }
+    else if ( ready < 0 )
+    {
+      socket_error = errno;
+    }
 
-    // Resolve the hostname
-    int result = evutil_getaddrinfo( host.c_str(), port.c_str(), &address_hints, &address_answer );
-    if ( result != 0 )
+    if ( socket_error != 0 )
     {
-      ERROR_STREAM( "Stewardess::Manager" ) << "Could not resolve hostname: " << host;
+      EVUTIL_CLOSESOCKET( new_socket );
+      ERROR_STREAM( "Stewardess::Manager" ) << "Failed to connect to server " << host << ":" << port << ". Error: " << std::strerror( socket_error );
       return Handle();
     }
 
-    // Request a socket
-    evutil_socket_t new_socket = socket( address_answer->ai_family, address_answer->ai_socktype, address_answer->ai_protocol );
-    if ( new_socket < 0 )
+    WorkerData* worker = this->getNextWorker( id, (sockaddr*)&address );
+
+    // Create the connection 
+    Connection* connection = this->createConnection( *(sockaddr*)&address, worker, new_socket );
+    connection->setIdentifier( id );
+    connection->bufferSize =  _configuration.bufferSize;
+
+    // Add the new connection to the manager
+    this->addConnection( connection );
+
+    // We don't call this function as this is not executed asynchronously - the user knows immediately
+//    // Signal that something has connected
+//    _server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
+
+    // Return the handle
+    return connection->requestHandle();
+  }
+
+
+  bool ManagerImpl::resolveNow( const std::string& host, const std::string& port, sockaddr_storage& address, const char*& error )
+  {
+    AddressVector addresses;
+    if ( _resolver != nullptr && ! _resolver->lookup( host, addresses ) && getCurrentWorker() != &_controlWorker )
     {
-      while( address_answer != nullptr )
+      // Not cached. Let the control thread resolve it and wait for the answer
+      std::shared_ptr< std::promise< AddressVector > > promise = std::make_shared< std::promise< AddressVector > >();
+      std::future< AddressVector > answer = promise->get_future();
+      postWorkerJob( &_controlWorker, [this, host, promise]()
+      {
+        _resolver->resolve( host, [promise]( const AddressVector& result ) { promise->set_value( result ); } );
+      } );
+      try
       {
-        evutil_addrinfo* temp = address_answer->ai_next;
-        free( address_answer );
-        address_answer = temp;
+        addresses = answer.get();
+      }
+      catch ( std::future_error& )
+      {
+        // Shut down before the job ran
+        addresses.clear();
       }
-      ERROR_LOG( "Stewardess::Manager", "Failed to create a socket" );
-      return Handle();
     }
-
-    // Try to connect to the remote host
-    INFO_STREAM( "Stewardess::Manager" ) << "Connecting to host: " << host;
-    if ( connect( new_socket, address_answer->ai_addr, address_answer->ai_addrlen ) )
+    else if ( _resolver == nullptr || addresses.empty() )
     {
-      EVUTIL_CLOSESOCKET( new_socket );
-      while( address_answer != nullptr )
+      // Not running, or on the control thread where waiting would deadlock
+      evutil_addrinfo address_hints;
+      evutil_addrinfo* address_answer = nullptr;
+
+      memset( &address_hints, 0, sizeof( address_hints ) );
+      address_hints.ai_family = AF_UNSPEC;
+      address_hints.ai_socktype = SOCK_STREAM;
+      address_hints.ai_protocol = IPPROTO_TCP;
+      address_hints.ai_flags = EVUTIL_AI_ADDRCONFIG;
+
+      if ( evutil_getaddrinfo( host.c_str(), nullptr, &address_hints, &address_answer ) == 0 )
       {
-        evutil_addrinfo* temp = address_answer->ai_next;
-        free( address_answer );
-        address_answer = temp;
+        sockaddr_storage found;
+        memset( &found, 0, sizeof( found ) );
+        memcpy( &found, address_answer->ai_addr, address_answer->ai_addrlen );
+        addresses.push_back( found );
+        evutil_freeaddrinfo( address_answer );
       }
-      ERROR_STREAM( "Stewardess::Manager" ) << "Failed to connect to server " << host << ":" << port;
-      return Handle();
     }
 
-    // Make the socket non-blocking
+    if ( addresses.empty() )
+    {
+      error = "Could not resolve hostname";
+      return false;
+    }
+
+    address = addresses.front();
+    if ( ! Resolver::setPort( address, port ) )
+    {
+      error = "Unknown port";
+      return false;
+    }
+    return true;
+  }
+
+
+  evutil_socket_t ManagerImpl::beginConnect( const sockaddr_storage& address, const char*& error )
+  {
+    socklen_t address_length = ( address.ss_family == AF_INET6 ) ? sizeof( sockaddr_in6 ) : sizeof( sockaddr_in );
+
+    // Request a socket
+    evutil_socket_t new_socket = socket( address.ss_family, SOCK_STREAM, IPPROTO_TCP );
+    if ( new_socket < 0 )
+    {
+      error = "Could not create socket";
+      return -1;
+    }
+
+    // Make the socket non-blocking before connecting, so the caller decides how to wait
     evutil_make_socket_nonblocking( new_socket );
 
-    event_base* worker_base;
-    if ( _threads.size() == 0 )
+    if ( connect( new_socket, (const sockaddr*)&address, address_length ) != 0 && errno != EINPROGRESS )
+    {
+      EVUTIL_CLOSESOCKET( new_socket );
+      error = "Failed to connect to server";
+      return -1;
+    }
+
+    return new_socket;
+  }
+
+
+  void ManagerImpl::startConnect( ConnectionRequest&& request )
+  {
+    // Answered straight away if the name is cached, otherwise when DNS replies
+    std::shared_ptr< ConnectionRequest > shared = std::make_shared< ConnectionRequest >( std::move( request ) );
+    _resolver->resolve( shared->address, [this, shared]( const AddressVector& addresses )
+    {
+      this->connectResolved( std::move( *shared ), addresses );
+    } );
+  }
+
+
+  void ManagerImpl::connectResolved( ConnectionRequest&& request, const AddressVector& addresses )
+  {
+    PendingConnect* pending = new PendingConnect();
+    pending->manager = this;
+    pending->request = std::move( request );
+    pending->connectEvent = nullptr;
+
+    const char* error = nullptr;
+    pending->socket = -1;
+    if ( addresses.empty() )
     {
-      worker_base = _eventBase;
+      error = "Could not resolve hostname";
     }
     else
     {
-      worker_base = _threads[ this->getNextThread() ]->data.eventBase;
+      pending->address = addresses.front();
+      if ( ! Resolver::setPort( pending->address, pending->request.port ) )
+        error = "Unknown port";
+      else
+        pending->socket = this->beginConnect( pending->address, error );
     }
 
-    // Create the connection 
-    Connection* connection = new Connection( *address_answer->ai_addr, *this, worker_base, new_socket );
-    connection->setIdentifier( id );
-    connection->bufferSize =  _configuration.bufferSize;
+    if ( pending->socket < 0 )
+    {
+      ERROR_STREAM( "Stewardess::Manager" ) << error << ": " << pending->request.address << ":" << pending->request.port;
+      this->failConnect( pending->request, error );
+      delete pending;
+      return;
+    }
 
+    INFO_STREAM( "Stewardess::Manager" ) << "Connecting to host: " << pending->request.address;
 
-    // Clear the address memory
-    while( address_answer != nullptr )
+    // The worker that will own the connection waits for the handshake, so the control thread never blocks
+    pending->worker = this->getNextWorker( pending->request.uniqueId, (sockaddr*)&pending->address );
+    pending->connectEvent = event_new( pending->worker->eventBase, pending->socket, EV_WRITE, connectCompleteCB, (void*)pending );
+    if ( pending->connectEvent == nullptr )
     {
-      evutil_addrinfo* temp = address_answer->ai_next;
-      free( address_answer );
-      address_answer = temp;
+      EVUTIL_CLOSESOCKET( pending->socket );
+      this->failConnect( pending->request, "Could not create connect event" );
+      delete pending;
+      return;
     }
 
-      
+    {
+      GuardLock lk( _pendingConnectsMutex );
+      _pendingConnects.insert( pending );
+    }
+    event_add( pending->connectEvent, this->getConnectTimeout() );
+  }
+
+
+  void ManagerImpl::finishConnect( PendingConnect* pending, int socket_error )
+  {
+    {
+      GuardLock lk( _pendingConnectsMutex );
+      _pendingConnects.erase( pending );
+    }
+    event_free( pending->connectEvent );
+
+    if ( socket_error != 0 )
+    {
+      EVUTIL_CLOSESOCKET( pending->socket );
+      ERROR_STREAM( "Stewardess::Manager" ) << "Failed to connect to server " << pending->request.address << ":" << pending->request.port << ". Error: " << std::strerror( socket_error );
+      this->failConnect( pending->request, ( socket_error == ETIMEDOUT ) ? "Connection attempt timed out" : "Failed to connect to server" );
+      delete pending;
+      return;
+    }
+
+    // Create the connection 
+    Connection* connection = this->createConnection( *(sockaddr*)&pending->address, pending->worker, pending->socket );
+    connection->setIdentifier( pending->request.uniqueId );
+    connection->bufferSize =  _configuration.bufferSize;
+
+    DEBUG_STREAM( "Stewardess::RequestConnection" ) << "Connected to " << pending->request.address << " : " << pending->request.port;
+
     // Add the new connection to the manager
     this->addConnection( connection );
 
-    // We don't call this function as this is not executed asynchronously - the user knows immediately
-//    // Signal that something has connected
-//    _server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
+    // Signal that something has connected
+    _server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
 
-    // Return the handle
-    return connection->requestHandle();
+    if ( pending->request.callback ) pending->request.callback( connection->requestHandle() );
+    delete pending;
   }
 
 
+  void ManagerImpl::failConnect( const ConnectionRequest& request, const char* error )
+  {
+    _server.onEvent( ServerEvent::RequestConnectFail, error );
+    if ( request.callback ) request.callback( Handle() );
+  }
 
-  void ManagerImpl::requestConnectTo( std::string address, std::string port, UniqueID uid )
+
+  void ManagerImpl::requestConnectTo( std::string address, std::string port, UniqueID uid, ConnectCallback callback )
   {
     // Create the request
-    ConnectionRequest request = { address, port, uid };
+    ConnectionRequest request = { address, port, uid, std::move( callback ) };
 
     // Push it to the vector
     GuardLock lk( _connectionRequestsMutex );
@@ -402,10 +750,112 @@ namespace Stewardess
 
 
 
+  void ManagerImpl::leaseConnection( std::string host, std::string port, ConnectCallback callback )
+  {
+    if ( _pool == nullptr )
+    {
+      throw Exception( "Connections can only be leased while the manager is running." );
+    }
+    _pool->lease( host, port, std::move( callback ) );
+  }
+
+
+  bool ManagerImpl::returnConnection( const Handle& handle )
+  {
+    if ( _pool == nullptr || ! handle )
+    {
+      return false;
+    }
+    return _pool->release( handle );
+  }
+
+
+  void ManagerImpl::preconnect( std::string host, std::string port )
+  {
+    if ( _pool == nullptr )
+    {
+      throw Exception( "Connections can only be pooled while the manager is running." );
+    }
+    _pool->preconnect( host, port );
+  }
+
+
+  PoolStatisticsVector ManagerImpl::getPoolStatistics() const
+  {
+    if ( _pool == nullptr )
+    {
+      return PoolStatisticsVector();
+    }
+    return _pool->getStatistics();
+  }
+
+
   size_t ManagerImpl::getNumberConnections() const
   {
-    GuardLock lk( _connectionsMutex );
-    return _connections.size();
+    return _numberConnections.load( std::memory_order_relaxed );
+  }
+
+
+  Handle ManagerImpl::findConnection( ConnectionID id ) const
+  {
+    ConnectionSlab* slab = this->getConnectionSlab( id );
+    if ( slab == nullptr )
+      return Handle();
+
+    return slab->acquire( id );
+  }
+
+
+  CompressionStatistics ManagerImpl::getCompressionStatistics() const
+  {
+    CompressionStatistics stats;
+    {
+      GuardLock lk( _closedCompressionStatisticsMutex );
+      stats = _closedCompressionStatistics;
+    }
+
+    this->forEachConnection( [&stats]( Connection* connection ) { stats += connection->getCompressionStatistics(); } );
+
+    return stats;
+  }
+
+
+  void ManagerImpl::broadcast( const Payload* payload, ConnectionFilter filter )
+  {
+    SharedBuffer buffer = this->serializeShared( payload );
+    std::unordered_map< WorkerData*, HandleVector > batches;
+
+    // Closing connections leave the shard with its lock held, so the handles are taken from live ones
+    this->forEachConnection( [&batches, &filter]( Connection* connection )
+    {
+      if ( ! connection->isOpen() ) return;
+
+      Handle handle = connection->requestHandle();
+      if ( filter && ! filter( handle ) ) return;
+
+      // The handle keeps it until the worker has queued the buffer
+      batches[ connection->getWorker() ].push_back( std::move( handle ) );
+    } );
+
+    this->dispatchBroadcast( buffer, batches );
+  }
+
+
+  void ManagerImpl::broadcast( const Payload* payload, const HandleVector& group )
+  {
+    SharedBuffer buffer = this->serializeShared( payload );
+    std::unordered_map< WorkerData*, HandleVector > batches;
+
+    for ( HandleVector::const_iterator it = group.begin(); it != group.end(); ++it )
+    {
+      Connection* connection = it->_connection;
+      if ( connection == nullptr || ! connection->isOpen() ) continue;
+
+      // The copy keeps it until the worker has queued the buffer
+      batches[ connection->getWorker() ].push_back( *it );
+    }
+
+    this->dispatchBroadcast( buffer, batches );
   }
 
 
@@ -414,15 +864,326 @@ namespace Stewardess
 
   size_t ManagerImpl::getNextThread()
   {
-    GuardLock lk( _nextThreadMutex );
+    return _nextThread.fetch_add( 1, std::memory_order_relaxed ) % _threads.size();
+  }
+
+
+  WorkerData* ManagerImpl::getNextWorker( UniqueID id, const sockaddr* address )
+  {
+    size_t number = _threads.size();
+    if ( number == 0 )
+    {
+      return &_controlWorker;
+    }
+
+    switch ( _configuration.placementPolicy )
+    {
+      case PlacementPolicy::FewestConnections :
+        {
+          WorkerData* best = &_threads[0]->data;
+          for ( size_t i = 1; i < number; ++i )
+          {
+            if ( _threads[i]->data.connections.load( std::memory_order_relaxed ) < best->connections.load( std::memory_order_relaxed ) )
+              best = &_threads[i]->data;
+          }
+          return best;
+        }
+
+      case PlacementPolicy::LowestUtilization :
+        {
+          // Ties are common when idle, so start from the round-robin choice
+          size_t start = this->getNextThread();
+          WorkerData* best = &_threads[ start ]->data;
+          for ( size_t i = 1; i < number; ++i )
+          {
+            WorkerData* worker = &_threads[ ( start + i ) % number ]->data;
+            if ( worker->utilization.load( std::memory_order_relaxed ) < best->utilization.load( std::memory_order_relaxed ) )
+              best = worker;
+          }
+          return best;
+        }
+
+      case PlacementPolicy::PowerOfTwoChoices :
+        {
+          thread_local std::minstd_rand generator( std::hash< std::thread::id >()( std::this_thread::get_id() ) );
+          WorkerData* first = &_threads[ generator() % number ]->data;
+          WorkerData* second = &_threads[ generator() % number ]->data;
+          return ( second->connections.load( std::memory_order_relaxed ) < first->connections.load( std::memory_order_relaxed ) ) ? second : first;
+        }
+
+      case PlacementPolicy::IdentifierHash :
+        {
+          size_t hash;
+          if ( id != 0 )
+          {
+            hash = std::hash< UniqueID >()( id );
+          }
+          else if ( address != nullptr && address->sa_family == AF_INET )
+          {
+            hash = std::hash< uint32_t >()( ((const sockaddr_in*)address)->sin_addr.s_addr );
+          }
+          else if ( address != nullptr && address->sa_family == AF_INET6 )
+          {
+            const sockaddr_in6* address6 = (const sockaddr_in6*)address;
+            hash = std::hash< std::string >()( std::string( (const char*)&address6->sin6_addr, sizeof( address6->sin6_addr ) ) );
+          }
+          else
+          {
+            return &_threads[ this->getNextThread() ]->data;
+          }
+          return &_threads[ hash % number ]->data;
+        }
+
+      case PlacementPolicy::RoundRobin :
+      default :
+        return &_threads[ this->getNextThread() ]->data;
+    }
+  }
+
+
+  void ManagerImpl::updateWorkerLoads()
+  {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      WorkerData& worker = (*it)->data;
+      uint64_t busy = worker.busyTime.load( std::memory_order_relaxed );
+      int64_t elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >( now - worker.sampleTime ).count();
+
+      if ( elapsed > 0 )
+      {
+        // Utilization is stored in parts per thousand, smoothed over a few samples
+        unsigned sample = std::min< uint64_t >( 1000, ( busy - worker.sampleBusyTime ) * 1000 / elapsed );
+        unsigned previous = worker.utilization.load( std::memory_order_relaxed );
+        worker.utilization.store( ( previous * 3 + sample ) / 4, std::memory_order_relaxed );
+      }
+
+      worker.sampleBusyDelta = busy - worker.sampleBusyTime;
+      worker.sampleBusyTime = busy;
+      worker.sampleTime = now;
+    }
+  }
+
+
+  void ManagerImpl::rebalanceWorkers()
+  {
+    if ( _configuration.rebalanceThreshold <= 0.0 || _threads.size() < 2 )
+      return;
+
+    WorkerData* busiest = &_threads[0]->data;
+    WorkerData* idlest = &_threads[0]->data;
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      WorkerData* worker = &(*it)->data;
+      if ( worker->utilization.load( std::memory_order_relaxed ) > busiest->utilization.load( std::memory_order_relaxed ) )
+        busiest = worker;
+      if ( worker->utilization.load( std::memory_order_relaxed ) < idlest->utilization.load( std::memory_order_relaxed ) )
+        idlest = worker;
+    }
+
+    double difference = ( busiest->utilization.load( std::memory_order_relaxed ) - idlest->utilization.load( std::memory_order_relaxed ) ) * 1.0E-3;
+
+    // Moving more than half the difference would just swap which worker is busiest
+    uint64_t limit = 0;
+    if ( difference >= _configuration.rebalanceThreshold && busiest->sampleBusyDelta > idlest->sampleBusyDelta )
+      limit = ( busiest->sampleBusyDelta - idlest->sampleBusyDelta ) / 2;
+
+    // Pick the hottest connection on the busiest worker that fits
+    Handle candidate;
+    uint64_t candidate_time = 0;
+    this->forEachConnection( [&]( Connection* connection )
+    {
+      uint64_t busy = connection->getBusyTime();
+      uint64_t delta = busy - connection->_sampleBusyTime;
+      connection->_sampleBusyTime = busy;
+
+      if ( connection->getWorker() == busiest && delta <= limit && delta > candidate_time )
+      {
+        Handle handle = connection->requestHandle();
+        if ( handle )
+        {
+          candidate = handle;
+          candidate_time = delta;
+        }
+      }
+    } );
+
+    if ( candidate )
+    {
+      INFO_STREAM( "Stewardess::Manager" ) << "Rebalancing connection " << candidate._connection->getConnectionID() << ". Worker utilization difference: " << difference;
+      candidate._connection->migrate( idlest );
+    }
+  }
+
+
+  bool ManagerImpl::migrateConnection( const HandleRef& handle, size_t worker )
+  {
+    if ( ! handle || worker >= _threads.size() )
+      return false;
+
+    return handle._connection->migrate( &_threads[ worker ]->data );
+  }
+
+
+  WorkerLoadVector ManagerImpl::getWorkerLoads() const
+  {
+    WorkerLoadVector loads;
+    for ( ThreadVector::const_iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      loads.push_back( { (*it)->data.connections.load( std::memory_order_relaxed ), (*it)->data.utilization.load( std::memory_order_relaxed ) * 1.0E-3 } );
+    }
+    return loads;
+  }
+
+
+  void ManagerImpl::acceptConnection( WorkerData* worker, evutil_socket_t new_socket, sockaddr* address )
+  {
+    // Create the connection 
+    Connection* connection = this->createConnection( *address, worker, new_socket );
+    connection->bufferSize = _configuration.bufferSize;
+
+    // Add the new connection to the manager
+    this->addConnection( connection );
+
+    // Signal that something has connected
+    _server.onConnectionEvent( connection->requestHandle(), ConnectionEvent::Connect );
+  }
+
+
+  void ManagerImpl::createWorkerListeners()
+  {
+    INFO_STREAM( "Stewardess::Manager" ) << "Configuring " << _threads.size() << " worker listeners on port " << _configuration.portNumber;
+
+    for ( ThreadVector::iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      // Thread safe so the control thread can disable them during shutdown
+      WorkerData* worker = &(*it)->data;
+      worker->listener = evconnlistener_new_bind( worker->eventBase, workerAcceptCB, (void*)worker,
+                                                  LEV_OPT_CLOSE_ON_FREE|LEV_OPT_REUSEABLE|LEV_OPT_REUSEABLE_PORT|LEV_OPT_THREADSAFE, -1,
+                                                  (sockaddr*)&_socketAddress, sizeof(_socketAddress) );
+      if ( worker->listener == nullptr )
+      {
+        throw Exception( "Could not bind a SO_REUSEPORT listener to the requested socket." );
+      }
+      evconnlistener_set_error_cb( worker->listener, workerListenerErrorCB );
+    }
+  }
+
+
+  CPUSet ManagerImpl::assignAffinity()
+  {
+    bool automatic = _configuration.pinThreads;
+    bool explicit_sets = ! _configuration.controlCPUs.empty();
+    for ( std::vector< CPUSet >::const_iterator it = _configuration.workerCPUs.begin(); it != _configuration.workerCPUs.end(); ++it )
+    {
+      explicit_sets = explicit_sets || ! it->empty();
+    }
+    if ( ! automatic && ! explicit_sets ) return CPUSet();
+
+    Topology topology = Topology::detect();
+    INFO_STREAM( "Stewardess::Manager" ) << "Detected " << topology.online.size() << " CPUs, " << topology.nodes.size() << " NUMA nodes, isolated: " << formatCPUList( topology.isolated );
+
+    CPUSet isolated = _configuration.useIsolatedCPUs ? topology.isolated : CPUSet();
+    bool multi_node = topology.nodes.size() > 1;
+
+    // Automatic worker CPUs: one each, spread over the nodes in turn. Isolated CPUs are used if asked for
+    std::vector< CPUSet > node_cpus;
+    for ( NUMANodeVector::const_iterator it = topology.nodes.begin(); it != topology.nodes.end(); ++it )
+    {
+      CPUSet cpus;
+      for ( CPUSet::const_iterator cpu = it->cpus.begin(); cpu != it->cpus.end(); ++cpu )
+      {
+        bool is_isolated = std::find( isolated.begin(), isolated.end(), *cpu ) != isolated.end();
+        if ( isolated.empty() || is_isolated )
+          cpus.push_back( *cpu );
+      }
+      if ( ! cpus.empty() )
+        node_cpus.push_back( cpus );
+    }
+
+    for ( size_t i = 0; i < _threads.size(); ++i )
+    {
+      WorkerData& worker = _threads[i]->data;
+
+      if ( i < _configuration.workerCPUs.size() && ! _configuration.workerCPUs[i].empty() )
+      {
+        worker.cpus = _configuration.workerCPUs[i];
+      }
+      else if ( automatic && ! node_cpus.empty() )
+      {
+        const CPUSet& cpus = node_cpus[ i % node_cpus.size() ];
+        worker.cpus = CPUSet( 1, cpus[ ( i / node_cpus.size() ) % cpus.size() ] );
+      }
+
+      // Memory follows the node the worker runs on, if it is only on one
+      if ( multi_node && ! worker.cpus.empty() )
+      {
+        int node = topology.nodeOf( worker.cpus.front() );
+        bool single_node = true;
+        for ( CPUSet::const_iterator it = worker.cpus.begin(); it != worker.cpus.end(); ++it )
+          single_node = single_node && topology.nodeOf( *it ) == node;
+        worker.numaNode = single_node ? node : -1;
+      }
+
+      INFO_STREAM( "Stewardess::Manager" ) << "Worker " << i << " CPUs: " << formatCPUList( worker.cpus ) << ", NUMA node: " << worker.numaNode;
+    }
+
+    // The control thread keeps off the isolated CPUs
+    CPUSet control = _configuration.controlCPUs;
+    if ( control.empty() && automatic && ! isolated.empty() )
+    {
+      for ( CPUSet::const_iterator it = topology.online.begin(); it != topology.online.end(); ++it )
+      {
+        if ( std::find( isolated.begin(), isolated.end(), *it ) == isolated.end() )
+          control.push_back( *it );
+      }
+    }
+
+    return control;
+  }
+
+
+  SharedBuffer ManagerImpl::serializeShared( const Payload* payload )
+  {
+    Buffer* result = new Buffer( _configuration.bufferSize );
 
-    size_t result = _nextThread++;
-    if ( _nextThread == _threads.size() )
+    GuardLock lk( _broadcastMutex );
+    if ( _broadcastSerializer == nullptr )
     {
-      _nextThread = 0;
+      _broadcastSerializer = _server.buildSerializer();
     }
 
-    return result;
+    _broadcastSerializer->serialize( payload );
+
+    while ( ! _broadcastSerializer->bufferEmpty() )
+    {
+      Buffer* temp = _broadcastSerializer->getBuffer();
+      result->append( std::move( *temp ) );
+      delete temp;
+    }
+
+    while ( ! _broadcastSerializer->errorEmpty() )
+    {
+      ERROR_STREAM( "Stewardess::Broadcast" ) << "Serializer error occured: " << _broadcastSerializer->getError();
+    }
+
+    return SharedBuffer( result );
+  }
+
+
+  void ManagerImpl::dispatchBroadcast( const SharedBuffer& buffer, std::unordered_map< WorkerData*, HandleVector >& batches )
+  {
+    for ( std::unordered_map< WorkerData*, HandleVector >::iterator it = batches.begin(); it != batches.end(); ++it )
+    {
+      postWorkerJob( it->first, [ buffer, handles = std::move( it->second ) ]()
+      {
+        for ( HandleVector::const_iterator handle_it = handles.begin(); handle_it != handles.end(); ++handle_it )
+        {
+          handle_it->_connection->writeShared( buffer );
+        }
+      } );
+    }
   }
 
 
@@ -452,36 +1213,193 @@ namespace Stewardess
   }
 
 
-  timeval* ManagerImpl::getTickTime()
+  const timeval* ManagerImpl::getIdleTimeout() const
+  {
+    if ( _configuration.idleTimeout.tv_sec == 0 )
+    {
+      return nullptr;
+    }
+    else
+    {
+      return &_configuration.idleTimeout;
+    }
+  }
+
+
+  const timeval* ManagerImpl::getConnectTimeout() const
   {
-    size_t num;
+    if ( _configuration.connectTimeout.tv_sec == 0 )
+    {
+      return nullptr;
+    }
+    else
+    {
+      return &_configuration.connectTimeout;
+    }
+  }
+
+
+  void ManagerImpl::startTimeoutSweep( WorkerData* worker )
+  {
+    if ( this->getReadTimeout() == nullptr && this->getWriteTimeout() == nullptr && this->getIdleTimeout() == nullptr )
+    {
+      return;
+    }
+
+    worker->timeoutTimer.setCallback( timeoutSweepCB, (void*)worker );
+    worker->timers->arm( &worker->timeoutTimer, TimeoutSweepInterval, TimeoutSweepSlack );
+  }
+
+
+  void ManagerImpl::checkTimeouts( WorkerData* worker )
+  {
+    SteadyTime now = CoarseClock::now();
+
+    // Only collect them while the shard is locked. Closing and the server's callback happen after
+    std::vector< std::pair< Handle, const char* > > expired;
+    std::vector< std::pair< Handle, const char* > > failed;
+    {
+      GuardLock lk( worker->connectionTableMutex );
+      worker->connectionTable.forEach( [worker, now, &expired, &failed]( Connection* connection )
+      {
+        if ( ! connection->isOpen() || connection->getWorker() != worker ) return;
+
+        const char* error = connection->expireFilters( now );
+        if ( error != nullptr )
+        {
+          failed.push_back( std::make_pair( connection->requestHandle(), error ) );
+          return;
+        }
+
+        const char* reason = connection->checkTimeout( now );
+        if ( reason != nullptr )
+        {
+          expired.push_back( std::make_pair( connection->requestHandle(), reason ) );
+        }
+      } );
+    }
+
+    for ( std::vector< std::pair< Handle, const char* > >::iterator it = expired.begin(); it != expired.end(); ++it )
     {
-      GuardLock lk( _connectionsMutex );
-      num = _connections.size();
+      if ( ! it->first || ! it->first.isOpen() ) continue;
+
+      INFO_STREAM( "Stewardess::Timeout" ) << it->second << ". Closing connection: " << it->first.getConnectionID();
+      it->first.close();
+      _server.onConnectionEvent( it->first, ConnectionEvent::Timeout, it->second );
     }
 
+    for ( std::vector< std::pair< Handle, const char* > >::iterator it = failed.begin(); it != failed.end(); ++it )
+    {
+      if ( ! it->first || ! it->first.isOpen() ) continue;
+
+      ERROR_STREAM( "Stewardess::Timeout" ) << "Filter failed. Closing connection: " << it->first.getConnectionID();
+      it->first.close();
+      _server.onConnectionEvent( it->first, ConnectionEvent::DisconnectError, it->second );
+    }
+
+    worker->timers->arm( &worker->timeoutTimer, TimeoutSweepInterval, TimeoutSweepSlack );
+  }
+
+
+  timeval* ManagerImpl::getTickTime()
+  {
+    size_t num = _numberConnections.load( std::memory_order_relaxed );
+
     _tickTime.tv_sec = _configuration.minTickTime + _configuration.tickTimeModifier * ( std::log10( num + 1 ) );
 
     return & _tickTime;
   }
 
 
+  Connection* ManagerImpl::createConnection( const sockaddr& address, WorkerData* worker, evutil_socket_t new_socket )
+  {
+    // The user's builders run before the slab is locked, they can take as long as they like
+    CompressionFilter* compression = nullptr;
+    Serializer* serializer = _server.buildSerializer();
+    FilterChain* filters = nullptr;
+    try
+    {
+      filters = Connection::_buildFilterChain( *this, compression );
+      return worker->connectionSlab->create( address, *this, worker, new_socket, serializer, filters, compression );
+    }
+    catch ( ... )
+    {
+      delete serializer;
+      delete filters;
+      throw;
+    }
+  }
+
+
+  ConnectionSlab* ManagerImpl::getConnectionSlab( ConnectionID id ) const
+  {
+    size_t index = ConnectionSlab::slabIndex( id );
+    if ( index == 0 )
+      return _controlWorker.connectionSlab;
+    else if ( index <= _threads.size() )
+      return _threads[ index - 1 ]->data.connectionSlab;
+    else
+      return nullptr;
+  }
+
+
   void ManagerImpl::addConnection( Connection* connection )
   {
-    GuardLock lk( _connectionsMutex );
-    _connections[ connection->getConnectionID() ] = connection;
+    WorkerData* worker = connection->getWorker();
+    {
+      GuardLock lk( worker->connectionTableMutex );
+      worker->connectionTable.insert( connection->getConnectionID(), connection );
+    }
+    worker->connections.fetch_add( 1, std::memory_order_relaxed );
+    _numberConnections.fetch_add( 1, std::memory_order_relaxed );
     connection->open();
   }
 
 
+  void ManagerImpl::forEachConnection( const std::function< void( Connection* ) >& function ) const
+  {
+    for ( ThreadVector::const_iterator it = _threads.begin(); it != _threads.end(); ++it )
+    {
+      GuardLock lk( (*it)->data.connectionTableMutex );
+      (*it)->data.connectionTable.forEach( function );
+    }
+
+    GuardLock lk( _controlWorker.connectionTableMutex );
+    _controlWorker.connectionTable.forEach( function );
+  }
+
+
   void ManagerImpl::closeConnection( Connection* connection )
   {
-    GuardLock lk( _connectionsMutex );
-    ConnectionMap::iterator it = _connections.find( connection->getConnectionID() );
-    if ( it != _connections.end() )
+    // Only called once the last handle has gone, so it can't be migrating
+    WorkerData* worker = connection->getWorker();
+    ConnectionSlab* slab = this->getConnectionSlab( connection->getConnectionID() );
+    bool found;
     {
-      delete it->second;
-      _connections.erase( it );
+      // Retired and removed together, so anyone iterating the shard can still take a handle safely.
+      //  A handle taken since it closed keeps it. Dropping that handle schedules this again
+      GuardLock lk( worker->connectionTableMutex );
+      if ( ! slab->retire( connection ) ) return;
+      found = worker->connectionTable.erase( connection->getConnectionID() );
+    }
+
+    if ( found )
+    {
+      if ( connection->isCompressed() )
+      {
+        CompressionStatistics stats = connection->getCompressionStatistics();
+        INFO_STREAM( "Stewardess::Compression" ) << "Connection " << connection->getConnectionID()
+          << " wire/plain out: " << stats.wireBytesOut << "/" << stats.plainBytesOut
+          << ", in: " << stats.wireBytesIn << "/" << stats.plainBytesIn
+          << ". CPU ms/MB deflate: " << stats.compressCPUPerMB() << ", inflate: " << stats.decompressCPUPerMB();
+
+        GuardLock stats_lk( _closedCompressionStatisticsMutex );
+        _closedCompressionStatistics += stats;
+      }
+
+      worker->connections.fetch_sub( 1, std::memory_order_relaxed );
+      _numberConnections.fetch_sub( 1, std::memory_order_relaxed );
+      slab->release( connection );
     }
     else
     {
@@ -492,45 +1410,34 @@ namespace Stewardess
 
   void ManagerImpl::createTimer( UniqueID uid, bool repeat )
   {
-    TimerData* timer = new TimerData( { this, uid, nullptr, repeat, {0, 0} } );
-
-    timer->theEvent = evtimer_new( _eventBase, userTimerCB, (void*)timer );
-    if ( timer->theEvent == nullptr )
-    {
-      throw Exception( "Could not create user timer event." );
-    }
-
-    GuardLock lk( _userTimersMutex );
-    TimerMap::iterator found = _userTimers.find( uid );
-    if ( found != _userTimers.end() )
+    TimerData* timer = new TimerData( this, uid, repeat );
+    if ( ! _userTimers.insert( uid, timer ) )
     {
+      delete timer;
       throw Exception( "Cannot create a timer using an exist ID." );
     }
-
-    _userTimers.insert( std::make_pair( uid, timer ) );
   }
 
 
   void ManagerImpl::startTimerClock( UniqueID uid, TimeStamp timestamp )
   {
-    auto now = std::chrono::system_clock::now();
+    // The user gives a wall clock time, the wheel only needs how far away it is
+    TimeStamp now = std::chrono::system_clock::now();
     if ( timestamp < now )
     {
       WARN_STREAM( "Manager::StartTimer" ) << "Cannot start timer for a negative amount of time. ID: " << uid;
     }
 
-    GuardLock lk( _userTimersMutex );
-
-    TimerMap::iterator found = _userTimers.find( uid );
-    if ( found == _userTimers.end() )
+    // Neither the lookup nor arming the wheel takes a lock, so any number of threads can start timers
+    TimerData* timer = _userTimers.find( uid );
+    if ( timer == nullptr )
     {
       WARN_STREAM( "Manager::StartTimer" ) << "Cannot start timer of unknown ID: " << uid;
       return;
     }
 
-    found->second->time = convertToTimeval( timestamp - now );
-
-    event_add( found->second->theEvent, &found->second->time );
+    timer->time = std::chrono::duration_cast< Milliseconds >( timestamp - now );
+    _controlWorker.timers->arm( &timer->timer, timer->time );
   }
 
 
@@ -541,18 +1448,15 @@ namespace Stewardess
       WARN_STREAM( "Manager::StartTimer" ) << "Cannot start timer for a negative amount of time. ID: " << uid;
     }
 
-    GuardLock lk( _userTimersMutex );
-
-    TimerMap::iterator found = _userTimers.find( uid );
-    if ( found == _userTimers.end() )
+    TimerData* timer = _userTimers.find( uid );
+    if ( timer == nullptr )
     {
       WARN_STREAM( "Manager::StartTimer" ) << "Cannot start timer of unknown ID: " << uid;
       return;
     }
 
-    found->second->time = convertToTimeval( countdown );
-
-    event_add( found->second->theEvent, &found->second->time );
+    timer->time = countdown;
+    _controlWorker.timers->arm( &timer->timer, timer->time );
   }
 
 }
@@ -0,0 +1,388 @@
+
+#include "Resolver.h"
+#include "EventCallbacks.h"
+#include "Exception.h"
+
+#include <netdb.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+
+namespace Stewardess
+{
+
+  // Names are case insensitive, so everything is stored in lower case
+  static std::string normalizeName( const std::string& name )
+  {
+    std::string result( name );
+    std::transform( result.begin(), result.end(), result.begin(), []( unsigned char c ) { return std::tolower( c ); } );
+    return result;
+  }
+
+
+  // Fill in the address if the string is a numeric IPv4 or IPv6 address
+  static bool parseNumericAddress( const std::string& text, sockaddr_storage& address )
+  {
+    memset( &address, 0, sizeof( address ) );
+
+    sockaddr_in* ipv4 = (sockaddr_in*)&address;
+    if ( evutil_inet_pton( AF_INET, text.c_str(), &ipv4->sin_addr ) == 1 )
+    {
+      ipv4->sin_family = AF_INET;
+      return true;
+    }
+
+    sockaddr_in6* ipv6 = (sockaddr_in6*)&address;
+    if ( evutil_inet_pton( AF_INET6, text.c_str(), &ipv6->sin6_addr ) == 1 )
+    {
+      ipv6->sin6_family = AF_INET6;
+      return true;
+    }
+
+    return false;
+  }
+
+
+  Resolver::Resolver( event_base* base, const ConfigurationData& configuration ) :
+    _dnsBase( nullptr ),
+    _negativeTTL( std::chrono::seconds( configuration.dnsNegativeTTL ) ),
+    _refreshAhead( configuration.dnsRefreshAhead ),
+    _hosts(),
+    _entries(),
+    _queries( 0 ),
+    _hits( 0 )
+  {
+    // Inactive lookups shouldn't keep the event loop alive
+    int flags = EVDNS_BASE_DISABLE_WHEN_INACTIVE;
+    if ( configuration.nameServers.empty() )
+    {
+      flags |= EVDNS_BASE_INITIALIZE_NAMESERVERS;
+    }
+
+    _dnsBase = evdns_base_new( base, flags );
+    if ( _dnsBase == nullptr )
+    {
+      throw Exception( "Could not create the DNS resolver." );
+    }
+
+    for ( std::vector< std::string >::const_iterator it = configuration.nameServers.begin(); it != configuration.nameServers.end(); ++it )
+    {
+      if ( evdns_base_nameserver_ip_add( _dnsBase, it->c_str() ) != 0 )
+      {
+        evdns_base_free( _dnsBase, 0 );
+        throw Exception( "Invalid name server address: " + *it );
+      }
+    }
+
+    if ( ! configuration.hostsFile.empty() )
+    {
+      this->_loadHosts( configuration.hostsFile );
+    }
+  }
+
+
+  Resolver::~Resolver()
+  {
+    // Outstanding queries are answered with DNS_ERR_SHUTDOWN, which only frees them
+    evdns_base_free( _dnsBase, 1 );
+  }
+
+
+  void Resolver::_loadHosts( const std::string& file_name )
+  {
+    std::ifstream file( file_name );
+    if ( ! file )
+    {
+      WARN_STREAM( "Stewardess::Resolver" ) << "Could not read the hosts file: " << file_name;
+      return;
+    }
+
+    std::string line;
+    while ( std::getline( file, line ) )
+    {
+      std::string::size_type comment = line.find( '#' );
+      if ( comment != std::string::npos )
+      {
+        line.erase( comment );
+      }
+
+      std::istringstream words( line );
+      std::string address_string;
+      if ( ! ( words >> address_string ) ) continue;
+
+      sockaddr_storage address;
+      if ( ! parseNumericAddress( address_string, address ) )
+      {
+        WARN_STREAM( "Stewardess::Resolver" ) << "Ignoring invalid address in hosts file: " << address_string;
+        continue;
+      }
+
+      std::string name;
+      while ( words >> name )
+      {
+        _hosts[ normalizeName( name ) ].push_back( address );
+      }
+    }
+  }
+
+
+  bool Resolver::_staticLookup( const std::string& name, AddressVector& addresses ) const
+  {
+    sockaddr_storage address;
+    if ( parseNumericAddress( name, address ) )
+    {
+      addresses.assign( 1, address );
+      return true;
+    }
+
+    HostsMap::const_iterator found = _hosts.find( name );
+    if ( found != _hosts.end() )
+    {
+      addresses = found->second;
+      return true;
+    }
+
+    return false;
+  }
+
+
+  void Resolver::resolve( const std::string& host, ResolveCallback callback )
+  {
+    std::string name = normalizeName( host );
+    AddressVector addresses;
+
+    if ( this->_staticLookup( name, addresses ) )
+    {
+      _hits.fetch_add( 1, std::memory_order_relaxed );
+      callback( addresses );
+      return;
+    }
+
+    Clock::time_point now = Clock::now();
+    UniqueLock lk( _entriesMutex );
+
+    Entry& entry = _entries[ name ];
+    if ( now < entry.expiry )
+    {
+      // A cached answer or a cached failure. Refresh a good one if it is getting old
+      addresses = entry.addresses;
+      bool refresh = ! entry.addresses.empty() && ! entry.pending && now >= entry.refresh;
+      if ( refresh )
+      {
+        entry.pending = true;
+      }
+      lk.unlock();
+
+      _hits.fetch_add( 1, std::memory_order_relaxed );
+      if ( refresh )
+      {
+        DEBUG_STREAM( "Stewardess::Resolver" ) << "Refreshing " << name;
+        this->_query( name, false );
+      }
+      callback( addresses );
+      return;
+    }
+
+    // Missing or expired. Join the query if one is already going
+    entry.waiting.push_back( std::move( callback ) );
+    if ( entry.pending ) return;
+    entry.pending = true;
+    lk.unlock();
+
+    this->_query( name, false );
+  }
+
+
+  bool Resolver::lookup( const std::string& host, AddressVector& addresses ) const
+  {
+    std::string name = normalizeName( host );
+    if ( this->_staticLookup( name, addresses ) )
+    {
+      return true;
+    }
+
+    GuardLock lk( _entriesMutex );
+    EntryMap::const_iterator found = _entries.find( name );
+    if ( found == _entries.end() || found->second.addresses.empty() || Clock::now() >= found->second.expiry )
+    {
+      return false;
+    }
+
+    addresses = found->second.addresses;
+    return true;
+  }
+
+
+  void Resolver::clear()
+  {
+    GuardLock lk( _entriesMutex );
+    for ( EntryMap::iterator it = _entries.begin(); it != _entries.end(); )
+    {
+      // Keep the ones with callers waiting on them
+      if ( it->second.pending )
+        ++it;
+      else
+        it = _entries.erase( it );
+    }
+  }
+
+
+  void Resolver::_query( const std::string& name, bool ipv6 )
+  {
+    Query* query = new Query();
+    query->resolver = this;
+    query->name = name;
+    query->ipv6 = ipv6;
+
+    _queries.fetch_add( 1, std::memory_order_relaxed );
+
+    evdns_request* request;
+    if ( ipv6 )
+      request = evdns_base_resolve_ipv6( _dnsBase, name.c_str(), 0, resolverCB, (void*)query );
+    else
+      request = evdns_base_resolve_ipv4( _dnsBase, name.c_str(), 0, resolverCB, (void*)query );
+
+    if ( request == nullptr )
+    {
+      this->_answer( query, DNS_ERR_UNKNOWN, 0, 0, 0, nullptr );
+    }
+  }
+
+
+  void Resolver::_answer( Query* query, int result, char type, int count, int ttl, void* records )
+  {
+    if ( result == DNS_ERR_SHUTDOWN )
+    {
+      delete query;
+      return;
+    }
+
+    AddressVector addresses;
+    if ( result == DNS_ERR_NONE )
+    {
+      for ( int i = 0; i < count; ++i )
+      {
+        sockaddr_storage address;
+        memset( &address, 0, sizeof( address ) );
+        if ( type == DNS_IPv4_A )
+        {
+          sockaddr_in* ipv4 = (sockaddr_in*)&address;
+          ipv4->sin_family = AF_INET;
+          memcpy( &ipv4->sin_addr, (char*)records + i * 4, 4 );
+        }
+        else if ( type == DNS_IPv6_AAAA )
+        {
+          sockaddr_in6* ipv6 = (sockaddr_in6*)&address;
+          ipv6->sin6_family = AF_INET6;
+          memcpy( &ipv6->sin6_addr, (char*)records + i * 16, 16 );
+        }
+        else
+        {
+          continue;
+        }
+        addresses.push_back( address );
+      }
+    }
+
+    // The name exists but has no IPv4 address. Try IPv6 before giving up
+    if ( addresses.empty() && ! query->ipv6 && ( result == DNS_ERR_NONE || result == DNS_ERR_NODATA ) )
+    {
+      this->_query( query->name, true );
+      delete query;
+      return;
+    }
+
+    if ( addresses.empty() )
+    {
+      WARN_STREAM( "Stewardess::Resolver" ) << "Could not resolve " << query->name << ": " << evdns_err_to_string( result );
+    }
+
+    std::vector< ResolveCallback > waiting;
+    {
+      GuardLock lk( _entriesMutex );
+      Entry& entry = _entries[ query->name ];
+      Clock::time_point now = Clock::now();
+      entry.pending = false;
+
+      if ( ! addresses.empty() )
+      {
+        std::chrono::seconds time_to_live( std::max( ttl, 0 ) );
+        entry.addresses = addresses;
+        entry.expiry = now + time_to_live;
+        entry.refresh = entry.expiry - std::chrono::duration_cast< Clock::duration >( time_to_live * _refreshAhead );
+      }
+      else if ( entry.addresses.empty() || now >= entry.expiry )
+      {
+        entry.addresses.clear();
+        entry.expiry = now + _negativeTTL;
+        entry.refresh = entry.expiry;
+      }
+      else
+      {
+        // Only a refresh failed. Keep the answer we have until it expires
+        entry.refresh = entry.expiry;
+      }
+
+      addresses = entry.addresses;
+      waiting.swap( entry.waiting );
+    }
+
+    delete query;
+
+    for ( std::vector< ResolveCallback >::iterator it = waiting.begin(); it != waiting.end(); ++it )
+    {
+      (*it)( addresses );
+    }
+  }
+
+
+  size_t Resolver::getNumberQueries() const
+  {
+    return _queries.load( std::memory_order_relaxed );
+  }
+
+
+  size_t Resolver::getNumberHits() const
+  {
+    return _hits.load( std::memory_order_relaxed );
+  }
+
+
+  bool Resolver::setPort( sockaddr_storage& address, const std::string& port )
+  {
+    uint16_t number;
+
+    char* end = nullptr;
+    unsigned long value = std::strtoul( port.c_str(), &end, 10 );
+    if ( ! port.empty() && *end == '\0' && value <= 65535 )
+    {
+      number = htons( (uint16_t)value );
+    }
+    else
+    {
+      // Service names come from /etc/services
+      servent entry;
+      servent* result = nullptr;
+      char buffer[ 1024 ];
+      if ( getservbyname_r( port.c_str(), "tcp", &entry, buffer, sizeof( buffer ), &result ) != 0 || result == nullptr )
+      {
+        return false;
+      }
+      number = (uint16_t)result->s_port;
+    }
+
+    if ( address.ss_family == AF_INET )
+      ((sockaddr_in*)&address)->sin_port = number;
+    else if ( address.ss_family == AF_INET6 )
+      ((sockaddr_in6*)&address)->sin6_port = number;
+    else
+      return false;
+
+    return true;
+  }
+
+}
+
@@ -49,6 +49,7 @@ namespace Stewardess
 
   Buffer* Serializer::getBuffer()
   {
+    GuardLock lk( _bufferMutex );
     Buffer* temp = _buffers.front();
     _buffers.pop();
     return temp;
@@ -57,6 +58,7 @@ namespace Stewardess
 
   bool Serializer::bufferEmpty() const
   {
+    GuardLock lk( _bufferMutex );
     return _buffers.empty();
   }
 
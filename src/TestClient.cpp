@@ -38,25 +38,25 @@ namespace Stewardess
   }
 
 
-  void TestClient::onRead( Handle c, Payload* p )
+  void TestClient::onRead( HandleRef c, Payload* p )
   {
     std::cout << "RECEIVED: From connection: " << c.getConnectionID() <<  "  --  " << ((TestPayload*)p)->getMessage() << std::endl;
     delete p;
   }
 
 
-  void TestClient::onConnectionEvent( Handle connection, ConnectionEvent event, const char* error )
+  void TestClient::onConnectionEvent( HandleRef connection, ConnectionEvent event, const char* error )
   {
     switch( event )
     {
       case ConnectionEvent::Connect :
       {
-        _handle = connection;
+        _handle = Handle( connection );
         std::cout << "Connection Event" << std::endl;
         std::cout << "Successfully connected to : " << _handle.getIPAddress().getStringFull() << std::endl;
 
-        TestPayload p( "Hello" );
-        connection.write( &p );
+        _handle.readInCoroutine();
+        _converse( _handle );
       }
       break;
 
@@ -78,12 +78,40 @@ namespace Stewardess
       }
       break;
 
+      case ConnectionEvent::Timeout :
+      {
+        std::cout << "Timeout Event: " << error << std::endl;
+
+        _alive = false;
+        manager().shutdown();
+      }
+      break;
+
       default:
       break;
     }
   }
 
 
+  Task TestClient::_converse( Handle connection )
+  {
+    co_await manager().sleep( Milliseconds( 100 ) );
+
+    TestPayload p( "Hello" );
+    if ( ! co_await connection.write( &p ) )
+    {
+      co_return;
+    }
+    std::cout << "SENT: To connection: " << connection.getConnectionID() << "  --  Hello" << std::endl;
+
+    while ( Payload* reply = co_await connection.read() )
+    {
+      std::cout << "RECEIVED: From connection: " << connection.getConnectionID() <<  "  --  " << ((TestPayload*)reply)->getMessage() << std::endl;
+      delete reply;
+    }
+  }
+
+
   void TestClient::onTick( Milliseconds time )
   {
     if ( _alive && _handle )
@@ -5,7 +5,7 @@
 namespace Stewardess
 {
 
-  void TestServer::onRead( Handle c, Payload* p )
+  void TestServer::onRead( HandleRef c, Payload* p )
   {
     std::cout << "RECEIVED: From connection: " << c.getConnectionID() <<  "  --  " << ((TestPayload*)p)->getMessage() << std::endl;
     delete p;
@@ -13,10 +13,18 @@ namespace Stewardess
     std::cout << "SENDING: To connection: " << c.getConnectionID() <<  "  --  Cheers bruh" << std::endl;
     TestPayload reply( std::string( "Cheers bruh" ) );
     c.write( &reply );
+
+    // Move the connection around the workers to check nothing is lost on the way
+    WorkerLoadVector loads = manager().getWorkerLoads();
+    if ( loads.size() > 1 )
+    {
+      size_t worker = ( ++_nextWorker ) % loads.size();
+      std::cout << "MIGRATING: Connection " << c.getConnectionID() << " to worker " << worker << " : " << manager().migrateConnection( c, worker ) << std::endl;
+    }
   }
 
 
-  void TestServer::onConnectionEvent( Handle handle, ConnectionEvent event, const char* error )
+  void TestServer::onConnectionEvent( HandleRef handle, ConnectionEvent event, const char* error )
   {
     switch( event )
     {
@@ -41,6 +49,13 @@ namespace Stewardess
       }
       break;
 
+      case ConnectionEvent::Timeout :
+      {
+        std::cout << "Timeout Event: " << error << std::endl;
+        std::cout << "IP Address : " << handle.getIPAddress().getStringFull() << std::endl;
+      }
+      break;
+
       default:
       break;
     }
@@ -50,6 +65,13 @@ namespace Stewardess
   void TestServer::onTick( Milliseconds /*time*/ )
   {
     std::cout << std::endl;
+
+    if ( manager().getNumberConnections() > 0 )
+    {
+      std::cout << "BROADCASTING: To " << manager().getNumberConnections() << " connections  --  Tick" << std::endl;
+      TestPayload tick( std::string( "Tick" ) );
+      manager().broadcast( &tick );
+    }
   }
 
 }
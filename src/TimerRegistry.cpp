@@ -0,0 +1,134 @@
+
+#include "TimerRegistry.h"
+#include "TimerData.h"
+
+
+namespace Stewardess
+{
+
+  // Position an ID hashes to
+  static size_t timerHome( UniqueID key, size_t capacity )
+  {
+    uint64_t hash = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    return ( hash >> 32 ) & ( capacity - 1 );
+  }
+
+
+  TimerRegistry::TimerRegistry() :
+    _table( _newTable( 16 ) ),
+    _retired(),
+    _size( 0 )
+  {
+  }
+
+
+  TimerRegistry::~TimerRegistry()
+  {
+    this->clear();
+
+    Table* table = _table.load();
+    delete[] table->slots;
+    delete table;
+  }
+
+
+  TimerRegistry::Table* TimerRegistry::_newTable( size_t capacity )
+  {
+    Table* table = new Table;
+    table->capacity = capacity;
+    table->slots = new Slot[ capacity ];
+    for ( size_t i = 0; i < capacity; ++i )
+    {
+      table->slots[i].key.store( 0, std::memory_order_relaxed );
+      table->slots[i].value.store( nullptr, std::memory_order_relaxed );
+    }
+    return table;
+  }
+
+
+  TimerData* TimerRegistry::_find( const Table* table, UniqueID key )
+  {
+    size_t mask = table->capacity - 1;
+    for ( size_t i = timerHome( key, table->capacity ); ; i = ( i + 1 ) & mask )
+    {
+      // The value is published after the key, so a slot with a value has its key
+      TimerData* value = table->slots[i].value.load( std::memory_order_acquire );
+      if ( value == nullptr )
+        return nullptr;
+      if ( table->slots[i].key.load( std::memory_order_relaxed ) == key )
+        return value;
+    }
+  }
+
+
+  void TimerRegistry::_place( Table* table, UniqueID key, TimerData* value )
+  {
+    size_t mask = table->capacity - 1;
+    size_t i = timerHome( key, table->capacity );
+    while ( table->slots[i].value.load( std::memory_order_relaxed ) != nullptr )
+      i = ( i + 1 ) & mask;
+
+    table->slots[i].key.store( key, std::memory_order_relaxed );
+    table->slots[i].value.store( value, std::memory_order_release );
+  }
+
+
+  bool TimerRegistry::insert( UniqueID key, TimerData* value )
+  {
+    GuardLock lk( _mutex );
+    Table* table = _table.load( std::memory_order_relaxed );
+
+    if ( _find( table, key ) != nullptr )
+      return false;
+
+    // Keep at most half full so the probe chains stay short
+    if ( ( _size + 1 ) * 2 > table->capacity )
+    {
+      Table* bigger = _newTable( table->capacity * 2 );
+      for ( size_t i = 0; i < table->capacity; ++i )
+      {
+        TimerData* old_value = table->slots[i].value.load( std::memory_order_relaxed );
+        if ( old_value != nullptr )
+          _place( bigger, table->slots[i].key.load( std::memory_order_relaxed ), old_value );
+      }
+
+      // Lookups already on the old table may still be reading it
+      _table.store( bigger, std::memory_order_release );
+      _retired.push_back( table );
+      table = bigger;
+    }
+
+    _place( table, key, value );
+    ++_size;
+    return true;
+  }
+
+
+  TimerData* TimerRegistry::find( UniqueID key ) const
+  {
+    return _find( _table.load( std::memory_order_acquire ), key );
+  }
+
+
+  void TimerRegistry::clear()
+  {
+    GuardLock lk( _mutex );
+    Table* table = _table.load( std::memory_order_relaxed );
+    for ( size_t i = 0; i < table->capacity; ++i )
+    {
+      delete table->slots[i].value.load( std::memory_order_relaxed );
+      table->slots[i].value.store( nullptr, std::memory_order_relaxed );
+      table->slots[i].key.store( 0, std::memory_order_relaxed );
+    }
+    _size = 0;
+
+    for ( std::vector< Table* >::iterator it = _retired.begin(); it != _retired.end(); ++it )
+    {
+      delete[] (*it)->slots;
+      delete (*it);
+    }
+    _retired.clear();
+  }
+
+}
+
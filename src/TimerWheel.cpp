@@ -0,0 +1,359 @@
+
+#include "TimerWheel.h"
+#include "WorkerThread.h"
+#include "EventCallbacks.h"
+#include "Exception.h"
+
+#include <limits>
+
+
+namespace Stewardess
+{
+
+  static const uint64_t NoTick = std::numeric_limits< uint64_t >::max();
+
+
+  TimerWheel::TimerWheel( WorkerData* owner ) :
+    _owner( owner ),
+    _event( nullptr ),
+    _start( std::chrono::steady_clock::now() ),
+    _current( 0 ),
+    _scheduled( NoTick ),
+    _overflow( nullptr ),
+    _commands( nullptr ),
+    _size( 0 )
+  {
+    for ( unsigned level = 0; level < Levels; ++level )
+    {
+      _occupied[ level ] = 0;
+      for ( unsigned slot = 0; slot < Slots; ++slot )
+      {
+        _slots[ level ][ slot ] = nullptr;
+      }
+    }
+
+    _event = evtimer_new( owner->eventBase, wheelTimerCB, (void*)this );
+    if ( _event == nullptr )
+    {
+      throw Exception( "Could not create the timer wheel event." );
+    }
+  }
+
+
+  TimerWheel::~TimerWheel()
+  {
+    // Timers still armed belong to their users. They are just forgotten
+    event_free( _event );
+  }
+
+
+  uint64_t TimerWheel::_now() const
+  {
+    return std::chrono::duration_cast< Milliseconds >( std::chrono::steady_clock::now() - _start ).count();
+  }
+
+
+  void TimerWheel::_link( WheelTimer* timer )
+  {
+    // The lowest level where the expiry and the current tick only differ in that level's slot
+    uint64_t expiry = timer->_expiry;
+    unsigned level = 0;
+    while ( level < Levels && ( expiry >> ( SlotBits * ( level + 1 ) ) ) != ( _current >> ( SlotBits * ( level + 1 ) ) ) )
+    {
+      ++level;
+    }
+
+    WheelTimer** head;
+    if ( level == Levels )
+    {
+      head = &_overflow;
+      timer->_slot = 0;
+    }
+    else
+    {
+      timer->_slot = ( expiry >> ( SlotBits * level ) ) & ( Slots - 1 );
+      head = &_slots[ level ][ timer->_slot ];
+      _occupied[ level ] |= ( 1ull << timer->_slot );
+    }
+    timer->_level = level;
+
+    timer->_previous = nullptr;
+    timer->_next = *head;
+    if ( *head != nullptr ) (*head)->_previous = timer;
+    *head = timer;
+    timer->_linked = true;
+  }
+
+
+  void TimerWheel::_unlink( WheelTimer* timer )
+  {
+    WheelTimer** head = ( timer->_level == Levels ) ? &_overflow : &_slots[ timer->_level ][ timer->_slot ];
+
+    if ( timer->_previous != nullptr )
+      timer->_previous->_next = timer->_next;
+    else
+      *head = timer->_next;
+
+    if ( timer->_next != nullptr ) timer->_next->_previous = timer->_previous;
+
+    if ( *head == nullptr && timer->_level < Levels )
+    {
+      _occupied[ timer->_level ] &= ~( 1ull << timer->_slot );
+    }
+
+    timer->_previous = nullptr;
+    timer->_next = nullptr;
+    timer->_linked = false;
+  }
+
+
+  void TimerWheel::_apply( WheelTimer* timer )
+  {
+    uint64_t requested = timer->_requested.load( std::memory_order_acquire );
+
+    if ( timer->_linked )
+    {
+      this->_unlink( timer );
+      _size.fetch_sub( 1, std::memory_order_relaxed );
+    }
+
+    if ( requested == 0 ) return;
+
+    // An empty wheel may not have been advanced for a while. Catch it up so the new timer lands low
+    if ( _size.load( std::memory_order_relaxed ) == 0 )
+    {
+      _current = std::max( _current, this->_now() );
+    }
+
+    // Never behind the tick being processed
+    timer->_applied = requested;
+    timer->_expiry = std::max( requested, _current + 1 );
+    this->_link( timer );
+    _size.fetch_add( 1, std::memory_order_relaxed );
+  }
+
+
+  void TimerWheel::arm( WheelTimer* timer, Milliseconds delay, Milliseconds slack )
+  {
+    // The current tick has already started, so count from the next one to never fire early
+    uint64_t expiry = this->_now() + 1 + std::max( delay.count(), (Milliseconds::rep)0 );
+
+    // Round up to the largest power of two within the slack, so nearby timers share the tick
+    if ( slack.count() > 1 )
+    {
+      uint64_t granularity = 1ull << ( 63 - __builtin_clzll( (uint64_t)slack.count() ) );
+      expiry = ( expiry + granularity - 1 ) & ~( granularity - 1 );
+    }
+
+    timer->_requested.store( expiry, std::memory_order_release );
+
+    if ( getCurrentWorker() == _owner )
+    {
+      this->_apply( timer );
+      if ( timer->_expiry < _scheduled ) this->_schedule();
+      return;
+    }
+
+    // Already waiting in the stack, it will pick up the new expiry
+    if ( timer->_queued.exchange( true ) ) return;
+
+    WheelTimer* head = _commands.load( std::memory_order_relaxed );
+    do
+    {
+      timer->_queueNext = head;
+    }
+    while ( ! _commands.compare_exchange_weak( head, timer, std::memory_order_release, std::memory_order_relaxed ) );
+
+    // Only the first into an empty stack needs to wake the worker
+    if ( head == nullptr )
+    {
+      signalWorkerInbox( _owner );
+    }
+  }
+
+
+  void TimerWheel::cancel( WheelTimer* timer )
+  {
+    timer->_requested.store( 0, std::memory_order_release );
+
+    if ( getCurrentWorker() == _owner )
+    {
+      this->_apply( timer );
+      return;
+    }
+
+    if ( timer->_queued.exchange( true ) ) return;
+
+    WheelTimer* head = _commands.load( std::memory_order_relaxed );
+    do
+    {
+      timer->_queueNext = head;
+    }
+    while ( ! _commands.compare_exchange_weak( head, timer, std::memory_order_release, std::memory_order_relaxed ) );
+
+    if ( head == nullptr )
+    {
+      signalWorkerInbox( _owner );
+    }
+  }
+
+
+  void TimerWheel::processCommands()
+  {
+    WheelTimer* timer = _commands.exchange( nullptr, std::memory_order_acquire );
+    if ( timer == nullptr ) return;
+
+    while ( timer != nullptr )
+    {
+      WheelTimer* next = timer->_queueNext;
+      timer->_queueNext = nullptr;
+
+      // Requests from now on need to queue it again
+      timer->_queued.store( false, std::memory_order_release );
+      this->_apply( timer );
+
+      timer = next;
+    }
+
+    this->_schedule();
+  }
+
+
+  void TimerWheel::_cascade( unsigned level, unsigned slot )
+  {
+    WheelTimer* timer = _slots[ level ][ slot ];
+    _slots[ level ][ slot ] = nullptr;
+    _occupied[ level ] &= ~( 1ull << slot );
+
+    while ( timer != nullptr )
+    {
+      WheelTimer* next = timer->_next;
+      this->_link( timer );
+      timer = next;
+    }
+  }
+
+
+  void TimerWheel::_advance( uint64_t target )
+  {
+    while ( _current < target )
+    {
+      if ( _size.load( std::memory_order_relaxed ) == 0 )
+      {
+        _current = target;
+        return;
+      }
+
+      uint64_t next = _current + 1;
+
+      if ( ( next & ( Slots - 1 ) ) == 0 )
+      {
+        // Crossing a boundary. Bring the higher levels down, the highest first
+        _current = next;
+        unsigned top = 1;
+        while ( top < Levels && ( next & ( ( 1ull << ( SlotBits * ( top + 1 ) ) ) - 1 ) ) == 0 ) ++top;
+
+        if ( top == Levels )
+        {
+          WheelTimer* timer = _overflow;
+          _overflow = nullptr;
+          while ( timer != nullptr )
+          {
+            WheelTimer* following = timer->_next;
+            this->_link( timer );
+            timer = following;
+          }
+        }
+        for ( unsigned level = std::min( top, Levels - 1 ); level >= 1; --level )
+        {
+          this->_cascade( level, ( next >> ( SlotBits * level ) ) & ( Slots - 1 ) );
+        }
+      }
+      else
+      {
+        // Skip straight to the next occupied slot in this turn of level zero
+        uint64_t mask = _occupied[ 0 ] & ( ~0ull << ( next & ( Slots - 1 ) ) );
+        if ( mask == 0 )
+        {
+          _current = std::min( target, next | ( Slots - 1 ) );
+          continue;
+        }
+
+        next = ( next & ~(uint64_t)( Slots - 1 ) ) | __builtin_ctzll( mask );
+        if ( next > target )
+        {
+          _current = target;
+          return;
+        }
+        _current = next;
+      }
+
+      // Fire one at a time, callbacks may cancel the others. Anything they arm goes in a later tick
+      WheelTimer** head = &_slots[ 0 ][ _current & ( Slots - 1 ) ];
+      while ( *head != nullptr )
+      {
+        WheelTimer* timer = *head;
+        this->_unlink( timer );
+        _size.fetch_sub( 1, std::memory_order_relaxed );
+
+        // Unless another thread has armed it again since, a queued request for this expiry is finished with
+        uint64_t applied = timer->_applied;
+        timer->_requested.compare_exchange_strong( applied, 0, std::memory_order_acq_rel );
+        timer->_callback( timer->_argument );
+      }
+    }
+  }
+
+
+  uint64_t TimerWheel::_nextTick() const
+  {
+    if ( _size.load( std::memory_order_relaxed ) == 0 ) return NoTick;
+
+    for ( unsigned level = 0; level < Levels; ++level )
+    {
+      unsigned shift = SlotBits * level;
+      unsigned index = ( _current >> shift ) & ( Slots - 1 );
+      uint64_t mask = ( index == Slots - 1 ) ? 0 : _occupied[ level ] & ( ~0ull << ( index + 1 ) );
+      if ( mask != 0 )
+      {
+        uint64_t base = ( _current >> ( shift + SlotBits ) ) << ( shift + SlotBits );
+        return base | ( (uint64_t)__builtin_ctzll( mask ) << shift );
+      }
+    }
+
+    // Only the overflow is left. Wake when the top level comes round
+    unsigned shift = SlotBits * Levels;
+    return ( ( _current >> shift ) + 1 ) << shift;
+  }
+
+
+  void TimerWheel::_schedule()
+  {
+    uint64_t next = this->_nextTick();
+    if ( next == _scheduled ) return;
+
+    _scheduled = next;
+    if ( next == NoTick )
+    {
+      event_del( _event );
+      return;
+    }
+
+    // Wait for the start of the tick exactly, waking a little early would only wake again
+    std::chrono::microseconds wait = std::chrono::duration_cast< std::chrono::microseconds >( _start + Milliseconds( next ) - std::chrono::steady_clock::now() );
+    wait = std::max( wait, std::chrono::microseconds( 0 ) );
+    timeval timeout = { (time_t)( wait.count() / 1000000 ), (suseconds_t)( wait.count() % 1000000 ) };
+    event_add( _event, &timeout );
+  }
+
+
+  void TimerWheel::_expire()
+  {
+    _scheduled = NoTick;
+    this->processCommands();
+    this->_advance( this->_now() );
+    this->_schedule();
+  }
+
+}
+
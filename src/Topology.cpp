@@ -0,0 +1,130 @@
+
+#include "Topology.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+
+namespace Stewardess
+{
+
+  static const char* CPUDirectory = "/sys/devices/system/cpu/";
+  static const char* NodeDirectory = "/sys/devices/system/node/";
+
+
+  // Read the first line of a sysfs file. Empty if it doesn't exist
+  static std::string readLine( const std::string& path )
+  {
+    std::ifstream file( path.c_str() );
+    std::string line;
+    std::getline( file, line );
+    return line;
+  }
+
+
+  Topology Topology::detect()
+  {
+    Topology topology;
+    topology.online = parseCPUList( readLine( std::string( CPUDirectory ) + "online" ) );
+    topology.isolated = parseCPUList( readLine( std::string( CPUDirectory ) + "isolated" ) );
+
+    if ( topology.online.empty() )
+    {
+      long number = sysconf( _SC_NPROCESSORS_ONLN );
+      for ( long i = 0; i < number; ++i )
+        topology.online.push_back( i );
+    }
+
+    CPUSet node_ids = parseCPUList( readLine( std::string( NodeDirectory ) + "has_cpu" ) );
+    for ( CPUSet::iterator it = node_ids.begin(); it != node_ids.end(); ++it )
+    {
+      std::ostringstream path;
+      path << NodeDirectory << "node" << *it << "/cpulist";
+
+      NUMANode node = { *it, parseCPUList( readLine( path.str() ) ) };
+      if ( ! node.cpus.empty() )
+        topology.nodes.push_back( node );
+    }
+
+    if ( topology.nodes.empty() )
+    {
+      topology.nodes.push_back( { 0, topology.online } );
+    }
+
+    return topology;
+  }
+
+
+  int Topology::nodeOf( unsigned cpu ) const
+  {
+    for ( NUMANodeVector::const_iterator it = nodes.begin(); it != nodes.end(); ++it )
+    {
+      if ( std::find( it->cpus.begin(), it->cpus.end(), cpu ) != it->cpus.end() )
+        return it->id;
+    }
+    return -1;
+  }
+
+
+  CPUSet parseCPUList( const std::string& list )
+  {
+    CPUSet result;
+    std::istringstream stream( list );
+    std::string range;
+
+    while ( std::getline( stream, range, ',' ) )
+    {
+      if ( range.empty() ) continue;
+
+      size_t dash = range.find( '-' );
+      unsigned first = std::stoul( range.substr( 0, dash ) );
+      unsigned last = ( dash == std::string::npos ) ? first : std::stoul( range.substr( dash+1 ) );
+
+      for ( unsigned cpu = first; cpu <= last; ++cpu )
+        result.push_back( cpu );
+    }
+
+    return result;
+  }
+
+
+  std::string formatCPUList( const CPUSet& cpus )
+  {
+    std::ostringstream result;
+    for ( size_t i = 0; i < cpus.size(); ++i )
+    {
+      if ( i > 0 ) result << ',';
+      result << cpus[i];
+    }
+    return result.str();
+  }
+
+
+  bool pinThread( pthread_t thread, const CPUSet& cpus )
+  {
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    for ( CPUSet::const_iterator it = cpus.begin(); it != cpus.end(); ++it )
+    {
+      if ( *it < CPU_SETSIZE )
+        CPU_SET( *it, &set );
+    }
+    return pthread_setaffinity_np( thread, sizeof( set ), &set ) == 0;
+  }
+
+
+  bool preferNUMANode( int node )
+  {
+    if ( node < 0 || node >= (int)( sizeof( unsigned long ) * 8 ) )
+      return false;
+
+    unsigned long mask = 1ul << node;
+    return syscall( SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof( mask ) * 8 ) == 0;
+  }
+
+}
+
@@ -2,26 +2,140 @@
 #include "WorkerThread.h"
 #include "Exception.h"
 #include "EventCallbacks.h"
+#include "Topology.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstring>
 
 
 namespace Stewardess
 {
 
-  void workerThread( WorkerData worker_data )
+  // The worker run by this thread
+  static thread_local WorkerData* currentWorker = nullptr;
+
+
+  void workerThread( WorkerData* worker_data )
   {
+    setCurrentWorker( worker_data );
+
+    // Pin before anything is allocated so first-touch memory lands on the right node
+    if ( ! worker_data->cpus.empty() && ! pinThread( pthread_self(), worker_data->cpus ) )
+    {
+      WARN_STREAM( "Stewardess::WorkerThread" ) << "Could not pin worker to CPUs " << formatCPUList( worker_data->cpus );
+    }
+    if ( worker_data->numaNode >= 0 && ! preferNUMANode( worker_data->numaNode ) )
+    {
+      WARN_STREAM( "Stewardess::WorkerThread" ) << "Could not prefer memory from NUMA node " << worker_data->numaNode;
+    }
+
 //    // Add a tick event
-//    worker_data.tickEvent = evtimer_new( worker_data.eventBase, workerTickCB, (void*)&worker_data );
-//    if ( worker_data.tickEvent == nullptr )
+//    worker_data->tickEvent = evtimer_new( worker_data->eventBase, workerTickCB, (void*)worker_data );
+//    if ( worker_data->tickEvent == nullptr )
 //    {
 //      throw Exception( "Could not create the worker tick event." );
 //    }
-//    event_add( worker_data.tickEvent, &worker_data.tickTime );
+//    event_add( worker_data->tickEvent, &worker_data->tickTime );
 
     // Run the worker loop
-    event_base_loop( worker_data.eventBase, EVLOOP_NO_EXIT_ON_EMPTY );
+    event_base_loop( worker_data->eventBase, EVLOOP_NO_EXIT_ON_EMPTY );
 
 //    // Free the tick event
-//    event_free( worker_data.tickEvent );
+//    event_free( worker_data->tickEvent );
+  }
+
+
+  void postWorkerJob( WorkerData* worker_data, WorkerJob job )
+  {
+    GuardLock lk( worker_data->jobsMutex );
+    worker_data->jobs.push( std::move( job ) );
+
+    // Make sure the event is pending
+    event_add( worker_data->jobEvent, &immediately );
+  }
+
+
+  void drainWorkerJobs( WorkerData* worker_data )
+  {
+    if ( worker_data->jobEvent == nullptr ) return;
+
+    // Run them as the worker, so they take the same paths they would on its loop
+    WorkerData* previous = getCurrentWorker();
+    setCurrentWorker( worker_data );
+
+    WorkerJobQueue jobs;
+    while ( true )
+    {
+      {
+        GuardLock lk( worker_data->jobsMutex );
+        if ( worker_data->jobs.empty() ) break;
+        std::swap( jobs, worker_data->jobs );
+      }
+
+      while ( ! jobs.empty() )
+      {
+        jobs.front()();
+        jobs.pop();
+      }
+    }
+
+    setCurrentWorker( previous );
+  }
+
+
+  WorkerData* getCurrentWorker()
+  {
+    return currentWorker;
+  }
+
+
+  void setCurrentWorker( WorkerData* worker_data )
+  {
+    currentWorker = worker_data;
+  }
+
+
+  void openWorkerInbox( WorkerData* worker_data )
+  {
+    worker_data->inbox = nullptr;
+    worker_data->inboxFD = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC );
+    if ( worker_data->inboxFD < 0 )
+    {
+      throw Exception( "Could not create a worker inbox eventfd." );
+    }
+
+    worker_data->inboxEvent = event_new( worker_data->eventBase, worker_data->inboxFD, EV_READ|EV_PERSIST, workerInboxCB, (void*)worker_data );
+    if ( worker_data->inboxEvent == nullptr )
+    {
+      throw Exception( "Could not create a worker inbox event." );
+    }
+    event_add( worker_data->inboxEvent, nullptr );
+  }
+
+
+  void closeWorkerInbox( WorkerData* worker_data )
+  {
+    if ( worker_data->inboxEvent != nullptr )
+    {
+      event_free( worker_data->inboxEvent );
+      worker_data->inboxEvent = nullptr;
+    }
+    if ( worker_data->inboxFD > 0 )
+    {
+      ::close( worker_data->inboxFD );
+      worker_data->inboxFD = 0;
+    }
+  }
+
+
+  void signalWorkerInbox( WorkerData* worker_data )
+  {
+    uint64_t one = 1;
+    if ( ::write( worker_data->inboxFD, &one, sizeof( one ) ) < 0 && errno != EAGAIN )
+    {
+      ERROR_STREAM( "Stewardess::WorkerThread" ) << "Could not signal worker inbox: " << std::strerror( errno );
+    }
   }
 
 }